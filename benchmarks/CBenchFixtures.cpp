@@ -0,0 +1,318 @@
+#include "IDebug.h"
+#include <sys/stat.h>
+#if defined(_WIN32) || defined(_WIN64)
+	#include <direct.h>
+	#define mkdir _mkdir
+#endif
+
+#include "IEnums.h"
+#include "main.h"
+#include "TServer.h"
+#include "TPlayer.h"
+#include "CBenchFixtures.h"
+
+// Tile characters for the level boards.
+static const char boardChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static TServer* benchServer = nullptr;
+
+static void makeDir(const CString& path)
+{
+#if defined(_WIN32) || defined(_WIN64)
+	mkdir(path.text());
+#else
+	mkdir(path.text(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+#endif
+}
+
+static CString getBoardLine(int y, int seed)
+{
+	CString line;
+	line << "BOARD 0 " << CString(y) << " 64 0 ";
+	for (int x = 0; x < 64; ++x)
+	{
+		int tile = (x * 7 + y * 13 + seed) % 512;
+		line.writeChar(boardChars[tile >> 6]);
+		line.writeChar(boardChars[tile & 0x3F]);
+	}
+	return line;
+}
+
+static CString getNPCScript(int npc, int lines)
+{
+	// Level npcs are clientside only, so the V8 build doesn't have to compile anything.
+	CString script;
+	script << "//#CLIENTSIDE\r\n";
+	script << "function onCreated() {\r\n";
+	script << "  this.id = " << CString(npc) << ";\r\n";
+	for (int i = 0; i < lines; ++i)
+		script << "  this.values[" << CString(i) << "] = \"value " << CString(npc * lines + i) << "\";\r\n";
+	script << "}\r\n";
+	return script;
+}
+
+static bool writeLevels(const CString& path)
+{
+	// Lots of small levels for the level lookups.
+	for (int i = 0; i < BENCH_LEVELS; ++i)
+	{
+		CString level;
+		level << "GLEVNW01\r\n";
+		level << getBoardLine(0, i) << "\r\n";
+		if (!level.save(CString() << path << "level" << CString(i) << ".nw"))
+			return false;
+	}
+
+	// The gmap levels have full boards and a couple of npcs.
+	CString gmap;
+	gmap << "GRMAP001\r\n";
+	gmap << "WIDTH " << CString(BENCH_GMAPSIZE) << "\r\n";
+	gmap << "HEIGHT " << CString(BENCH_GMAPSIZE) << "\r\n";
+	gmap << "LEVELNAMES\r\n";
+	for (int y = 0; y < BENCH_GMAPSIZE; ++y)
+	{
+		for (int x = 0; x < BENCH_GMAPSIZE; ++x)
+		{
+			CString levelName = getBenchMapLevel(x, y);
+			gmap << (x == 0 ? "" : ",") << "\"" << levelName << "\"";
+
+			CString level;
+			level << "GLEVNW01\r\n";
+			for (int row = 0; row < 64; ++row)
+				level << getBoardLine(row, x + y * BENCH_GMAPSIZE) << "\r\n";
+			for (int npc = 0; npc < 2; ++npc)
+			{
+				level << "NPC - " << CString(10 + npc * 20) << " 20\r\n";
+				level << getNPCScript(npc, 5) << "NPCEND\r\n";
+			}
+			if (!level.save(CString() << path << levelName))
+				return false;
+		}
+		gmap << "\r\n";
+	}
+	gmap << "LEVELNAMESEND\r\n";
+	if (!gmap.save(CString() << path << BENCH_GMAP << ".gmap"))
+		return false;
+
+	// One large level for loadNW().
+	CString large;
+	large << "GLEVNW01\r\n";
+	for (int row = 0; row < 64; ++row)
+		large << getBoardLine(row, 99) << "\r\n";
+	for (int i = 0; i < 40; ++i)
+		large << "LINK level" << CString(i) << ".nw " << CString(i) << " 0 1 1 30 30\r\n";
+	for (int i = 0; i < 30; ++i)
+		large << "CHEST " << CString(i * 2) << " 10 greenrupee " << CString(i) << "\r\n";
+	for (int i = 0; i < 20; ++i)
+		large << "BADDY " << CString(i * 3) << " 40 " << CString(i % 10) << "\r\nI see you!\r\nOuch!\r\nGot you!\r\nBADDYEND\r\n";
+	for (int i = 0; i < 60; ++i)
+		large << "SIGN " << CString(i) << " 50\r\nSign number " << CString(i) << ".\r\nSecond line of the sign.\r\nSIGNEND\r\n";
+	for (int i = 0; i < 150; ++i)
+	{
+		large << "NPC block.png " << CString((i * 3) % 64) << " " << CString((i * 7) % 64) << "\r\n";
+		large << getNPCScript(i, 30) << "NPCEND\r\n";
+	}
+	return large.save(CString() << path << BENCH_LARGELEVEL);
+}
+
+static bool writeAccounts(const CString& path)
+{
+	for (int i = 0; i <= BENCH_ACCOUNTS; ++i)
+	{
+		CString accountName = (i == 0 ? CString("defaultaccount") : getBenchAccount(i));
+
+		CString account;
+		account << "GRACC001\r\n";
+		account << "NAME " << accountName << "\r\n";
+		account << "NICK " << accountName << "\r\n";
+		account << "COMMUNITYNAME " << accountName << "\r\n";
+		account << "LEVEL " << getBenchMapLevel(0, 0) << "\r\n";
+		account << "X 30.00\r\nY 30.50\r\nZ 0.00\r\n";
+		account << "MAXHP 3.00\r\nHP 3.00\r\nRUPEES 0\r\nANI idle\r\nARROWS 10\r\nBOMBS 5\r\n";
+		account << "GLOVEP 1\r\nSHIELDP 1\r\nSWORDP 1\r\nBOWP 1\r\n";
+		account << "HEAD head0.png\r\nBODY body.png\r\nSWORD sword1.png\r\nSHIELD shield1.png\r\n";
+		account << "COLORS 2,0,10,4,18\r\nSPRITE 2\r\nSTATUS 20\r\nMP 0\r\nAP 50\r\nAPCOUNTER 60\r\n";
+		account << "LANGUAGE English\r\nKILLS 0\r\nDEATHS 0\r\nRATING 1500.00\r\nDEVIATION 350.00\r\n";
+		account << "WEAPON bomb\r\nWEAPON bow\r\n";
+		for (int flag = 0; flag < 50; ++flag)
+			account << "FLAG bench.flag" << CString(flag) << "=" << CString(flag * i) << "\r\n";
+		for (int chest = 0; chest < 20; ++chest)
+			account << "CHEST " << CString(chest) << ":10:" << BENCH_LARGELEVEL << "\r\n";
+		account << "BANNED 0\r\nLOCALRIGHTS 0\r\nIPRANGE 0.0.0.0\r\n";
+
+		if (!account.save(CString() << path << accountName << ".txt"))
+			return false;
+	}
+	return true;
+}
+
+static bool writeConfig(const CString& path)
+{
+	CString options;
+	options << "name = Benchmark\r\n";
+	options << "nofoldersconfig = true\r\n";
+	options << "maxplayers = " << CString(BENCH_ACCOUNTS * 2) << "\r\n";
+	options << "gmaps = " << BENCH_GMAP << "\r\n";
+	options << "unstickmelevel = level0.nw\r\n";
+	options << "accountsavethread = false\r\n";
+	options << "scriptcodecache = false\r\n";
+	if (!options.save(CString() << path << "serveroptions.txt"))
+		return false;
+
+	if (!CString(BENCH_VERSION "\r\n").save(CString() << path << "allowedversions.txt"))
+		return false;
+	if (!CString("\r\n").save(CString() << path << "adminconfig.txt"))
+		return false;
+
+	// Word filter rules that only match now and then, like a real server's.
+	CString rules;
+	for (int i = 0; i < 40; ++i)
+	{
+		rules << "RULE\r\n";
+		rules << "CHECK chat pm nick toall\r\n";
+		rules << "MATCH badword" << CString(i) << "\r\n";
+		rules << "PRECISION 80%\r\n";
+		rules << "WORDPOSITION " << (i % 3 == 0 ? "full" : (i % 3 == 1 ? "start" : "part")) << "\r\n";
+		rules << "ACTION replace\r\n";
+		rules << "RULEEND\r\n";
+	}
+	return rules.save(CString() << path << "rules.txt");
+}
+
+bool haveFixtures(const CString& pHome)
+{
+	struct stat fileStat;
+	return stat((CString() << pHome << "servers/" << BENCH_SERVERNAME << "/world/" << BENCH_LARGELEVEL).text(), &fileStat) != -1;
+}
+
+bool generateFixtures(const CString& pHome)
+{
+	CString serverPath = CString() << pHome << "servers/" << BENCH_SERVERNAME << "/";
+	makeDir(pHome);
+	makeDir(CString() << pHome << "servers/");
+	makeDir(serverPath);
+	makeDir(CString() << serverPath << "accounts/");
+	makeDir(CString() << serverPath << "config/");
+	makeDir(CString() << serverPath << "logs/");
+	makeDir(CString() << serverPath << "world/");
+
+	if (!writeConfig(CString() << serverPath << "config/"))
+		return false;
+	if (!writeAccounts(CString() << serverPath << "accounts/"))
+		return false;
+
+	// The large level goes in last, so haveFixtures() only sees a finished folder.
+	return writeLevels(CString() << serverPath << "world/");
+}
+
+TServer* getBenchServer()
+{
+	if (benchServer != nullptr)
+		return benchServer;
+
+	benchServer = new TServer(BENCH_SERVERNAME);
+	benchServer->setReplay(true);
+	if (benchServer->init() != 0)
+	{
+		delete benchServer;
+		benchServer = nullptr;
+	}
+	return benchServer;
+}
+
+CString getBenchAccount(int account)
+{
+	return CString() << "bench" << CString(account);
+}
+
+CString getBenchMapLevel(int x, int y)
+{
+	return CString() << BENCH_GMAP << "_" << CString(x) << "_" << CString(y) << ".nw";
+}
+
+CString getBenchLogin(int account, unsigned char key)
+{
+	// The client type is sent as the bit it sets.
+	int clientType = 0;
+	while (clientType < 31 && (1 << clientType) != PLTYPE_CLIENT3)
+		++clientType;
+
+	CString accountName = getBenchAccount(account);
+	return CString() >> (char)clientType >> (char)key << BENCH_VERSION
+		>> (char)accountName.length() << accountName
+		>> (char)0;
+}
+
+static bool waitForLogins(const std::vector<TPlayer*>& players)
+{
+	TServer* server = getBenchServer();
+
+	// The login queue lets a few players in each loop.
+	for (int loop = 0; loop < 100000; ++loop)
+	{
+		bool loaded = true;
+		for (auto player : players)
+		{
+			if (!player->isLoaded())
+			{
+				loaded = false;
+				break;
+			}
+		}
+		if (loaded)
+			return true;
+
+		server->doMain();
+	}
+	return false;
+}
+
+std::vector<TPlayer*> loginBenchPlayers(int count, unsigned char key)
+{
+	TServer* server = getBenchServer();
+	std::vector<TPlayer*> players;
+	for (int i = 1; i <= count && i <= BENCH_ACCOUNTS; ++i)
+	{
+		auto *player = new TPlayer(server, nullptr, 0);
+		player->setReplay("127.0.0.1");
+		if (!server->addPlayer(player))
+		{
+			delete player;
+			continue;
+		}
+
+		CString login = getBenchLogin(i, key);
+		if (!player->replayPacket(login))
+		{
+			server->deletePlayer(player);
+			continue;
+		}
+		players.push_back(player);
+	}
+
+	if (!waitForLogins(players))
+	{
+		removeBenchPlayers();
+		players.clear();
+	}
+	return players;
+}
+
+void removeBenchPlayers()
+{
+	TServer* server = getBenchServer();
+
+	// Players still in the login queue aren't on the player list.
+	std::vector<TPlayer*> players;
+	for (auto & queued : *server->getLoginQueue())
+		players.push_back(queued.first);
+	for (auto player : *server->getPlayerList())
+		players.push_back(player);
+
+	for (auto player : players)
+	{
+		if (player->isReplay())
+			server->deletePlayer(player);
+	}
+	server->cleanupDeletedPlayers();
+}
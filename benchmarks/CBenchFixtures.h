@@ -0,0 +1,40 @@
+#ifndef CBENCHFIXTURES_H
+#define CBENCHFIXTURES_H
+
+#include <vector>
+#include "CString.h"
+
+class TServer;
+class TPlayer;
+
+// What the generated server folder holds.
+#define BENCH_SERVERNAME	"bench"
+#define BENCH_ACCOUNTS		500
+#define BENCH_LEVELS		5000
+#define BENCH_GMAPSIZE		8
+#define BENCH_GMAP			"benchmap"
+#define BENCH_LARGELEVEL	"large.nw"
+#define BENCH_VERSION		"GNW03014"
+
+// Writes a server folder under pHome/servers/bench/ with accounts, levels, a gmap and word filter rules.
+// Everything is synthetic so the suite runs without any real server data.
+bool generateFixtures(const CString& pHome);
+bool haveFixtures(const CString& pHome);
+
+// The server every case shares.  It runs in replay mode, so it has no sockets and drops what it sends to players.
+TServer* getBenchServer();
+
+CString getBenchAccount(int account);
+CString getBenchMapLevel(int x, int y);
+
+// The login packet a 2.22+ client sends for a bench account.
+CString getBenchLogin(int account, unsigned char key);
+
+// Logs bench accounts in through msgPLI_LOGIN and the login queue, and runs the server until they are all in.
+// Returns nothing if any of them didn't make it.
+std::vector<TPlayer*> loginBenchPlayers(int count, unsigned char key = 0);
+
+// Logs out every player the benchmarks added.
+void removeBenchPlayers();
+
+#endif
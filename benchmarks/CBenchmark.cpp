@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cstdio>
+#include "CBenchmark.h"
+
+// Iteration counts stop growing here, no matter how fast a case is.
+#define BENCHMARK_MAXITERATIONS	1000000000LL
+
+CBenchmarkState::CBenchmarkState(long long pIterations, long long pArg)
+: maxIterations(pIterations), iteration(0), arg(pArg), itemsProcessed(0),
+started(false), paused(false), elapsed(std::chrono::steady_clock::duration::zero())
+{
+}
+
+bool CBenchmarkState::keepRunning()
+{
+	if (!started)
+	{
+		started = true;
+		if (!error.empty())
+			return false;
+
+		startTime = std::chrono::steady_clock::now();
+	}
+
+	if (iteration < maxIterations && error.empty())
+	{
+		++iteration;
+		return true;
+	}
+
+	if (!paused)
+		elapsed += std::chrono::steady_clock::now() - startTime;
+	paused = true;
+	return false;
+}
+
+void CBenchmarkState::pauseTiming()
+{
+	if (paused || !started)
+		return;
+
+	elapsed += std::chrono::steady_clock::now() - startTime;
+	paused = true;
+}
+
+void CBenchmarkState::resumeTiming()
+{
+	if (!paused)
+		return;
+
+	startTime = std::chrono::steady_clock::now();
+	paused = false;
+}
+
+void CBenchmarkState::skipWithError(const std::string& pError)
+{
+	error = pError;
+}
+
+/*
+	CBenchmark
+*/
+CBenchmark::CBenchmark(const char* pName, benchmarkFunction pFunction)
+: name(pName), function(pFunction), fixedIterations(0)
+{
+	getBenchmarks().push_back(this);
+}
+
+std::vector<CBenchmark*>& CBenchmark::getBenchmarks()
+{
+	static std::vector<CBenchmark*> benchmarks;
+	return benchmarks;
+}
+
+static void printTime(char* buffer, size_t size, double seconds)
+{
+	if (seconds < 1e-6)
+		snprintf(buffer, size, "%10.1f ns", seconds * 1e9);
+	else if (seconds < 1e-3)
+		snprintf(buffer, size, "%10.2f us", seconds * 1e6);
+	else if (seconds < 1.0)
+		snprintf(buffer, size, "%10.2f ms", seconds * 1e3);
+	else snprintf(buffer, size, "%10.2f s ", seconds);
+}
+
+bool CBenchmark::run(long long pArg, double minTime)
+{
+	std::string caseName = name;
+	if (!args.empty())
+		caseName += "/" + std::to_string(pArg);
+
+	// Grow the iteration count until one run takes at least minTime, the way Google Benchmark does.
+	long long iterationCount = (fixedIterations > 0 ? fixedIterations : 1);
+	while (true)
+	{
+		CBenchmarkState state(iterationCount, pArg);
+		function(state);
+
+		if (!state.getError().empty())
+		{
+			printf("%-40s ERROR: %s\n", caseName.c_str(), state.getError().c_str());
+			return false;
+		}
+
+		double seconds = state.getSeconds();
+		if (fixedIterations > 0 || seconds >= minTime || iterationCount >= BENCHMARK_MAXITERATIONS)
+		{
+			char timeBuffer[32];
+			printTime(timeBuffer, sizeof(timeBuffer), seconds / (double)iterationCount);
+			printf("%-40s %s %12lld", caseName.c_str(), timeBuffer, iterationCount);
+			if (state.getItemsProcessed() > 0 && seconds > 0.0)
+				printf(" %12.0f items/s", (double)state.getItemsProcessed() / seconds);
+			if (!state.getLabel().empty())
+				printf(" %s", state.getLabel().c_str());
+			printf("\n");
+			fflush(stdout);
+			return true;
+		}
+
+		double multiplier = (seconds > 0.0 ? minTime * 1.4 / seconds : 10.0);
+		multiplier = std::min(10.0, std::max(multiplier, 2.0));
+		iterationCount = std::min(BENCHMARK_MAXITERATIONS, (long long)(iterationCount * multiplier));
+	}
+}
+
+int CBenchmark::runAll(const std::string& filter, double minTime)
+{
+	printf("%-40s %13s %12s\n", "Benchmark", "Time", "Iterations");
+	printf("--------------------------------------------------------------------------------\n");
+
+	int failed = 0;
+	for (auto benchmark : getBenchmarks())
+	{
+		if (!filter.empty() && benchmark->name.find(filter) == std::string::npos)
+			continue;
+
+		if (benchmark->args.empty())
+		{
+			if (!benchmark->run(0, minTime))
+				++failed;
+			continue;
+		}
+
+		for (auto value : benchmark->args)
+		{
+			if (!benchmark->run(value, minTime))
+				++failed;
+		}
+	}
+
+	return failed;
+}
@@ -0,0 +1,80 @@
+#ifndef CBENCHMARK_H
+#define CBENCHMARK_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// A small stand-in for Google Benchmark so the suite builds offline with nothing but the server's own dependencies.
+// Cases are written the same way:
+//
+//	static void BM_Something(CBenchmarkState& state)
+//	{
+//		// Set up fixtures here.
+//		while (state.keepRunning())
+//			doSomething(state.range());
+//	}
+//	BENCHMARK(BM_Something)->arg(50)->arg(500);
+
+class CBenchmarkState
+{
+	public:
+		CBenchmarkState(long long pIterations, long long pArg);
+
+		// Returns true until the case has run the requested number of iterations.  The clock starts on the first call.
+		bool keepRunning();
+
+		// Leaves per-iteration setup out of the measurement.
+		void pauseTiming();
+		void resumeTiming();
+
+		void setItemsProcessed(long long items)		{ itemsProcessed = items; }
+		void setLabel(const std::string& pLabel)	{ label = pLabel; }
+		void skipWithError(const std::string& pError);
+
+		long long range() const				{ return arg; }
+		long long iterations() const		{ return maxIterations; }
+		long long getItemsProcessed() const	{ return itemsProcessed; }
+		double getSeconds() const			{ return std::chrono::duration<double>(elapsed).count(); }
+		const std::string& getLabel() const	{ return label; }
+		const std::string& getError() const	{ return error; }
+
+	private:
+		long long maxIterations, iteration, arg, itemsProcessed;
+		bool started, paused;
+		std::chrono::steady_clock::time_point startTime;
+		std::chrono::steady_clock::duration elapsed;
+		std::string label, error;
+};
+
+typedef void (*benchmarkFunction)(CBenchmarkState&);
+
+class CBenchmark
+{
+	public:
+		CBenchmark(const char* pName, benchmarkFunction pFunction);
+
+		// Runs the case once for each argument.  Without any arguments, range() is 0.
+		CBenchmark* arg(long long value)			{ args.push_back(value); return this; }
+
+		// Use a fixed iteration count instead of running until the minimum time is up.  For the slow cases.
+		CBenchmark* iterations(long long value)		{ fixedIterations = value; return this; }
+
+		const std::string& getName() const			{ return name; }
+
+		static std::vector<CBenchmark*>& getBenchmarks();
+		static int runAll(const std::string& filter, double minTime);
+
+	private:
+		bool run(long long pArg, double minTime);
+
+		std::string name;
+		benchmarkFunction function;
+		std::vector<long long> args;
+		long long fixedIterations;
+};
+
+#define BENCHMARK(func) \
+	static CBenchmark* benchmark_##func = (new CBenchmark(#func, func))
+
+#endif
@@ -0,0 +1,35 @@
+#include "IDebug.h"
+#include <vector>
+
+#include "TServer.h"
+#include "TPlayer.h"
+#include "CWordFilter.h"
+#include "CBenchmark.h"
+#include "CBenchFixtures.h"
+
+// Chat lines through the filter's 40 rules.  One line in ten has a bad word in it.
+static void BM_WordFilterApply(CBenchmarkState& state)
+{
+	std::vector<TPlayer*> players = loginBenchPlayers(1);
+	if (players.empty())
+	{
+		state.skipWithError("could not log in");
+		return;
+	}
+
+	TServer* server = getBenchServer();
+	CWordFilter* filter = server->getWordFilter();
+	const CString clean("hey, does anyone want to go to the bomb arena with me later tonight?");
+	const CString dirty("hey, does anyone want to go to the badword12 arena with me later tonight?");
+
+	int line = 0;
+	while (state.keepRunning())
+	{
+		CString chat = (line++ % 10 == 0 ? dirty : clean);
+		filter->apply(players.front(), chat, FILTER_CHECK_CHAT);
+	}
+	state.setItemsProcessed(state.iterations());
+
+	removeBenchPlayers();
+}
+BENCHMARK(BM_WordFilterApply);
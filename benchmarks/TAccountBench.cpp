@@ -0,0 +1,21 @@
+#include "IDebug.h"
+
+#include "TServer.h"
+#include "TAccount.h"
+#include "CBenchmark.h"
+#include "CBenchFixtures.h"
+
+// Reading an account file with flags and chests.
+static void BM_LoadAccount(CBenchmarkState& state)
+{
+	TServer* server = getBenchServer();
+	int account = 0;
+	while (state.keepRunning())
+	{
+		TAccount loaded(server);
+		if (!loaded.loadAccount(getBenchAccount(account++ % BENCH_ACCOUNTS + 1)))
+			state.skipWithError("could not load the account");
+	}
+	state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoadAccount);
@@ -0,0 +1,56 @@
+#include "IDebug.h"
+#include <vector>
+
+#include "TServer.h"
+#include "TLevel.h"
+#include "CBenchmark.h"
+#include "CBenchFixtures.h"
+
+// Lookups by name with every small level loaded, like a server that has been up for a while.
+static void BM_FindLevel(CBenchmarkState& state)
+{
+	TServer* server = getBenchServer();
+
+	std::vector<CString> names;
+	for (int i = 0; i < BENCH_LEVELS; ++i)
+		names.push_back(CString() << "level" << CString(i) << ".nw");
+
+	// The first pass loads them.
+	for (auto& name : names)
+	{
+		if (TLevel::findLevel(name, server) == nullptr)
+		{
+			state.skipWithError("missing level");
+			return;
+		}
+	}
+
+	size_t next = 0;
+	while (state.keepRunning())
+	{
+		// Walk the names out of order so the hits aren't all at the front of the list.
+		next = (next + 7919) % names.size();
+		TLevel::findLevel(names[next], server);
+	}
+	state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindLevel);
+
+// Parsing a big .nw level with links, chests, baddies, signs and npcs.
+static void BM_LoadNW(CBenchmarkState& state)
+{
+	TLevel* level = TLevel::findLevel(BENCH_LARGELEVEL, getBenchServer());
+	if (level == nullptr)
+	{
+		state.skipWithError("missing " BENCH_LARGELEVEL);
+		return;
+	}
+
+	while (state.keepRunning())
+	{
+		if (!level->reload())
+			state.skipWithError("could not load " BENCH_LARGELEVEL);
+	}
+	state.setItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoadNW);
@@ -0,0 +1,27 @@
+#include "IDebug.h"
+#include <string>
+
+#include "TServer.h"
+#include "TLevel.h"
+#include "TNPC.h"
+#include "CBenchmark.h"
+#include "CBenchFixtures.h"
+
+// Every prop of a level npc with a long script, as a player entering the level gets them.
+static void BM_NPCGetProps(CBenchmarkState& state)
+{
+	TLevel* level = TLevel::findLevel(BENCH_LARGELEVEL, getBenchServer());
+	if (level == nullptr || level->getLevelNPCs()->empty())
+	{
+		state.skipWithError("missing " BENCH_LARGELEVEL);
+		return;
+	}
+
+	TNPC* npc = level->getLevelNPCs()->front();
+	size_t bytes = 0;
+	while (state.keepRunning())
+		bytes += npc->getProps(0).length();
+	state.setItemsProcessed(state.iterations());
+	state.setLabel(std::to_string(bytes / state.iterations()) + " bytes");
+}
+BENCHMARK(BM_NPCGetProps);
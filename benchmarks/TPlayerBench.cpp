@@ -0,0 +1,136 @@
+#include "IDebug.h"
+#include <random>
+#include <vector>
+
+#include "IEnums.h"
+#include "CEncryption.h"
+#include "TServer.h"
+#include "TPlayer.h"
+#include "TAccount.h"
+#include "CBenchmark.h"
+#include "CBenchFixtures.h"
+
+static CString getMoveProps(int step)
+{
+	return CString() >> (char)PLPROP_X >> (char)(40 + step % 40)
+		>> (char)PLPROP_Y >> (char)(60 + step % 20)
+		>> (char)PLPROP_SPRITE >> (char)(step % 4);
+}
+
+// A 2.22+ client's frame of movement packets: zlib, gen 5 encryption, and through TPlayer::doMain().
+static void BM_PlayerDoMain(CBenchmarkState& state)
+{
+	const unsigned char key = 73;
+	std::vector<TPlayer*> players = loginBenchPlayers(1, key);
+	if (players.empty())
+	{
+		state.skipWithError("could not log in");
+		return;
+	}
+	TPlayer* player = players.front();
+
+	// The client side of the player's in_codec.
+	CEncryption codec;
+	codec.setGen(ENCRYPT_GEN_5);
+	codec.reset(key);
+
+	int step = 0;
+	while (state.keepRunning())
+	{
+		state.pauseTiming();
+		CString packets;
+		for (int i = 0; i < state.range(); ++i)
+			packets >> (char)PLI_PLAYERPROPS << getMoveProps(step++) << "\n";
+		packets.zcompressI();
+		codec.limitFromType(COMPRESS_ZLIB);
+		codec.encrypt(packets);
+
+		CString frame;
+		frame.writeShort((short)(packets.length() + 1));
+		frame.writeChar((char)COMPRESS_ZLIB);
+		frame << packets;
+		state.resumeTiming();
+
+		if (!player->replayData(frame.text(), frame.length()))
+			state.skipWithError("the player was disconnected");
+	}
+	state.setItemsProcessed(state.iterations() * state.range());
+
+	removeBenchPlayers();
+}
+BENCHMARK(BM_PlayerDoMain)->arg(1)->arg(20);
+
+// One player moving, with range() players in the level to forward it to.
+static void BM_SetPropsMovement(CBenchmarkState& state)
+{
+	std::vector<TPlayer*> players = loginBenchPlayers((int)state.range());
+	if (players.empty())
+	{
+		state.skipWithError("could not log in");
+		return;
+	}
+
+	for (auto player : players)
+		player->warp(BENCH_LARGELEVEL, 30.0f, 30.0f);
+
+	TPlayer* mover = players.front();
+	int step = 0;
+	while (state.keepRunning())
+	{
+		CString props = getMoveProps(step++);
+		mover->setProps(props, true, false);
+	}
+	state.setItemsProcessed(state.iterations());
+
+	removeBenchPlayers();
+}
+BENCHMARK(BM_SetPropsMovement)->arg(1)->arg(50);
+
+// Level broadcasts on a gmap with range() players spread over it.
+static void BM_SendPacketToLevel(CBenchmarkState& state)
+{
+	std::vector<TPlayer*> players = loginBenchPlayers((int)state.range());
+	if (players.empty())
+	{
+		state.skipWithError("could not log in");
+		return;
+	}
+
+	// Always the same spread, so runs can be compared.
+	std::mt19937 random(1);
+	std::uniform_int_distribution<int> mapPos(0, BENCH_GMAPSIZE - 1);
+	std::uniform_real_distribution<float> levelPos(0.0f, 63.0f);
+	for (auto player : players)
+		player->warp(getBenchMapLevel(mapPos(random), mapPos(random)), levelPos(random), levelPos(random));
+
+	TServer* server = getBenchServer();
+	CString packet = CString() >> (char)PLO_OTHERPLPROPS >> (short)0 << getMoveProps(0);
+	size_t sender = 0;
+	while (state.keepRunning())
+	{
+		TPlayer* player = players[sender++ % players.size()];
+		server->sendPacketToLevel(packet, player->getMap(), player, false);
+	}
+	state.setItemsProcessed(state.iterations());
+
+	removeBenchPlayers();
+}
+BENCHMARK(BM_SendPacketToLevel)->arg(50)->arg(500);
+
+// Time to playable: range() clients log in at once, and the clock stops when the last one is in.
+static void BM_LoginBootstrap(CBenchmarkState& state)
+{
+	while (state.keepRunning())
+	{
+		std::vector<TPlayer*> players = loginBenchPlayers((int)state.range());
+
+		state.pauseTiming();
+		if (players.size() != (size_t)state.range())
+			state.skipWithError("not every player logged in");
+		removeBenchPlayers();
+		state.resumeTiming();
+	}
+	state.setItemsProcessed(state.iterations() * state.range());
+	state.setLabel("logins");
+}
+BENCHMARK(BM_LoginBootstrap)->arg(BENCH_ACCOUNTS)->iterations(3);
@@ -0,0 +1,103 @@
+#include "IDebug.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "IConfig.h"
+#include "CString.h"
+#include "CSocket.h"
+#include "main.h"
+#include "CBenchmark.h"
+#include "CBenchFixtures.h"
+
+// The server code expects these from main.cpp.
+std::atomic_bool shutdownProgram{ false };
+static CString homepath("benchfixtures/");
+
+const CString getHomePath()
+{
+	return homepath;
+}
+
+void printHelp(const char* pname)
+{
+	printf("Graal Reborn GServer benchmarks version %s\n\n", GSERVER_VERSION);
+	printf("USAGE: %s [options]\n\n", pname);
+	printf(" --fixtures DIR\t\tWhere the generated server folder is.  Made if it doesn't exist.  Default: benchfixtures\n");
+	printf(" --generate DIR\t\tWrite the fixtures into DIR and exit.\n");
+	printf(" --filter TEXT\t\tOnly run the cases with TEXT in their name.\n");
+	printf(" --min-time SECS\tHow long each case runs for.  Default: 0.5\n");
+	printf(" --list\t\t\tList the cases and exit.\n");
+}
+
+static CString fixPath(CString path)
+{
+	if (path[path.length() - 1] != '/' && path[path.length() - 1] != '\\')
+		path << "/";
+	return path;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string filter;
+	double minTime = 0.5;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string key(argv[i]);
+		if (key == "--list")
+		{
+			for (auto benchmark : CBenchmark::getBenchmarks())
+				printf("%s\n", benchmark->getName().c_str());
+			return 0;
+		}
+
+		if (key == "--help" || i + 1 >= argc)
+		{
+			printHelp(argv[0]);
+			return 1;
+		}
+
+		std::string val(argv[++i]);
+		if (key == "--fixtures") homepath = fixPath(val.c_str());
+		else if (key == "--filter") filter = val;
+		else if (key == "--min-time") minTime = atof(val.c_str());
+		else if (key == "--generate")
+		{
+			CString path = fixPath(val.c_str());
+			if (!generateFixtures(path))
+			{
+				printf("** [Error] Could not write the fixtures to %s\n", path.text());
+				return 1;
+			}
+			printf(":: Wrote the benchmark fixtures to %s\n", path.text());
+			return 0;
+		}
+		else
+		{
+			printHelp(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!haveFixtures(homepath))
+	{
+		printf(":: Generating fixtures in %s\n", homepath.text());
+		if (!generateFixtures(homepath))
+		{
+			printf("** [Error] Could not write the fixtures to %s\n", homepath.text());
+			return 1;
+		}
+	}
+
+	if (getBenchServer() == nullptr)
+	{
+		printf("** [Error] Could not start the benchmark server from %s\n", homepath.text());
+		return 1;
+	}
+
+	int failed = CBenchmark::runAll(filter, minTime);
+	CSocket::socketSystemDestroy();
+	return (failed == 0 ? 0 : 1);
+}
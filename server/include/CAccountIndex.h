@@ -0,0 +1,82 @@
+#ifndef CACCOUNTINDEX_H
+#define CACCOUNTINDEX_H
+
+#include <ctime>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "CString.h"
+
+// Account fields kept in memory for RC account searches.
+enum
+{
+	ACCIDX_NICK			= 0,
+	ACCIDX_LEVEL		= 1,
+	ACCIDX_IP			= 2,
+	ACCIDX_ONSECS		= 3,
+	ACCIDX_BANNED		= 4,
+	ACCIDX_BANREASON	= 5,
+	ACCIDX_COMMENTS		= 6,
+	ACCIDX_EMAIL		= 7,
+	ACCIDX_LOCALRIGHTS	= 8,
+	ACCIDX_LOADONLY		= 9,
+
+	// Fields that can appear more than once in an account.
+	ACCIDX_FLAG			= 10,
+	ACCIDX_WEAPON		= 11,
+	ACCIDX_FOLDERRIGHT	= 12,
+};
+#define ACCIDX_LISTSTART	ACCIDX_FLAG
+#define ACCIDX_COUNT		13
+
+// A single "name<op>value" search condition, parsed once per search.
+struct SAccountCondition
+{
+	SAccountCondition() : column(-1), op(-1) {}
+
+	int column;
+	int op;
+	CString name;
+	CString value;
+};
+
+class TServer;
+class CAccountIndex
+{
+	public:
+		CAccountIndex(TServer* pServer) : server(pServer), loaded(false), modified(false), lastSync(0) {}
+
+		void load();
+		void save();
+		void clear();
+
+		// Called with the account snapshot every time an account is saved.
+		void update(const CString& fileName, const CString& fileData);
+
+		// Returns the names of all accounts matching the RC account list search.
+		std::vector<CString> search(const CString& name, const CString& conditions);
+
+	private:
+		size_t getRow(const CString& fileName);
+		void readRow(size_t row, const CString& filePath);
+		void parseRow(size_t row, const CString& fileData);
+		void sync();
+
+		static std::vector<SAccountCondition> compile(CString conditions);
+		bool meetsCondition(size_t row, const SAccountCondition& condition) const;
+
+		TServer* server;
+		bool loaded, modified;
+		time_t lastSync;
+
+		// Rows are indexed by account file name.  Each field is stored in its own column.
+		std::unordered_map<std::string, size_t> rowIds;
+		std::vector<size_t> freeRows;
+		std::vector<CString> rowFiles;
+		std::vector<time_t> rowModTimes;
+		std::vector<unsigned short> rowFields;
+		std::vector<CString> columns[ACCIDX_LISTSTART];
+		std::vector<std::vector<CString>> listColumns[ACCIDX_COUNT - ACCIDX_LISTSTART];
+};
+
+#endif
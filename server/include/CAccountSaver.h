@@ -0,0 +1,56 @@
+#ifndef CACCOUNTSAVER_H
+#define CACCOUNTSAVER_H
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "CString.h"
+
+// A snapshot of an account file, taken on the server thread.
+struct SAccountSaveJob
+{
+	CString accountName;
+	CString fileName;
+	CString fileData;
+};
+
+class TServer;
+class CAccountSaver
+{
+	public:
+		CAccountSaver(TServer* pServer) : server(pServer), running(false), writing(false) {}
+		~CAccountSaver();
+
+		// Allows std::thread to work.
+		void operator()();
+
+		void start();
+		void stop();
+
+		// Queues an account snapshot.  If the writer isn't running, the file is written immediately.
+		void queue(const CString& accountName, const CString& fileName, const CString& fileData);
+
+		// Returns the newest snapshot that hasn't reached the disk yet.
+		bool getPending(const CString& fileName, CString& fileData);
+
+		size_t getBacklog();
+
+		// Logs the saves the writer thread couldn't make.  The server's logs aren't thread safe, so the writer
+		// only queues its errors and the server thread calls this.
+		void reportErrors();
+
+	private:
+		bool writeFile(SAccountSaveJob& job);
+
+		TServer* server;
+		bool running, writing;
+		std::deque<SAccountSaveJob> jobs;
+		std::vector<CString> failedSaves;
+		std::mutex jobMutex;
+		std::condition_variable jobSignal;
+		std::thread writerThread;
+};
+
+#endif
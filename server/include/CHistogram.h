@@ -0,0 +1,37 @@
+#ifndef CHISTOGRAM_H
+#define CHISTOGRAM_H
+
+// Values below this get a bucket each.  Above it, every power of two is split into 4 buckets,
+// so a value is never more than 25% off from its bucket, the way HdrHistogram does it.
+#define HISTOGRAM_LINEAR		8
+#define HISTOGRAM_BUCKETS		128
+
+// A fixed size latency histogram.  Recording is a few shifts and an increment, so it can stay on in production.
+class CHistogram
+{
+	public:
+		CHistogram()							{ reset(); }
+
+		void record(unsigned long long value);
+		void merge(const CHistogram& other);
+		void reset();
+
+		unsigned long long getCount() const		{ return count; }
+		unsigned long long getSum() const		{ return sum; }
+		unsigned long long getMax() const		{ return maxValue; }
+		double getMean() const					{ return (count == 0 ? 0.0 : (double)sum / (double)count); }
+
+		// The highest value the bucket holding the percentile can have.  Never more than the max.
+		unsigned long long getPercentile(double percentile) const;
+
+		unsigned int getBucketCount(int bucket) const	{ return buckets[bucket]; }
+		static unsigned long long getBucketLimit(int bucket);
+
+	private:
+		static int getBucket(unsigned long long value);
+
+		unsigned int buckets[HISTOGRAM_BUCKETS];
+		unsigned long long count, sum, maxValue;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef CMETRICSSERVER_H
+#define CMETRICSSERVER_H
+
+#include <vector>
+#include <time.h>
+#include "CString.h"
+#include "CSocket.h"
+
+class TServer;
+
+// One scrape.  Reads the request, answers it and hangs up.
+class CMetricsConnection : public CSocketStub
+{
+	public:
+		// Required by CSocketStub.
+		bool onRecv();
+		bool onSend();
+		bool onRegister()			{ return true; }
+		void onUnregister();
+		SOCKET getSocketHandle()	{ return sock->getHandle(); }
+		bool canRecv();
+		bool canSend()				{ return !sendBuffer.isEmpty(); }
+
+		CMetricsConnection(TServer* pServer, CSocket* pSocket);
+		~CMetricsConnection();
+
+		bool isClosed() const		{ return closed; }
+		time_t getConnectTime() const	{ return connectTime; }
+
+	private:
+		TServer* server;
+		CSocket* sock;
+		CString recvBuffer, sendBuffer;
+		bool closed;
+		time_t connectTime;
+};
+
+// Serves the server's counters as a Prometheus text page at http://127.0.0.1:<metricsport>/metrics.
+// It runs on the server thread through the socket manager, like the player socket.
+class CMetricsServer : public CSocketStub
+{
+	public:
+		// Required by CSocketStub.
+		bool onRecv();
+		bool onSend()				{ return true; }
+		bool onRegister()			{ return true; }
+		void onUnregister()			{ return; }
+		SOCKET getSocketHandle()	{ return sock.getHandle(); }
+		bool canRecv()				{ return true; }
+		bool canSend()				{ return false; }
+
+		CMetricsServer(TServer* pServer);
+		~CMetricsServer();
+
+		bool init(const CString& pPort);
+		void cleanup();
+
+		// Deletes finished connections, and drops the ones that never sent a request.
+		void doTimedEvents();
+
+		bool isListening() const	{ return listening; }
+		CString getMetrics();
+
+	private:
+		TServer* server;
+		CSocket sock;
+		std::vector<CMetricsConnection*> connections;
+		bool listening;
+};
+
+#endif
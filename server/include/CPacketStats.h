@@ -0,0 +1,52 @@
+#ifndef CPACKETSTATS_H
+#define CPACKETSTATS_H
+
+#include <chrono>
+#include "CHistogram.h"
+
+struct SPacketCounter
+{
+	unsigned long long packets;
+	unsigned long long bytes;
+};
+
+struct SCacheCounter
+{
+	unsigned long long hits;
+	unsigned long long misses;
+};
+
+// Counts the packets players send and are sent by id, and how long the server takes to handle each PLI_* packet.
+// Also the bytes read off player sockets, and how often a player's cached file or level was still good.
+// Only the game thread records, so none of it is locked.
+class CPacketStats
+{
+	public:
+		CPacketStats()							{ reset(); }
+
+		void recordIn(unsigned char id, unsigned int bytes, unsigned long long micros);
+		void recordOut(unsigned char id, unsigned int bytes);
+		void recordSocketIn(unsigned int bytes)					{ socketBytesIn += bytes; }
+		void recordFileCache(bool hit)							{ ++(hit ? fileCache.hits : fileCache.misses); }
+		void recordLevelCache(bool hit)							{ ++(hit ? levelCache.hits : levelCache.misses); }
+		void reset();
+
+		const SPacketCounter& getIn(unsigned char id) const		{ return in[id]; }
+		const SPacketCounter& getOut(unsigned char id) const	{ return out[id]; }
+		const CHistogram& getLatency(unsigned char id) const	{ return latency[id]; }
+		unsigned long long getSocketBytesIn() const				{ return socketBytesIn; }
+		const SCacheCounter& getFileCache() const				{ return fileCache; }
+		const SCacheCounter& getLevelCache() const				{ return levelCache; }
+
+		// Seconds since the counters were last reset.
+		double getSeconds() const;
+
+	private:
+		SPacketCounter in[256], out[256];
+		CHistogram latency[256];
+		unsigned long long socketBytesIn;
+		SCacheCounter fileCache, levelCache;
+		std::chrono::steady_clock::time_point startTime;
+};
+
+#endif
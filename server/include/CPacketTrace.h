@@ -0,0 +1,56 @@
+#ifndef CPACKETTRACE_H
+#define CPACKETTRACE_H
+
+#include <chrono>
+#include <cstdio>
+#include "CString.h"
+
+// Record types in a packet trace.
+enum
+{
+	PACKETTRACE_CONNECT		= 0,
+	PACKETTRACE_PACKET		= 1,
+	PACKETTRACE_DISCONNECT	= 2,
+};
+
+struct SPacketTraceRecord
+{
+	unsigned char type;
+	unsigned int time;			// Milliseconds since the trace was started.
+	unsigned short id;			// Player id.
+	CString data;				// The ip on connect, the packet otherwise.
+};
+
+// Records the packets players send, after they are decrypted, so they can be replayed into a server later.
+// The file starts with "GRTRACE1".  Each record is [u8 type][u32 time][u16 player id][u32 length][data], little endian.
+class CPacketTrace
+{
+	public:
+		CPacketTrace() : file(0), recording(false) {}
+		~CPacketTrace();
+
+		bool open(const CString& pFileName);
+		bool openRead(const CString& pFileName);
+		void close();
+		void flush();
+
+		bool isRecording() const		{ return recording; }
+		const CString& getFileName() const	{ return fileName; }
+
+		void writeConnect(unsigned short id, const CString& ip);
+		void writePacket(unsigned short id, const CString& packet);
+		void writeDisconnect(unsigned short id);
+
+		bool read(SPacketTraceRecord& record);
+
+	private:
+		void writeRecord(unsigned char type, unsigned short id, const CString& data);
+
+		FILE* file;
+		bool recording;
+		CString fileName;
+		CString buffer;
+		std::chrono::steady_clock::time_point startTime;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef CREPLAYSINK_H
+#define CREPLAYSINK_H
+
+#include "CString.h"
+#include "CEncryption.h"
+
+// Stands in for a replayed player's file queue.  Packets are compressed and encrypted the way the file queue
+// sends them to a client, then thrown away, so a replay still does the work of the send path.
+class CReplaySink
+{
+	public:
+		CReplaySink() : bytesSent(0) {}
+
+		void setCodec(int pGen, unsigned char pKey);
+		void addPacket(const CString& pPacket)		{ buffer << pPacket; }
+		void sendCompress();
+
+		// What would have gone out on the socket.
+		unsigned long long getBytesSent() const		{ return bytesSent; }
+
+	private:
+		CEncryption out_codec;
+		CString buffer;
+		unsigned long long bytesSent;
+};
+
+#endif
@@ -7,6 +7,7 @@
 #include <string>
 #include <atomic>
 #include <chrono>
+#include <functional>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
@@ -15,7 +16,9 @@
 #include "ScriptBindings.h"
 #include "ScriptAction.h"
 #include "ScriptFactory.h"
+#include "ScriptHash.h"
 
+class IScriptCompileJob;
 class IScriptEnv;
 class IScriptFunction;
 
@@ -31,12 +34,28 @@ public:
 
 	bool Initialize();
 	void Cleanup(bool shutDown = false);
+
+	// Bakes the bindings and a server's bootstrap.js into a startup snapshot (serverPath/v8snapshot.bin)
+	static bool CreateSnapshot(const std::string& serverPath);
 	void RunTimers(const std::chrono::high_resolution_clock::time_point& time);
 	void RunScripts(const std::chrono::high_resolution_clock::time_point& time);
 
 	void ScriptWatcher();
 	void StartScriptExecution(const std::chrono::high_resolution_clock::time_point& startTime);
 	bool StopScriptExecution();
+	bool IsScriptRunning() const;
+
+	// Time a single npc or weapon may run scripts for in a tick, before the rest of its actions wait for the next one
+	std::chrono::nanoseconds getScriptSoftLimit() const;
+
+	// Time a script may run before it is killed and disabled
+	std::chrono::milliseconds getScriptHardLimit() const;
+
+	// Merge repeated high-frequency events that are still waiting to run
+	bool getCoalesceEvents() const;
+
+	// Don't run level npc scripts until somebody can see them
+	bool getDormantNpcs() const;
 
 	TServer * getServer() const;
 	IScriptEnv * getScriptEnv() const;
@@ -58,12 +77,27 @@ public:
 	void removeCallBack(const std::string& callback);
 	void setCallBack(const std::string& callback, IScriptFunction *cbFunc);
 
-	// Script Compile / Cache
-	IScriptFunction * CompileCache(const std::string& code, bool referenceCount = true);
-	bool ClearCache(const std::string& code);
+	// Script Compile / Cache, keyed by the wrapper type and a hash of the unwrapped code
+	template <typename T>
+	IScriptFunction * CompileCache(const char *code, const std::string& hash, bool referenceCount = true);
+
+	// Compiles on a worker thread instead.  The callback runs at the start of the tick the script gets cached on,
+	// or right away if it already is.  It is told whether the script compiled, a failed one has already been reported.
+	template <typename T>
+	void CompileCacheAsync(const std::string& code, const std::string& hash, std::function<void(bool)> callback);
+
+	template <typename T>
+	bool ClearCache(const std::string& hash);
 
 	const ScriptRunError& getScriptError() const;
 
+	// Queue sizes for the metrics page
+	size_t getQueuedNpcCount() const { return _updateNpcs.size(); }
+	size_t getNpcTimerCount() const { return _updateNpcsTimer.size(); }
+	size_t getQueuedWeaponCount() const { return _updateWeapons.size(); }
+	size_t getPendingCompileCount() const { return _pendingCompiles.size(); }
+	size_t getCachedScriptCount() const { return _cachedScripts.size(); }
+
 	template<class... Args>
 	ScriptAction * CreateAction(const std::string& action, Args... An);
 
@@ -73,7 +107,26 @@ public:
 	template <typename T>
 	static std::string WrapScript(const std::string& code);
 
+	static std::string HashScript(const char *code, size_t length);
+
+	// Script timers count from here, replays set it to the start of the trace
+	void resetScriptTimer(const std::chrono::high_resolution_clock::time_point& time) {
+		lastScriptTimer = time;
+		accumulator = std::chrono::nanoseconds(0);
+	}
+
 private:
+	void BindClasses();
+
+	IScriptFunction * CompileScript(const std::string& cacheKey, const std::string& code, bool referenceCount);
+	IScriptFunction * FindCache(const std::string& cacheKey, bool referenceCount);
+	bool RemoveCache(const std::string& cacheKey);
+	void QueueCompile(const std::string& cacheKey, const std::string& code, std::function<void(bool)> callback);
+	void RunCompiles();
+
+	template <typename T>
+	static std::string CacheKey(const std::string& hash);
+
 	IScriptEnv *_env;
 	IScriptFunction *_bootstrapFunction;
 	IScriptWrapped<TServer> *_environmentObject;
@@ -84,13 +137,24 @@ private:
     std::chrono::nanoseconds accumulator;
 
     // Script watcher
+	std::chrono::nanoseconds _scriptSoftLimit;
+	std::chrono::milliseconds _scriptHardLimit;
+	bool _coalesceEvents;
+	bool _dormantNpcs;
 	std::atomic<bool> _scriptIsRunning;
 	std::atomic<bool> _scriptWatcherRunning;
 	std::chrono::high_resolution_clock::time_point _scriptStartTime;
 	std::mutex _scriptWatcherLock;
 	std::thread _scriptWatcherThread;
 
+	struct ScriptCompile
+	{
+		IScriptCompileJob *job;
+		std::vector<std::function<void(bool)>> callbacks;
+	};
+
 	std::unordered_map<std::string, IScriptFunction *> _cachedScripts;
+	std::unordered_map<std::string, ScriptCompile> _pendingCompiles;
 	std::unordered_map<std::string, IScriptFunction *> _callbacks;
 	std::unordered_set<TNPC *> _updateNpcs;
 	std::unordered_set<TNPC *> _updateNpcsTimer;
@@ -115,6 +179,31 @@ inline bool CScriptEngine::StopScriptExecution()
 	return res;
 }
 
+inline bool CScriptEngine::IsScriptRunning() const
+{
+	return _scriptIsRunning.load();
+}
+
+inline std::chrono::nanoseconds CScriptEngine::getScriptSoftLimit() const
+{
+	return _scriptSoftLimit;
+}
+
+inline std::chrono::milliseconds CScriptEngine::getScriptHardLimit() const
+{
+	return _scriptHardLimit;
+}
+
+inline bool CScriptEngine::getCoalesceEvents() const
+{
+	return _coalesceEvents;
+}
+
+inline bool CScriptEngine::getDormantNpcs() const
+{
+	return _dormantNpcs;
+}
+
 // Getters
 
 inline TServer * CScriptEngine::getServer() const {
@@ -190,9 +279,11 @@ ScriptAction * CScriptEngine::CreateAction(const std::string& action, Args... An
 	}
 
 	// Create an arguments object, and pass it to ScriptAction
+	const void *subject = detail::ActionSubject(An...);
 	IScriptArguments *args = ScriptFactory::CreateArguments(_env, std::forward<Args>(An)...);
 
 	ScriptAction *newScriptAction = new ScriptAction(funcIt->second, args, action);
+	newScriptAction->setSubject(subject);
 	return newScriptAction;
 }
 
@@ -209,6 +300,44 @@ inline IScriptWrapped<T> * CScriptEngine::WrapObject(T *obj) const
 	return wrappedObject;
 }
 
+template <typename T>
+inline IScriptFunction * CScriptEngine::CompileCache(const char *code, const std::string& hash, bool referenceCount)
+{
+	// Only wrap the code if we have to compile it
+	std::string cacheKey = CacheKey<T>(hash);
+	IScriptFunction *compiledScript = FindCache(cacheKey, referenceCount);
+	if (compiledScript == nullptr)
+		compiledScript = CompileScript(cacheKey, WrapScript<T>(code), referenceCount);
+	return compiledScript;
+}
+
+template <typename T>
+inline void CScriptEngine::CompileCacheAsync(const std::string& code, const std::string& hash, std::function<void(bool)> callback)
+{
+	std::string cacheKey = CacheKey<T>(hash);
+	if (code.empty() || _cachedScripts.find(cacheKey) != _cachedScripts.end())
+	{
+		callback(true);
+		return;
+	}
+
+	QueueCompile(cacheKey, WrapScript<T>(code), std::move(callback));
+}
+
+template <typename T>
+inline bool CScriptEngine::ClearCache(const std::string& hash) {
+	return RemoveCache(CacheKey<T>(hash));
+}
+
+template <typename T>
+inline std::string CScriptEngine::CacheKey(const std::string& hash) {
+	return std::string(ScriptConstructorId<T>::result).append(":").append(hash);
+}
+
+inline std::string CScriptEngine::HashScript(const char *code, size_t length) {
+	return ScriptHash::Hash(code, length);
+}
+
 template <typename T>
 inline std::string CScriptEngine::WrapScript(const std::string& code) {
 	return code;
@@ -0,0 +1,93 @@
+#ifndef CTICKPROFILER_H
+#define CTICKPROFILER_H
+
+#include <chrono>
+#include <ctime>
+#include "CHistogram.h"
+
+// The parts of a server tick that are timed.
+enum
+{
+	TICKPHASE_SOCKETS		= 0,	// Reading sockets, minus the packets and sends below.  The wait for them isn't counted.
+	TICKPHASE_PACKETS		= 1,	// Decrypting and handling what players sent.
+	TICKPHASE_SEND			= 2,	// Compressing and sending the players' queues.
+	TICKPHASE_SCRIPTS		= 3,
+	TICKPHASE_LOGINS		= 4,
+	TICKPHASE_SERVERLIST	= 5,
+	TICKPHASE_PLAYEREVENTS	= 6,
+	TICKPHASE_LEVELEVENTS	= 7,
+	TICKPHASE_SAVES			= 8,	// Server flags, weapons and npcs.
+	TICKPHASE_FILESYSTEM	= 9,	// File system resyncs and config reloads.
+	TICKPHASE_COUNT
+};
+
+// Phases nested deeper than this aren't timed.
+#define TICKPROFILER_DEPTH		8
+
+struct STickSample
+{
+	time_t time;
+	unsigned long long total, wait;
+	unsigned long long phases[TICKPHASE_COUNT];
+};
+
+// Times each phase of TServer::doMain in microseconds, and keeps the worst tick so a hitch can be explained after the fact.
+// Phases can nest.  Time spent in an inner phase isn't counted again in the outer one.  Time spent waiting on the sockets
+// is kept apart from the tick and its phases, so they only show the work done.
+class CTickProfiler
+{
+	public:
+		CTickProfiler()								{ reset(); }
+
+		void beginTick();
+		unsigned long long endTick();
+
+		void beginPhase(int phase);
+		void endPhase();
+
+		// The wait ends at endWait, or when the first socket is handled if that comes sooner.
+		void beginWait();
+		void endWait();
+
+		void reset();
+
+		const CHistogram& getTicks() const			{ return ticks; }
+		const CHistogram& getPhase(int phase) const	{ return phases[phase]; }
+		const CHistogram& getWaits() const			{ return waits; }
+		const STickSample& getLastTick() const		{ return lastTick; }
+		const STickSample& getWorstTick() const		{ return worstTick; }
+
+		// Seconds since the profiler was last reset.
+		double getSeconds() const;
+
+		static const char* getPhaseName(int phase);
+
+	private:
+		struct SPhaseFrame
+		{
+			int phase;
+			std::chrono::steady_clock::time_point start;
+			unsigned long long inner;
+		};
+
+		CHistogram ticks, waits, phases[TICKPHASE_COUNT];
+		STickSample current, lastTick, worstTick;
+		bool ran[TICKPHASE_COUNT];
+		SPhaseFrame stack[TICKPROFILER_DEPTH];
+		int depth;
+		bool waiting;
+		std::chrono::steady_clock::time_point tickStart, waitStart, startTime;
+};
+
+// Times a phase until it goes out of scope.
+class CTickPhase
+{
+	public:
+		CTickPhase(CTickProfiler* pProfiler, int pPhase) : profiler(pProfiler)	{ profiler->beginPhase(pPhase); }
+		~CTickPhase()								{ profiler->endPhase(); }
+
+	private:
+		CTickProfiler* profiler;
+};
+
+#endif
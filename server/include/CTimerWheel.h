@@ -0,0 +1,69 @@
+#ifndef CTIMERWHEEL_H
+#define CTIMERWHEEL_H
+
+#include <functional>
+#include <vector>
+
+class CTimerWheel;
+
+// A timer that lives inside the object it times.  Deleting the object takes the timer out of its wheel.
+class CTimer
+{
+	friend class CTimerWheel;
+
+	public:
+		CTimer();
+		~CTimer();
+
+		CTimer(const CTimer&) = delete;
+		CTimer& operator=(const CTimer&) = delete;
+
+		void setCallback(std::function<void()> pCallback)	{ callback = std::move(pCallback); }
+		void cancel();
+
+		bool isActive() const		{ return wheel != nullptr; }
+
+		// Ticks until the callback runs, or 0 if the timer isn't waiting.
+		int getTicksLeft() const;
+
+	private:
+		void link(CTimer* head);
+		void unlink();
+
+		CTimerWheel* wheel;
+		CTimer *prev, *next;
+		unsigned int expires;
+		std::function<void()> callback;
+};
+
+// Runs timers after a number of ticks.  Each tick only walks the one slot the tick falls in, so
+// thousands of idle timers cost nothing until they expire.
+class CTimerWheel
+{
+	friend class CTimer;
+
+	public:
+		explicit CTimerWheel(unsigned int pSlots = 512);
+		~CTimerWheel();
+
+		CTimerWheel(const CTimerWheel&) = delete;
+		CTimerWheel& operator=(const CTimerWheel&) = delete;
+
+		// Runs the timer's callback pTicks ticks from now.  Scheduling an active timer moves it.
+		// Anything under 1 just cancels the timer.
+		void schedule(CTimer* pTimer, int pTicks);
+
+		// Moves on one tick and runs every timer that expired.
+		void tick();
+
+		unsigned int getTick() const		{ return currentTick; }
+		size_t getTimerCount() const		{ return timerCount; }
+
+	private:
+		std::vector<CTimer> slots;
+		CTimer firing;
+		unsigned int currentTick;
+		size_t timerCount;
+};
+
+#endif
@@ -31,7 +31,7 @@ enum
 
 struct SWordFilterRule
 {
-	SWordFilterRule() : check(0),  wordPosition(0), action(0), precisionPercentage(true), precision(100) {}
+	SWordFilterRule() : check(0),  wordPosition(0), action(0), precisionPercentage(true), precision(100), indexed(false) {}
 
 	int check;
 	CString match;
@@ -40,6 +40,28 @@ struct SWordFilterRule
 	bool precisionPercentage;
 	int precision;
 	CString warnMessage;
+
+	// Set if the rule can only match where one of its keys is found.  Otherwise every position is checked.
+	bool indexed;
+};
+
+// Part of a rule's match that has to show up exactly, ignoring case, wherever the rule matches.
+struct SWordFilterKey
+{
+	unsigned int rule;
+	int offset;
+	int length;
+};
+
+// Aho-Corasick automaton node over the case-folded keys.
+struct SWordFilterNode
+{
+	SWordFilterNode() : fail(0), output(-1) {}
+
+	std::vector<std::pair<char, int>> next;
+	std::vector<int> keys;
+	int fail;
+	int output;
 };
 
 class TServer;
@@ -54,11 +76,27 @@ class CWordFilter
 		int apply(const TPlayer* player, CString& chat, int check);
 
 	private:
+		void compile();
+		void addKey(const CString& match, unsigned int rule, int offset, int length);
+		int getNext(int node, char c) const;
+		void search(const CString& text, int check, std::vector<std::pair<unsigned int, int>>& hits) const;
+
 		TServer* server;
 
 		CString defaultWarnMessage;
 		bool showWordsToRC;
 		std::vector<SWordFilterRule*> rules;
+		std::vector<SWordFilterKey> keys;
+		std::vector<SWordFilterNode> nodes;
+
+		// Rules without keys, in order.  They are checked everywhere.
+		std::vector<unsigned int> unindexedRules;
+
+		// Scratch space for apply(), kept between messages so it doesn't allocate for every chat.
+		std::vector<std::pair<unsigned int, int>> hitBuffer;
+		std::vector<int> candidateBuffer;
+		std::vector<int> compactPosBuffer;
+		CString compactBuffer;
 };
 
 #endif
@@ -237,6 +237,9 @@ class TAccount
 		unsigned char statusMsg;
 		std::unordered_map<std::string, CString> flagList;
 		std::vector<CString> chestList, folderList, weaponList, PMServerList;
+
+		// Last snapshot handed to the account writer.
+		CString lastSavedPath, lastSavedData;
 };
 
 inline CString TAccount::getFlag(const std::string& pFlagName) const
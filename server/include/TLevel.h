@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include "IUtil.h"
 #include "CString.h"
 #include "TLevelBaddy.h"
@@ -18,6 +19,20 @@ class TPlayer;
 class TNPC;
 class TMap;
 
+#ifdef V8NPCSERVER
+// NPCs are bucketed into a grid of 64x64 pixel cells, so hit tests only look at the npcs nearby.
+// Anything outside the level goes into the edge cells.
+#define LEVELGRID_SHIFT		6
+#define LEVELGRID_SIZE		16
+
+struct SLevelGridCells
+{
+	bool operator==(const SLevelGridCells& o) const { return left == o.left && top == o.top && right == o.right && bottom == o.bottom; }
+
+	int left, top, right, bottom;
+};
+#endif
+
 class TLevel
 {
 	public:
@@ -36,6 +51,22 @@ class TLevel
 
 		//! Returns a clone of the level.
 		TLevel* clone();
+
+		//! Checks if the level can be unloaded.  Levels with players or database npcs in them can't be.
+		//! \return True if nothing but the level itself would be lost.
+		bool canUnload() const;
+
+		//! Saves the board changes, items, horses and baddies so they survive the level being unloaded.
+		//! \return The saved state, or an empty string if there is nothing to save.
+		CString getState() const;
+
+		//! Puts back what getState() saved.  Baddies from the level file are replaced by the saved ones.
+		//! \param pState The saved state.
+		void setState(CString& pState);
+
+		//! Adds up the memory the level and the objects in it use.  Allocator overhead isn't counted.
+		//! \return The size in bytes.
+		size_t getMemoryUsage() const;
 		
 		// get crafted packets
 		CString getBaddyPacket(int clientVersion = CLVER_2_17);
@@ -68,6 +99,10 @@ class TLevel
 		//! \return The modified time of the level when it was first loaded from the disk.
 		time_t getModTime() const						{ return modTime; }
 
+		//! Gets the last time the level was looked up or a player entered or left it.
+		//! \return The time the level was last used.
+		time_t getLastUsed() const						{ return lastUsed; }
+
 		//! Gets a vector full of all the level chests.
 		//! \return The level chests.
 		std::vector<TLevelChest *>* getLevelChests()	{ return &levelChests; }
@@ -192,9 +227,9 @@ class TLevel
 		//! \param npc The NPC to remove.
 		void removeNPC(TNPC* npc);
 
-		//! Does special events that should happen every second.
-		//! \return Currently, it always returns true.
-		bool doTimedEvents();
+		//! Respawns a baddy, or moves it on from dying or being hurt.  Called by the baddy's timer.
+		//! \param baddy The baddy whose timer ran out.
+		void doBaddyTimeout(TLevelBaddy* baddy);
 
 		bool isOnWall(double pX, double pY);
 		bool isOnWater(double pX, double pY);
@@ -204,6 +239,10 @@ class TLevel
 		TNPC *isOnNPC(int pX, int pY, bool checkEventFlag = false);
 		void sendChatToLevel(const TPlayer *player, const CString& message);
 
+		//! Moves an NPC to the right cells of the hit-test grid after its position or size changed.
+		//! \param npc The NPC that changed.
+		void updateNPCBounds(TNPC *npc);
+
 		inline IScriptWrapped<TLevel> * getScriptObject() const {
 			return _scriptObject;
 		}
@@ -223,8 +262,13 @@ class TLevel
 		bool loadZelda(const CString& pLevelName);
 		bool loadNW(const CString& pLevelName);
 
+		// timer callbacks
+		void doBoardChangeTimeout(TLevelBoardChange* change);
+		void doItemTimeout(TLevelItem* item);
+		void doHorseTimeout(TLevelHorse* horse);
+
 		TServer* server;
-		time_t modTime;
+		time_t modTime, lastUsed;
 		bool levelSpar;
 		bool levelSingleplayer;
 		short levelTiles[4096];
@@ -241,7 +285,12 @@ class TLevel
 		std::vector<TPlayer *> levelPlayerList;
 
 #ifdef V8NPCSERVER
+		void addNPCBounds(TNPC *npc);
+		void removeNPCBounds(TNPC *npc);
+
 		IScriptWrapped<TLevel> *_scriptObject;
+		std::vector<TNPC *> npcGrid[LEVELGRID_SIZE * LEVELGRID_SIZE];
+		std::unordered_map<TNPC *, SLevelGridCells> npcGridCells;
 #endif
 };
 
@@ -3,7 +3,7 @@
 
 #include <vector>
 #include "CString.h"
-#include "CTimeout.h"
+#include "CTimerWheel.h"
 
 // Baddy props
 enum {
@@ -57,6 +57,7 @@ class TLevelBaddy
 		float getY() const						{ return y; }
 		float getStartX() const					{ return startX; }
 		float getStartY() const					{ return startY; }
+		bool getRespawn() const					{ return respawn; }
 		CString getProp(const int propId, int clientVersion = CLVER_2_17) const;
 		CString getProps(int clientVersion = CLVER_2_17) const;
 
@@ -65,7 +66,7 @@ class TLevelBaddy
 		void setRespawn(const bool pRespawn)	{ respawn = pRespawn; }
 		void setId(const char pId)				{ id = pId; }
 
-		CTimeout timeout;
+		CTimer timer;
 
 	private:
 		TLevel* level;
@@ -3,7 +3,7 @@
 
 #include <vector>
 #include <time.h>
-#include "CTimeout.h"
+#include "CTimerWheel.h"
 #include "CString.h"
 
 class TLevelBoardChange
@@ -11,9 +11,9 @@ class TLevelBoardChange
 	public:
 		// constructor - destructor
 		TLevelBoardChange(const int pX, const int pY, const int pWidth, const int pHeight,
-			const CString& pTiles, const CString& pOldTiles, const int respawn = 15)
+			const CString& pTiles, const CString& pOldTiles)
 			: x(pX), y(pY), width(pWidth), height(pHeight),
-			tiles(pTiles), oldTiles(pOldTiles), modTime(time(0)) { timeout.setTimeout(respawn); }
+			tiles(pTiles), oldTiles(pOldTiles), modTime(time(0)) { }
 
 		// functions
 		CString getBoardStr(const CString ignore = "") const;
@@ -25,12 +25,13 @@ class TLevelBoardChange
 		int getWidth() const			{ return width; }
 		int getHeight() const			{ return height; }
 		CString getTiles() const		{ return tiles; }
+		CString getOldTiles() const		{ return oldTiles; }
 		time_t getModTime() const		{ return modTime; }
 
 		// set private variables
 		void setModTime(time_t ntime)	{ modTime = ntime; }
 
-		CTimeout timeout;
+		CTimer timer;
 
 	private:
 		int x, y, width, height;
@@ -2,14 +2,13 @@
 #define TLEVELHORSE_H
 
 #include "CString.h"
-#include "CTimeout.h"
+#include "CTimerWheel.h"
 
-class TServer;
 class TLevelHorse
 {
 	public:
 		// constructor - destructor
-		TLevelHorse(TServer* server, const CString& pImage, float pX, float pY, char pDir = 0, char pBushes = 0);
+		TLevelHorse(const CString& pImage, float pX, float pY, char pDir = 0, char pBushes = 0);
 
 		CString getHorseStr() const;
 
@@ -20,7 +19,7 @@ class TLevelHorse
 		char getDir() const			{ return dir; }
 		char getBushes() const		{ return bushes; }
 
-		CTimeout timeout;
+		CTimer timer;
 
 	private:
 		CString image;
@@ -2,14 +2,14 @@
 #define TLEVELITEM_H
 
 #include <time.h>
-#include "CTimeout.h"
+#include "CTimerWheel.h"
 #include "CString.h"
 
 class TPlayer;
 class TLevelItem
 {
 	public:
-		TLevelItem(float pX, float pY, signed char pItem) : x(pX), y(pY), item(pItem), modTime(time(0)) { timeout.setTimeout(10); }
+		TLevelItem(float pX, float pY, signed char pItem) : x(pX), y(pY), item(pItem), modTime(time(0)) { }
 
 		// Return the packet to be sent to the player.
 		CString getItemStr() const;
@@ -26,7 +26,7 @@ class TLevelItem
 		signed char getItem() const	{ return item; }
 		time_t getModTime() const	{ return modTime; }
 
-		CTimeout timeout;
+		CTimer timer;
 
 	private:
 		float x;
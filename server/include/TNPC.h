@@ -6,6 +6,8 @@
 #include "IUtil.h"
 
 #ifdef V8NPCSERVER
+#include <chrono>
+#include <functional>
 #include <queue>
 #include <unordered_map>
 #include <unordered_set>
@@ -170,11 +172,12 @@ class TNPC
 
 		// set functions
 		void setId(unsigned int pId)			{ id = pId; }
+		void setListIndex(size_t pIndex)		{ listIndex = pIndex; }
 		void setLevel(TLevel* pLevel)			{ level = pLevel; }
-		void setX(float val)					{ x = val; x2 = (int)(16 * val); }
-		void setY(float val)					{ y = val; y2 = (int)(16 * val); }
-		void setHeight(int val)					{ height = val; }
-		void setWidth(int val)					{ width = val; }
+		void setX(float val)					{ x = val; x2 = (int)(16 * val); updateLevelBounds(); }
+		void setY(float val)					{ y = val; y2 = (int)(16 * val); updateLevelBounds(); }
+		void setHeight(int val)					{ height = val; updateLevelBounds(); }
+		void setWidth(int val)					{ width = val; updateLevelBounds(); }
 		void setRupees(int val)					{ rupees = val; }
 		void setName(const std::string& name)	{ npcName = name; }
 		void setNickname(const CString& nick)	{ nickName = nick; }
@@ -189,6 +192,7 @@ class TNPC
 
 		// get functions
 		unsigned int getId() const				{ return id; }
+		size_t getListIndex() const				{ return listIndex; }
 		bool isLevelNPC() const					{ return levelNPC; }
 		float getX() const						{ return x; }
 		float getY() const						{ return y; }
@@ -233,6 +237,7 @@ class TNPC
 		ScriptExecutionContext * getExecutionContext();
 		IScriptWrapped<TNPC> * getScriptObject() const;
 		void setScriptObject(IScriptWrapped<TNPC> *object);
+		const std::string& getServerScriptHash() const	{ return serverScriptHash; }
 
 		// -- flags
 		CString getFlag(const std::string& pFlagName) const;
@@ -255,6 +260,10 @@ class TNPC
 		bool loadNPC(const CString& fileName);
 		void saveNPC();
 
+		// Compiles a new script off the game thread, and swaps it in on the tick it is ready.  Only the newest
+		// queued script gets swapped in, the callback runs after it is.
+		void queueScriptCode(const CString& pScript, std::function<void()> callback);
+
 		void queueNpcAction(const std::string& action, TPlayer *player = 0, bool registerAction = true);
 		void queueNpcTrigger(const std::string& action, const std::string& data);
 
@@ -268,10 +277,20 @@ class TNPC
 		bool runScriptTimer();
 		bool runScriptEvents();
 
+		// Level npcs in levels nobody can see don't run their script until somebody can, and their
+		// timers stop while the level is empty.
+		bool isScriptDormant() const;
+		void wakeScript();
+		void updateScriptSleep();
+		void releaseScript();
+		bool hasTimerUpdates() const;
+
 		CString getVariableDump();
 #endif
 
 	private:
+		void updateLevelBounds();
+
 		bool blockPositionUpdates;
 		bool levelNPC;
 		time_t modTime[NPCPROP_COUNT];
@@ -279,6 +298,7 @@ class TNPC
 		int x2, y2;
 		unsigned char gmaplevelx, gmaplevely;
 		unsigned int id;
+		size_t listIndex;		// Where we are in the server's npc list.
 		int rupees;
 		unsigned char darts, bombs, glovePower, bombPower, swordPower, shieldPower;
 		unsigned char visFlags, blockFlags, sprite, colors[5], power, ap;
@@ -296,17 +316,25 @@ class TNPC
 		int width, height;
 
 #ifdef V8NPCSERVER
-        bool hasTimerUpdates() const;
+        bool canScriptSleep() const;
+        void executeScript();
+        void suspendScriptTimers();
+        void resumeScriptTimers();
         void freeScriptResources();
+        void disableScript();
         void testTouch();
 
 		std::map<std::string, std::string> classMap;
 		std::unordered_set<unsigned char> propModified;
+		std::string serverScriptHash;
 
 		// Defaults
 		CString origImage, origLevel;
 		float origX, origY;
 
+		// Props of a level npc as the level file left them, before its script ran
+		CString origProps;
+
 		// npc-server
 		bool canWarp;
 		bool npcDeleteRequested;
@@ -318,6 +346,10 @@ class TNPC
 		ScriptExecutionContext _scriptExecutionContext;
 		std::unordered_map<std::string, IScriptFunction *> _triggerActions;
 		std::vector<ScriptEventTimer> _scriptTimers;
+		bool _scriptDormant;
+		bool _scriptTimersSuspended;
+		unsigned int _scriptUpload;
+		std::chrono::steady_clock::time_point _scriptSuspendTime;
 #endif
 };
 
@@ -457,8 +489,8 @@ inline void TNPC::registerNpcUpdates()
 	scriptEngine->RegisterNpcUpdate(this);
 }
 
-inline void TNPC::scheduleEvent(unsigned int timeout, ScriptAction *action) {
-    _scriptTimers.push_back({action, timeout});
+inline bool TNPC::isScriptDormant() const {
+	return _scriptDormant;
 }
 
 #endif
@@ -7,6 +7,7 @@
 #include <vector>
 #include "IEnums.h"
 #include "CFileQueue.h"
+#include "CReplaySink.h"
 #include "TAccount.h"
 #include "CEncryption.h"
 #include "CSocket.h"
@@ -54,6 +55,7 @@ class TPlayer : public TAccount, public CSocketStub
 		TMap* getMap()				{ return pmap; }
 		CString getGroup()			{ return levelGroup; }
 		int getId() const;
+		size_t getListIndex() const		{ return listIndex; }
 		time_t getLastData() const		{ return lastData; }
 		CString getGuild() const		{ return guild; }
 		int getVersion() const			{ return versionID; }
@@ -66,6 +68,7 @@ class TPlayer : public TAccount, public CSocketStub
 		void setChat(const CString& pChat);
 		void setNick(const CString& pNickName, bool force = false);
 		void setId(int pId);
+		void setListIndex(size_t pIndex)	{ listIndex = pIndex; }
 		void setLoaded(bool loaded)		{ this->loaded = loaded; }
 		void setGroup(CString group)	{ levelGroup = group; }
 		void setFlag(const std::string& pFlagName, const CString& pFlagValue, bool sendToPlayer = false, bool sendToNPCServer = false);
@@ -91,13 +94,22 @@ class TPlayer : public TAccount, public CSocketStub
 
 		// Socket-Functions
 		bool doMain();
-		void sendPacket(CString pPacket, bool appendNL = true);
+		// Raw packets are the data after a PLO_RAWDATA, sent on their own and counted as one packet.
+		void sendPacket(CString pPacket, bool appendNL = true, bool rawPacket = false);
 		bool sendFile(const CString& pFile);
 		bool sendFile(const CString& pPath, const CString& pFile);
 
+		// Replayed players have no socket.  Their packets come out of a packet trace, and what we send them is
+		// compressed and encrypted like it would be for a client, then dropped.
+		void setReplay(const CString& pIp);
+		bool isReplay() const			{ return replay; }
+		bool replayPacket(CString& pPacket);
+		bool replayData(const char* pData, unsigned int pSize);
+
 		// Type of player
 		bool isAdminIp();
 		bool isStaff();
+		bool isLocalBotAccount();
 		bool isNC()	const				{ return (type & PLTYPE_ANYNC) ? true : false; }
 		bool isRC() const				{ return (type & PLTYPE_ANYRC) ? true : false; }
 		bool isClient() const			{ return (type & PLTYPE_ANYCLIENT) ? true : false; }
@@ -290,6 +302,7 @@ class TPlayer : public TAccount, public CSocketStub
 
 		// Packet functions.
 		bool parsePacket(CString& pPacket);
+		bool handlePacket(unsigned char id, CString& pPacket);
 		void decryptPacket(CString& pPacket);
 
 		// Collision detection stuff.
@@ -302,6 +315,10 @@ class TPlayer : public TAccount, public CSocketStub
 		// Socket Variables
 		CSocket *playerSock;
 		CString rBuffer;
+		bool replay, localLogin;
+
+		// Where we are in the server's player list.
+		size_t listIndex;
 
 		// Encryption
 		unsigned char key;
@@ -337,8 +354,9 @@ class TPlayer : public TAccount, public CSocketStub
 
 		CString grExecParameterList;
 
-		// File queue.
+		// File queue.  Replayed players send into the sink instead.
 		CFileQueue fileQueue;
+		CReplaySink *replaySink;
 
 #ifdef V8NPCSERVER
 		bool _processRemoval;
@@ -2,6 +2,7 @@
 #define TSERVER_H
 
 #include <vector>
+#include <deque>
 #include <map>
 #include <unordered_map>
 #include <set>
@@ -21,6 +22,13 @@
 #include "CSocket.h"
 #include "CTranslationManager.h"
 #include "CWordFilter.h"
+#include "CAccountIndex.h"
+#include "CAccountSaver.h"
+#include "CMetricsServer.h"
+#include "CPacketStats.h"
+#include "CPacketTrace.h"
+#include "CTickProfiler.h"
+#include "CTimerWheel.h"
 #include "TServerList.h"
 
 #ifdef UPNP
@@ -76,6 +84,16 @@ class TServer : public CSocketStub
 
 		int init(const CString& serverip = "", const CString& serverport = "", const CString& localip = "", const CString& serverinterface = "");
 		bool doMain();
+		void cleanupDeletedPlayers();
+
+		// Replay mode runs without any sockets.  Set it before init().
+		void setReplay(bool pReplay)					{ replay = pReplay; }
+		bool isReplay() const							{ return replay; }
+
+		// Replays run on the trace's clock, in milliseconds since it started, so timed events line up on every run.
+		void setReplayTime(unsigned int pTime)			{ replayTime = pTime; }
+		void addReplayBytesSent(unsigned long long pBytes)	{ replayBytesSent += pBytes; }
+		unsigned long long getReplayBytesSent() const	{ return replayBytesSent; }
 
 		// Server Management
 		int loadConfigFiles();
@@ -99,6 +117,7 @@ class TServer : public CSocketStub
 		void loadFolderConfig();
 
 		void saveServerFlags();
+		void compactServerFlags();
 		void saveWeapons();
 #ifdef V8NPCSERVER
 		void saveNpcs();
@@ -112,6 +131,13 @@ class TServer : public CSocketStub
 		const CString& getName()						{ return name; }
 		CFileSystem* getFileSystem(int c = 0)			{ return &(filesystem[c]); }
 		CFileSystem* getAccountsFileSystem()			{ return &filesystem_accounts; }
+		CAccountIndex* getAccountIndex()				{ return &accountIndex; }
+		CAccountSaver* getAccountSaver()				{ return &accountSaver; }
+		CMetricsServer* getMetrics()					{ return &metrics; }
+		CPacketStats* getPacketStats()					{ return &packetStats; }
+		CPacketTrace* getPacketTrace()					{ return &packetTrace; }
+		CTickProfiler* getTickProfiler()				{ return &tickProfiler; }
+		CTimerWheel* getTimerWheel()					{ return &timerWheel; }
 		CLog& getNPCLog()								{ return npclog; }
 		CLog& getServerLog()							{ return serverlog; }
 		CLog& getRCLog()								{ return rclog; }
@@ -138,9 +164,21 @@ class TServer : public CSocketStub
 		std::vector<TLevel *>* getLevelList()			{ return &levelList; }
 		std::vector<TMap *>* getMapList()				{ return &mapList; }
 		std::vector<CString>* getStatusList()			{ return &statusList; }
+		const CString& getStatusListPacket() const		{ return mStatusListPacket; }
+		const CString& getStaffGuildsPacket() const		{ return mStaffGuildsPacket; }
+		const CString& getLoginMapPacket() const		{ return mLoginMapPacket; }
+		size_t getLoginQueueSize() const				{ return loginQueue.size(); }
+		const std::deque<std::pair<TPlayer *, size_t> >* getLoginQueue() const	{ return &loginQueue; }
 		std::vector<CString>* getAllowedVersions()		{ return &allowedVersions; }
 		std::map<CString, std::map<CString, TLevel*> >* getGroupLevels()	{ return &groupLevels; }
 
+		// Idle level unloading.  The memory use is from the last check for idle levels.
+		size_t getLevelMemoryUsage() const				{ return levelMemoryUsage; }
+		size_t getLevelStateCount() const				{ return levelStates.size(); }
+		size_t getLevelStateBytes() const				{ return levelStateBytes; }
+		unsigned long long getUnloadedLevelCount() const	{ return unloadedLevelCount; }
+		void restoreLevelState(TLevel* pLevel);
+
 #ifdef V8NPCSERVER
 		CScriptEngine * getScriptEngine() { return &mScriptEngine; }
 		int getNCPort() const { return mNCPort; }
@@ -172,10 +210,17 @@ class TServer : public CSocketStub
 		bool deleteClass(const std::string& className);
 		bool hasClass(const std::string& className) const;
 		std::string getClass(const std::string& className) const;
+#ifdef V8NPCSERVER
+		std::string getClassHash(const std::string& className) const;
+		unsigned int startWeaponUpload(const CString& weaponName);
+		bool isLatestWeaponUpload(const CString& weaponName, unsigned int upload) const;
+#endif
 		void updateClass(const std::string& className, const std::string& classCode);
 		bool isIpBanned(const CString& ip);
 		void logToFile(const std::string& fileName, const std::string& message);
 
+		const CString& getServerFlagsPacket();
+		void clearFlags();
 		bool deleteFlag(const std::string& pFlagName, bool pSendToPlayers = true);
 		bool setFlag(CString pFlag, bool pSendToPlayers = true);
 		bool setFlag(const std::string& pFlagName, const CString& pFlagValue, bool pSendToPlayers = true);
@@ -195,6 +240,7 @@ class TServer : public CSocketStub
 		bool addPlayer(TPlayer *player, unsigned int id = UINT_MAX);
 		bool deletePlayer(TPlayer* player);
 		void playerLoggedIn(TPlayer *player);
+		void queueLogin(TPlayer *player);
 
 		// Translation Management
 		bool TS_Load(const CString& pLanguage, const CString& pFileName);
@@ -210,10 +256,28 @@ class TServer : public CSocketStub
 
 	private:
 		bool doTimedEvents();
+		void journalFlag(const CString& pEntry);
+		void buildLoginPackets();
 		void acceptSock(CSocket& pSocket);
-		void cleanupDeletedPlayers();
+		void openPacketTrace();
+		void loginPlayer(TPlayer *player);
+		void processLoginQueue();
+		void dropDisconnectedLogins();
+		void sendLoginQueuePositions();
+		void reportSlowTick();
+		void unloadIdleLevels();
+#ifdef V8NPCSERVER
+		void releaseIdleScripts();
+#endif
+
+		// Id and list bookkeeping for players and npcs.
+		void growPlayerIds(size_t size);
+		void growNPCIds(size_t size);
+		void freePlayerId(TPlayer* player);
+		unsigned int getFreeNPCId();
+		void addToNPCList(TNPC* npc);
 
-		bool doRestart;
+		bool doRestart, replay;
 
 		CFileSystem filesystem[FS_COUNT], filesystem_accounts;
 		CLog npclog, rclog, serverlog; //("logs/npclog|rclog|serverlog.txt");
@@ -226,12 +290,25 @@ class TServer : public CSocketStub
 		CString allowedVersionString, name, servermessage, serverpath;
 		CTranslationManager mTranslationManager;
 		CWordFilter wordFilter;
+		CAccountIndex accountIndex;
+		CAccountSaver accountSaver;
+		CPacketStats packetStats;
+		CPacketTrace packetTrace;
+		CTickProfiler tickProfiler;
+		CTimerWheel timerWheel;
+		CMetricsServer metrics;
 		CString overrideIP, overrideLocalIP, overridePort, overrideInterface;
 
 		std::unordered_map<std::string, CString> mServerFlags;
+		CString mServerFlagsJournal, mServerFlagsPacket;
+		int mServerFlagsJournalCount, mServerFlagsPacketSize;
+		CString mStatusListPacket, mStaffGuildsPacket, mLoginMapPacket;
 		std::map<CString, TWeapon *> weaponList;
 		std::map<CString, std::map<CString, TLevel*> > groupLevels;
 		std::unordered_map<std::string, std::string> classList;
+#ifdef V8NPCSERVER
+		std::unordered_map<std::string, std::string> classHashes;
+#endif
 		std::unordered_map<std::string, TNPC *> npcNameList;
 		std::vector<CString> allowedVersions, foldersConfig, ipBans, statusList;
 		std::vector<TLevel *> levelList;
@@ -239,15 +316,36 @@ class TServer : public CSocketStub
 		std::vector<TNPC *> npcIds, npcList;
 		std::vector<TPlayer *> playerIds, playerList;
 
+		// Ids given back by deleted players and npcs.  Kept as min-heaps so the lowest id gets reused first.
+		std::vector<unsigned int> freePlayerIds, freeNPCIds;
+
 		std::set<TPlayer *> deletedPlayers;
 
+		// Verified players waiting to be logged in, and the queue position they were last told.
+		std::deque<std::pair<TPlayer *, size_t> > loginQueue;
+
 		TServerList serverlist;
-		std::chrono::high_resolution_clock::time_point lastTimer, lastNWTimer, last1mTimer, last5mTimer, last3mTimer;
+		std::chrono::high_resolution_clock::time_point lastTimer, lastNWTimer, last1mTimer, last5mTimer, last3mTimer, replayStart;
+		unsigned int replayTime;
+		unsigned long long replayBytesSent;
+
+		// Ticks over slowTickTime milliseconds get logged, at most once every few seconds.
+		int slowTickTime, slowTicks;
+		std::chrono::steady_clock::time_point lastSlowTickReport;
+
+		// What idle levels had in them when they were unloaded, by lower case level name.
+		std::unordered_map<std::string, CString> levelStates;
+		size_t levelStateBytes, levelMemoryUsage;
+		unsigned long long unloadedLevelCount;
 #ifdef V8NPCSERVER
 		CScriptEngine mScriptEngine;
 		int mNCPort;
 		TPlayer *mNpcServer;
 		TNPC *mPmHandlerNpc;
+
+		// The newest upload of each weapon, uploads compile off the game thread and can finish out of order.
+		std::unordered_map<std::string, unsigned int> weaponUploads;
+		unsigned int weaponUploadCount;
 #endif
 
 #ifdef UPNP
@@ -280,6 +378,27 @@ inline std::string TServer::getClass(const std::string& className) const
 
 #ifdef V8NPCSERVER
 
+inline std::string TServer::getClassHash(const std::string& className) const
+{
+	auto hashIter = classHashes.find(className);
+	if (hashIter != classHashes.end())
+		return hashIter->second;
+
+	return std::string();
+}
+
+inline unsigned int TServer::startWeaponUpload(const CString& weaponName)
+{
+	weaponUploads[weaponName.text()] = ++weaponUploadCount;
+	return weaponUploadCount;
+}
+
+inline bool TServer::isLatestWeaponUpload(const CString& weaponName, unsigned int upload) const
+{
+	auto uploadIter = weaponUploads.find(weaponName.text());
+	return uploadIter != weaponUploads.end() && uploadIter->second == upload;
+}
+
 inline TNPC * TServer::getNPCByName(const std::string& name) const
 {
 	auto npcIter = npcNameList.find(name);
@@ -6,6 +6,7 @@
 #include "CString.h"
 
 #ifdef V8NPCSERVER
+#include <functional>
 #include <string>
 #include "ScriptBindings.h"
 #include "ScriptExecutionContext.h"
@@ -29,18 +30,21 @@ class TWeapon
 		static TWeapon* loadWeapon(const CString& pWeapon, TServer* server);
 
 		// Functions -> Inline Get-Functions
-		CString getWeaponPacket() const;
+		const CString& getWeaponPacket() const;
 		inline bool isDefault() const					{ return (mWeaponDefault != -1); }
 		inline signed char getWeaponId()				{ return mWeaponDefault; }
 		inline const CString& getImage() const			{ return mWeaponImage; }
 		inline const CString& getName() const			{ return mWeaponName; }
 		inline const CString& getClientScript() const	{ return mScriptClient; }
 		inline const CString& getServerScript() const	{ return mScriptServer; }
+#ifdef V8NPCSERVER
+		inline const std::string& getServerScriptHash() const	{ return mScriptServerHash; }
+#endif
 		inline const CString& getFullScript() const		{ return mWeaponScript; }
 		inline time_t getModTime() const				{ return mModTime; }
 
 		// Functions -> Set Variables
-		void setImage(const CString& pImage)			{ mWeaponImage = pImage; }
+		void setImage(const CString& pImage)			{ mWeaponImage = pImage; mWeaponPacket.clear(); }
 		void setFullScript(const CString& pScript)		{ mWeaponScript = pScript; }
 		void setModTime(time_t pModTime)				{ mModTime = pModTime; }
 
@@ -49,13 +53,17 @@ class TWeapon
 		IScriptWrapped<TWeapon> * getScriptObject() const;
 		
 		void freeScriptResources();
+
+		// Compiles the server part of a weapon script off the game thread.  The callback runs on the tick it's ready.
+		static void precompileScript(TServer *server, const CString& pCode, std::function<void(bool)> callback);
+
 		void queueWeaponAction(TPlayer *player, const std::string& args);
-		void runScriptEvents();
+		bool runScriptEvents();
 		void setScriptObject(IScriptWrapped<TWeapon> *object);
 #endif
 	protected:
 		void setClientScript(const CString& pScript);
-		void setServerScript(const CString& pScript) { mScriptServer = pScript; }
+		void setServerScript(const CString& pScript);
 
 		// Varaibles -> Weapon Data
 		signed char mWeaponDefault;
@@ -65,8 +73,12 @@ class TWeapon
 		time_t mModTime;
 		TServer *server;
 
+		// Built on first use and cleared whenever the image or script changes.
+		mutable CString mWeaponPacket;
+
 	private:
 #ifdef V8NPCSERVER
+		std::string mScriptServerHash;
 		IScriptWrapped<TWeapon> *_scriptObject;
 		ScriptExecutionContext _scriptExecutionContext;
 #endif
@@ -82,10 +94,6 @@ inline IScriptWrapped<TWeapon> * TWeapon::getScriptObject() const {
 	return _scriptObject;
 }
 
-inline void TWeapon::runScriptEvents() {
-	_scriptExecutionContext.runExecution();
-}
-
 inline void TWeapon::setScriptObject(IScriptWrapped<TWeapon> *object) {
 	_scriptObject = object;
 }
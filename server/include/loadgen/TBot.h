@@ -0,0 +1,80 @@
+#ifndef TBOT_H
+#define TBOT_H
+
+#include <chrono>
+#include <deque>
+#include <random>
+#include "CEncryption.h"
+#include "CFileQueue.h"
+#include "CSocket.h"
+#include "CString.h"
+
+enum
+{
+	BOTSTATE_WAITING		= 0,
+	BOTSTATE_LOGGINGIN		= 1,
+	BOTSTATE_PLAYING		= 2,
+	BOTSTATE_DISCONNECTED	= 3,
+};
+
+class TBotWorker;
+class TLoadGen;
+
+// A headless client.  Logs in with the 2.22+ (gen 5) protocol and acts on a timer.
+class TBot : public CSocketStub
+{
+	public:
+		// Required by CSocketStub.
+		bool onRecv();
+		bool onSend();
+		bool onRegister()			{ return true; }
+		void onUnregister();
+		SOCKET getSocketHandle()	{ return sock.getHandle(); }
+		bool canRecv();
+		bool canSend()				{ return fileQueue.canSend(); }
+
+		TBot(TBotWorker* pWorker, const CString& pAccountName, unsigned int seed);
+
+		bool connect();
+		void disconnect();
+		void doTimedEvents(std::chrono::steady_clock::time_point now);
+
+		int getState() const		{ return state; }
+
+	private:
+		bool doMain();
+		bool parsePacket(CString& pPacket);
+		void decryptPacket(CString& pPacket);
+		void sendPacket(CString pPacket);
+
+		void doAction();
+		void walk();
+		void chat();
+		void warp();
+		void wantFile();
+
+		void addLatency(int type, std::chrono::steady_clock::time_point start);
+
+		TBotWorker* worker;
+		TLoadGen* loadGen;
+		CString accountName;
+		CSocket sock;
+		CFileQueue fileQueue;
+		CEncryption in_codec;
+		CString rBuffer;
+		bool nextIsRaw;
+		int rawPacketSize;
+		bool largeFile;
+
+		int state;
+		float x, y;
+		int direction, steps;
+		std::mt19937 random;
+		std::discrete_distribution<int> actionMix;
+		std::chrono::steady_clock::time_point connectTime, nextAction;
+
+		// Requests still waiting on the server, oldest first.
+		std::deque<std::chrono::steady_clock::time_point> pendingWarps, pendingFiles;
+};
+
+#endif
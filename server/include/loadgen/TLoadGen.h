@@ -0,0 +1,124 @@
+#ifndef TLOADGEN_H
+#define TLOADGEN_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CString.h"
+#include "CSocket.h"
+
+// What a bot does each time it acts.
+enum
+{
+	BOTACTION_WALK		= 0,
+	BOTACTION_CHAT		= 1,
+	BOTACTION_WARP		= 2,
+	BOTACTION_FILE		= 3,
+	BOTACTION_IDLE		= 4,
+};
+#define BOTACTION_COUNT		5
+
+// Round trips timed by the bots.
+enum
+{
+	BOTLATENCY_LOGIN	= 0,
+	BOTLATENCY_WARP		= 1,
+	BOTLATENCY_FILE		= 2,
+};
+#define BOTLATENCY_COUNT	3
+
+struct SLoadGenOptions
+{
+	SLoadGenOptions();
+
+	CString host, port;
+	CString version;
+	CString accountPrefix;
+	CString accountsPath;
+	CString startLevel;
+	std::vector<CString> levels;
+	std::vector<CString> files;
+	std::vector<CString> chats;
+
+	int bots;
+	int rate;				// Bots connected per second.
+	int duration;			// Seconds, 0 runs until stopped.
+	int interval;			// Milliseconds between bot actions.
+	int reportInterval;		// Seconds between reports.
+	int threads;
+	int mix[BOTACTION_COUNT];
+};
+
+// Counters are totals since the last report.  Latencies are in milliseconds.
+struct SLoadGenStats
+{
+	SLoadGenStats() { clear(); }
+
+	void clear();
+	void merge(SLoadGenStats& other);
+
+	int online;
+	unsigned int connects, logins, failures, disconnects;
+	unsigned long long packetsIn, packetsOut, bytesIn;
+	unsigned int actions[BOTACTION_COUNT];
+	std::vector<double> latency[BOTLATENCY_COUNT];
+};
+
+class TBot;
+class TLoadGen;
+
+// Runs a share of the bots on its own thread.  select() can only watch so many sockets, so the bots are spread out.
+class TBotWorker
+{
+	public:
+		TBotWorker(TLoadGen* pLoadGen) : loadGen(pLoadGen) {}
+		~TBotWorker();
+
+		// Allows std::thread to work.
+		void operator()();
+
+		void addBot(TBot* bot, std::chrono::steady_clock::time_point connectTime);
+		void takeStats(SLoadGenStats& stats);
+
+		TLoadGen* getLoadGen()					{ return loadGen; }
+		CSocketManager* getSocketManager()		{ return &sockManager; }
+		SLoadGenStats& getStats()				{ return stats; }
+
+	private:
+		TLoadGen* loadGen;
+		CSocketManager sockManager;
+		std::vector<std::pair<TBot*, std::chrono::steady_clock::time_point>> bots;
+		SLoadGenStats stats;
+		std::mutex statsMutex;
+};
+
+class TLoadGen
+{
+	public:
+		TLoadGen(const SLoadGenOptions& pOptions) : options(pOptions), running(false) {}
+		~TLoadGen();
+
+		int run();
+		void stop()								{ running = false; }
+		bool isRunning() const					{ return running; }
+
+		const SLoadGenOptions& getOptions() const	{ return options; }
+		CString getAccountName(int bot) const;
+
+	private:
+		void writeAccounts();
+		void report(SLoadGenStats& stats, double seconds, bool final);
+
+		SLoadGenOptions options;
+		std::atomic_bool running;
+		std::vector<TBotWorker*> workers;
+		std::vector<std::thread> workerThreads;
+		std::chrono::steady_clock::time_point startTime;
+
+		// Totals over the whole run.
+		SLoadGenStats totals;
+};
+
+#endif
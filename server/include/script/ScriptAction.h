@@ -2,14 +2,50 @@
 
 #include <string>
 #include "ScriptArguments.h"
+#include "ScriptPool.h"
 
 class IScriptFunction;
 
+// Actions keep a pointer to their name instead of a copy, so every action is named by one of these.
+namespace ScriptActionName
+{
+	inline const std::string NpcCreated = "npc.created";
+	inline const std::string NpcTimeout = "npc.timeout";
+	inline const std::string NpcWarped = "npc.warped";
+	inline const std::string NpcTrigger = "npc.trigger";
+	inline const std::string NpcPlayerEnters = "npc.playerenters";
+	inline const std::string NpcPlayerLeaves = "npc.playerleaves";
+	inline const std::string NpcPlayerChats = "npc.playerchats";
+	inline const std::string NpcPlayerLogin = "npc.playerlogin";
+	inline const std::string NpcPlayerLogout = "npc.playerlogout";
+	inline const std::string NpcPlayerTouchsMe = "npc.playertouchsme";
+	inline const std::string WeaponCreated = "weapon.created";
+	inline const std::string WeaponServerside = "weapon.serverside";
+	inline const std::string NpcServerPlayerPM = "npcserver.playerpm";
+	inline const std::string ScheduleEvent = "_scheduleevent";
+};
+
+namespace detail
+{
+	template<typename T> inline const void * SubjectPointer(const T& val) { return nullptr; }
+	template<typename T> inline const void * SubjectPointer(IScriptWrapped<T> * const& val) { return val; }
+
+	// The object an event is about, which is the wrapped object passed after the script object itself
+	template<typename Self>
+	inline const void * ActionSubject(const Self& self) { return nullptr; }
+
+	template<typename Self, typename Subject, typename... Rest>
+	inline const void * ActionSubject(const Self& self, const Subject& subject, const Rest&... rest) {
+		return SubjectPointer(subject);
+	}
+};
+
 class ScriptAction
 {
 public:
-	explicit ScriptAction(IScriptFunction *function, IScriptArguments *args, const std::string& action = "")
-		: _function(function), _args(args), _action(action) {
+	// The name has to outlive the action, see ScriptActionName
+	explicit ScriptAction(IScriptFunction *function, IScriptArguments *args, const std::string& action)
+		: _action(&action), _args(args), _function(function), _subject(nullptr) {
 		_function->increaseReference();
 	}
 	
@@ -29,9 +65,12 @@ public:
 	}
 
 	inline const std::string& getAction() const {
-		return _action;
+		return *_action;
 	}
 
+	// Actions are created for every event, keep the memory around
+	SCRIPTPOOL_ALLOCATOR(ScriptAction)
+
 	inline IScriptArguments * getArguments() const {
 		return _args;
 	}
@@ -40,8 +79,18 @@ public:
 		return _function;
 	}
 
+	// Used to tell apart events of the same type, such as touches from different players
+	inline const void * getSubject() const {
+		return _subject;
+	}
+
+	inline void setSubject(const void *subject) {
+		_subject = subject;
+	}
+
 protected:
-	std::string _action;
+	const std::string *_action;
 	IScriptArguments *_args;
 	IScriptFunction *_function;
+	const void *_subject;
 };
@@ -8,6 +8,16 @@
 
 class IScriptFunction;
 
+// A script being parsed on a worker thread
+class IScriptCompileJob
+{
+	public:
+		IScriptCompileJob() {}
+		virtual ~IScriptCompileJob() {}
+
+		virtual bool isReady() const = 0;
+};
+
 class IScriptEnv
 {
 	public:
@@ -19,6 +29,11 @@ class IScriptEnv
 		virtual void Initialize() = 0;
 		virtual void Cleanup(bool shutDown = false) = 0;
 		virtual IScriptFunction * Compile(const std::string& name, const std::string& source) = 0;
+
+		// Starts parsing a script off the script thread.  Once the job is ready, FinishCompile turns it into a
+		// function on the script thread and deletes the job.
+		virtual IScriptCompileJob * StartCompile(const std::string& name, const std::string& source) = 0;
+		virtual IScriptFunction * FinishCompile(IScriptCompileJob *job) = 0;
 		virtual void CallFunctionInScope(std::function<void()> function) = 0;
 		virtual void TerminateExecution() = 0;
 
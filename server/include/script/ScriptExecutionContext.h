@@ -12,26 +12,61 @@
 
 class ScriptAction;
 
+// How a queued event is merged with one of the same type and subject that hasn't run yet
+enum
+{
+	SCRIPTCOALESCE_KEEPFIRST	= 0,
+	SCRIPTCOALESCE_KEEPLAST		= 1,
+};
+
+struct ScriptCoalesceRule
+{
+	const char *action;
+	int mode;
+};
+
+// Events fired by movement or chat that only need to run once per player per tick
+static const ScriptCoalesceRule scriptCoalesceRules[] = {
+	{ "npc.playertouchsme", SCRIPTCOALESCE_KEEPFIRST },
+	{ "npc.playerchats", SCRIPTCOALESCE_KEEPLAST },
+};
+
 class ScriptExecutionContext
 {
 public:
 	ScriptExecutionContext(CScriptEngine *scriptEngine)
-		: _scriptEngine(scriptEngine) { }
+		: _scriptEngine(scriptEngine), _disabled(false), _terminated(false), _coalescedCount(0) { }
 
 	~ScriptExecutionContext() { resetExecution(); }
 
 	bool hasActions() const;
-	std::pair<unsigned int, double> getExecutionData();
+	ScriptExecutionData getExecutionData();
 
 	void addAction(ScriptAction *action);
 	void addExecutionSample(const ScriptTimeSample& sample);
 	void resetExecution();
 	bool runExecution();
 
+	// Set once a script runs past the hard limit, queued actions are dropped until the script is replaced
+	bool isDisabled() const;
+	void setDisabled(bool disabled);
+
+	// True if the last runExecution was killed for running past the hard limit
+	bool wasTerminated() const;
+
+	// Events merged into one that was already queued
+	unsigned int getCoalescedCount() const;
+
+private:
+	bool coalesceAction(ScriptAction *action);
+
 private:
 	CScriptEngine *_scriptEngine;
 	std::vector<ScriptAction *> _actions;
 	std::vector<ScriptTimeSample> _scriptTimeSamples;
+	bool _disabled;
+	bool _terminated;
+	unsigned int _coalescedCount;
 };
 
 inline bool ScriptExecutionContext::hasActions() const
@@ -39,6 +74,26 @@ inline bool ScriptExecutionContext::hasActions() const
 	return !_actions.empty();
 }
 
+inline bool ScriptExecutionContext::isDisabled() const
+{
+	return _disabled;
+}
+
+inline void ScriptExecutionContext::setDisabled(bool disabled)
+{
+	_disabled = disabled;
+}
+
+inline bool ScriptExecutionContext::wasTerminated() const
+{
+	return _terminated;
+}
+
+inline unsigned int ScriptExecutionContext::getCoalescedCount() const
+{
+	return _coalescedCount;
+}
+
 inline void ScriptExecutionContext::addExecutionSample(const ScriptTimeSample& sample)
 {
 #ifndef NOSCRIPTPROFILING
@@ -46,10 +101,9 @@ inline void ScriptExecutionContext::addExecutionSample(const ScriptTimeSample& s
 #endif
 }
 
-inline std::pair<unsigned int, double> ScriptExecutionContext::getExecutionData()
+inline ScriptExecutionData ScriptExecutionContext::getExecutionData()
 {
-	double exectime = 0.0;
-	unsigned int calls = 0;
+	ScriptExecutionData data = { 0, 0.0, 0.0, 0 };
 
 #ifndef NOSCRIPTPROFILING
 	auto time_now = std::chrono::high_resolution_clock::now();
@@ -63,20 +117,58 @@ inline std::pair<unsigned int, double> ScriptExecutionContext::getExecutionData(
 			continue;
 		}
 
-		exectime += (*it).sample;
-		calls++;
+		data.time += (*it).sample;
+		data.peak = std::max(data.peak, (*it).sample);
+		if ((*it).deferred)
+			data.deferred++;
+		data.calls++;
 		++it;
 	}
 #endif
 
-	return { calls, exectime };
+	return data;
 }
 
 inline void ScriptExecutionContext::addAction(ScriptAction *action)
 {
+	if (_disabled)
+	{
+		delete action;
+		return;
+	}
+
+	if (action->getSubject() != nullptr && _scriptEngine->getCoalesceEvents() && coalesceAction(action))
+		return;
+
 	_actions.push_back(action);
 }
 
+inline bool ScriptExecutionContext::coalesceAction(ScriptAction *action)
+{
+	for (const auto& rule : scriptCoalesceRules)
+	{
+		if (action->getAction() != rule.action)
+			continue;
+
+		for (auto & queued : _actions)
+		{
+			// Actions share their name, so the same name is the same string
+			if (queued->getSubject() != action->getSubject() || &queued->getAction() != &action->getAction())
+				continue;
+
+			_coalescedCount++;
+			if (rule.mode == SCRIPTCOALESCE_KEEPLAST)
+				std::swap(queued, action);
+			delete action;
+			return true;
+		}
+
+		return false;
+	}
+
+	return false;
+}
+
 inline void ScriptExecutionContext::resetExecution()
 {
 	for (auto & _action : _actions)
@@ -97,26 +189,48 @@ inline bool ScriptExecutionContext::runExecution()
 	// Send start timer to engine
 	auto currentTimer = std::chrono::high_resolution_clock::now();
 	_scriptEngine->StartScriptExecution(currentTimer);
+	_terminated = false;
 
-	// iterate over queued actions
+	// iterate over queued actions, until this script has used up its budget for the tick
+	const std::chrono::nanoseconds softLimit = _scriptEngine->getScriptSoftLimit();
 	SCRIPTENV_D("Running %d actions:\n", iterateActions.size());
-	for (auto & action : iterateActions)
+	auto it = iterateActions.begin();
+	for (; it != iterateActions.end(); ++it)
 	{
-	    SCRIPTENV_D("Running action: %s\n", action->getAction().c_str());
-		action->Invoke();
-		delete action;
+		if (softLimit.count() > 0 && it != iterateActions.begin() && std::chrono::high_resolution_clock::now() - currentTimer >= softLimit)
+			break;
+
+	    SCRIPTENV_D("Running action: %s\n", (*it)->getAction().c_str());
+		(*it)->Invoke();
+		delete *it;
+
+		// The script watcher killed the script
+		if (!_scriptEngine->IsScriptRunning())
+		{
+			++it;
+			break;
+		}
 	}
 
-	if (!_scriptEngine->StopScriptExecution())
+	_terminated = !_scriptEngine->StopScriptExecution();
+	bool deferred = (it != iterateActions.end() && !_terminated);
+	if (_terminated)
+	{
+		_disabled = true;
+		for (; it != iterateActions.end(); ++it)
+			delete *it;
+		resetExecution();
+	}
+	else if (deferred)
 	{
-		// TODO(joey): Report to server? What should we do, hm.
-		printf("Oh no we were killed!!\n");
+		// Run what is left first next tick, ahead of anything queued while running
+		_actions.insert(_actions.begin(), it, iterateActions.end());
 	}
 
 #ifndef NOSCRIPTPROFILING
 	auto endTimer = std::chrono::high_resolution_clock::now();
 	auto time_diff = std::chrono::duration<double>(endTimer - currentTimer);
-	addExecutionSample({ time_diff.count(), endTimer });
+	addExecutionSample({ time_diff.count(), endTimer, deferred });
 #endif
 
 	return hasActions();
@@ -0,0 +1,43 @@
+#pragma once
+
+#ifndef SCRIPTHASH_H
+#define SCRIPTHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// SHA-256 of script source, used to key compiled scripts
+class ScriptHash
+{
+public:
+	ScriptHash();
+
+	void update(const char *data, size_t length);
+	std::string digest();
+
+	static std::string Hash(const char *data, size_t length);
+	static std::string Hash(const std::string& data);
+
+private:
+	void transform(const unsigned char *block);
+
+	uint32_t _state[8];
+	uint64_t _length;
+	unsigned char _buffer[64];
+	size_t _bufferLength;
+};
+
+inline std::string ScriptHash::Hash(const char *data, size_t length)
+{
+	ScriptHash hash;
+	hash.update(data, length);
+	return hash.digest();
+}
+
+inline std::string ScriptHash::Hash(const std::string& data)
+{
+	return Hash(data.c_str(), data.length());
+}
+
+#endif
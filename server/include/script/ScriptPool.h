@@ -0,0 +1,94 @@
+#pragma once
+
+#ifndef SCRIPTPOOL_H
+#define SCRIPTPOOL_H
+
+#include <cstddef>
+#include <new>
+
+// Freed blocks kept per size and thread, anything past this goes back to the heap
+#define SCRIPTPOOL_MAXFREE	4096
+
+// Free list of fixed size blocks for script objects that are created and destroyed for every event.
+// Each server runs its scripts on its own thread, so every thread gets its own list and no locking is needed.
+template <size_t Size>
+class ScriptPool
+{
+public:
+	static void * allocate()
+	{
+		FreeList& list = freeList();
+		if (list.head == nullptr)
+			return ::operator new(BlockSize);
+
+		Block *block = list.head;
+		list.head = block->next;
+		list.count--;
+		return block;
+	}
+
+	static void release(void *ptr)
+	{
+		if (ptr == nullptr)
+			return;
+
+		FreeList& list = freeList();
+		if (list.count >= SCRIPTPOOL_MAXFREE)
+		{
+			::operator delete(ptr);
+			return;
+		}
+
+		Block *block = static_cast<Block *>(ptr);
+		block->next = list.head;
+		list.head = block;
+		list.count++;
+	}
+
+private:
+	struct Block
+	{
+		Block *next;
+	};
+
+	static constexpr size_t BlockSize = (Size < sizeof(Block) ? sizeof(Block) : Size);
+
+	struct FreeList
+	{
+		FreeList() : head(nullptr), count(0) {}
+
+		~FreeList()
+		{
+			while (head != nullptr)
+			{
+				Block *block = head;
+				head = block->next;
+				::operator delete(block);
+			}
+		}
+
+		Block *head;
+		size_t count;
+	};
+
+	static FreeList& freeList()
+	{
+		static thread_local FreeList list;
+		return list;
+	}
+};
+
+// Gives a class pooled operator new/delete.  Derived classes of a different size fall back to the heap.
+#define SCRIPTPOOL_ALLOCATOR(CLASS_NAME)											\
+	static void * operator new(size_t size) {										\
+		if (size != sizeof(CLASS_NAME))												\
+			return ::operator new(size);											\
+		return ScriptPool<sizeof(CLASS_NAME)>::allocate();							\
+	}																				\
+	static void operator delete(void *ptr, size_t size) {							\
+		if (size != sizeof(CLASS_NAME))												\
+			::operator delete(ptr);													\
+		else ScriptPool<sizeof(CLASS_NAME)>::release(ptr);							\
+	}
+
+#endif
@@ -10,6 +10,16 @@ struct ScriptTimeSample
 {
 	double sample;
 	std::chrono::high_resolution_clock::time_point sample_time;
+	bool deferred;
+};
+
+// Execution time of a script over the last minute
+struct ScriptExecutionData
+{
+	unsigned int calls;
+	double time;
+	double peak;
+	unsigned int deferred;
 };
 
 class ScriptRunError
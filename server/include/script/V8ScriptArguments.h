@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <v8.h>
 #include "ScriptBindings.h"
+#include "ScriptPool.h"
 #include "V8ScriptEnv.h"
 #include "V8ScriptFunction.h"
 #include "V8ScriptWrapped.h"
@@ -59,6 +60,9 @@ public:
 
 	~V8ScriptArguments() = default;
 
+	// Arguments are created for every event, keep the memory around
+	SCRIPTPOOL_ALLOCATOR(V8ScriptArguments)
+
 	virtual bool Invoke(IScriptFunction *func, bool catchExceptions = false) override
 	{
 		assert(base::Argc > 0);
@@ -23,12 +23,30 @@ public:
 	void Cleanup(bool shutDown = false) override;
 	
 	IScriptFunction * Compile(const std::string& name, const std::string& source) override;
+	IScriptCompileJob * StartCompile(const std::string& name, const std::string& source) override;
+	IScriptFunction * FinishCompile(IScriptCompileJob *job) override;
 	void CallFunctionInScope(std::function<void()> function) override;
 	void TerminateExecution() override;
 
 	// Parse errors from a TryCatch into lastScriptError 
 	bool ParseErrors(v8::TryCatch *tryCatch);
 
+	// Store compiled code on disk, keyed by a hash of the source and the v8 version
+	void SetCodeCachePath(const std::string& path);
+
+	// Startup snapshots. The external references are the null-terminated addresses of every binding callback,
+	// and have to outlive the isolate. Both modes are picked before Initialize.
+	bool LoadSnapshot(const std::string& fileName, const std::string& tag, const intptr_t *externalRefs);
+	void SetSnapshotCreator(const intptr_t *externalRefs);
+	bool HasSnapshot() const;
+
+	// Returns the bootstrap function from a loaded snapshot, or nullptr if it can't be restored
+	IScriptFunction * RestoreSnapshot();
+
+	// Writes the bindings and bootstrap function to a snapshot. Takes ownership of the bootstrap function,
+	// this environment can't run scripts afterwards.
+	bool SaveSnapshot(const std::string& fileName, const std::string& tag, IScriptFunction *bootstrap);
+
 	// --
 	v8::Isolate * Isolate() const;
 	v8::Local<v8::Context> Context() const;
@@ -48,10 +66,24 @@ public:
 	T * Unwrap(v8::Local<v8::Value> value) const;
 
 private:
+	v8::Local<v8::Context> CompileContext();
+	IScriptFunction * RunCompiled(v8::Local<v8::Context> context, v8::Local<v8::Script> script, v8::TryCatch *tryCatch);
+
+	std::string CodeCacheFile(const std::string& source) const;
+	v8::ScriptCompiler::CachedData * ReadCodeCache(const std::string& fileName) const;
+	void WriteCodeCache(const std::string& fileName, v8::Local<v8::UnboundScript> script) const;
+
 	static int s_count;
 	static std::unique_ptr<v8::Platform> s_platform;
 	
 	bool _initialized;
+	std::string _codeCachePath;
+	bool _createSnapshot;
+	const intptr_t *_externalRefs;
+	v8::SnapshotCreator *_snapshotCreator;
+	v8::StartupData _snapshotBlob;
+	std::string _snapshotData;
+	std::vector<std::string> _snapshotConstructors;
 	v8::Isolate::CreateParams create_params;
 	v8::Isolate * _isolate;
 	v8::Persistent<v8::Context> _context;
@@ -65,6 +97,22 @@ inline v8::Isolate * V8ScriptEnv::Isolate() const
 	return _isolate;
 }
 
+inline void V8ScriptEnv::SetCodeCachePath(const std::string& path)
+{
+	_codeCachePath = path;
+}
+
+inline void V8ScriptEnv::SetSnapshotCreator(const intptr_t *externalRefs)
+{
+	_createSnapshot = true;
+	_externalRefs = externalRefs;
+}
+
+inline bool V8ScriptEnv::HasSnapshot() const
+{
+	return _snapshotBlob.data != nullptr;
+}
+
 inline v8::Local<v8::Context> V8ScriptEnv::Context() const {
 	return PersistentToLocal(Isolate(), _context);
 }
@@ -69,4 +69,12 @@ inline Type * UnwrapObject(v8::Local<v8::Object> self) {
 	return static_cast<Type *>(self->GetAlignedPointerFromInternalField(0));
 }
 
+// The script engine lives in an isolate data slot rather than in each binding's data, so bindings can go in a snapshot
+#define V8ENV_ENGINE_SLOT	0
+
+template <class Type>
+inline Type * GetScriptEngine(v8::Isolate *isolate) {
+	return static_cast<Type *>(isolate->GetData(V8ENV_ENGINE_SLOT));
+}
+
 #endif
@@ -0,0 +1,402 @@
+#include "IDebug.h"
+#include <sys/stat.h>
+#include <string.h>
+#include "CAccountIndex.h"
+#include "TServer.h"
+#include "TAccount.h"
+#include "IUtil.h"
+
+static const char* const accountIndexFields[] =
+{
+	"NICK", "LEVEL", "IP", "ONSECS", "BANNED", "BANREASON", "COMMENTS", "EMAIL", "LOCALRIGHTS", "LOADONLY",
+	"FLAG", "WEAPON", "FOLDERRIGHT",
+	0
+};
+
+// Same order TAccount::meetsConditions searches for them.
+static const char* const accountConditionals[] = { ">=", "<=", "!=", "=", ">", "<" };
+enum
+{
+	ACCCOND_GREATEREQUAL	= 0,
+	ACCCOND_LESSEQUAL		= 1,
+	ACCCOND_NOTEQUAL		= 2,
+	ACCCOND_EQUAL			= 3,
+	ACCCOND_GREATER			= 4,
+	ACCCOND_LESS			= 5,
+};
+#define ACCCOND_COUNT	6
+
+// Don't stat every account file on every search.
+#define ACCIDX_SYNCTIME	60
+
+static int getIndexField(const CString& section)
+{
+	for (int i = 0; accountIndexFields[i] != 0; ++i)
+	{
+#ifdef WIN32
+		if (_stricmp(section.text(), accountIndexFields[i]) == 0)
+#else
+		if (strcasecmp(section.text(), accountIndexFields[i]) == 0)
+#endif
+			return i;
+	}
+	return -1;
+}
+
+static bool testValue(const CString& val, int op, const CString& cvalue)
+{
+	if (val.isNumber())
+	{
+		double vNum[2] = { atof(val.text()), atof(cvalue.text()) };
+		switch (op)
+		{
+			case ACCCOND_GREATEREQUAL:	return vNum[0] >= vNum[1];
+			case ACCCOND_LESSEQUAL:		return vNum[0] <= vNum[1];
+			case ACCCOND_NOTEQUAL:		return vNum[0] != vNum[1];
+			case ACCCOND_GREATER:		return vNum[0] > vNum[1];
+			case ACCCOND_LESS:			return vNum[0] < vNum[1];
+			default:					return vNum[0] == vNum[1];
+		}
+	}
+
+	switch (op)
+	{
+		case ACCCOND_GREATEREQUAL:	return strcmp(val.text(), cvalue.text()) >= 0;
+		case ACCCOND_LESSEQUAL:		return strcmp(val.text(), cvalue.text()) <= 0;
+		case ACCCOND_NOTEQUAL:		return !val.match(cvalue.text());
+		case ACCCOND_GREATER:		return strcmp(val.text(), cvalue.text()) > 0;
+		case ACCCOND_LESS:			return strcmp(val.text(), cvalue.text()) < 0;
+		default:					return val.match(cvalue.text());
+	}
+}
+
+/*
+	CAccountIndex: Load/Save
+*/
+void CAccountIndex::load()
+{
+	loaded = true;
+	if (!server->getSettings()->getBool("saveaccountindex", true))
+		return;
+
+	CString fileData;
+	if (!fileData.load(CString() << server->getServerPath() << "accountindex.dat"))
+		return;
+
+	if (fileData.readString("\n") != "GRACCIDX001")
+		return;
+
+	while (fileData.bytesLeft() > 0)
+	{
+		CString fileName = fileData.readChars(fileData.readGUInt());
+		size_t row = getRow(fileName);
+		rowModTimes[row] = (time_t)fileData.readGUInt5();
+		rowFields[row] = fileData.readGUShort();
+
+		for (auto & column : columns)
+			column[row] = fileData.readChars(fileData.readGUInt());
+
+		for (auto & listColumn : listColumns)
+		{
+			unsigned int count = fileData.readGUInt();
+			for (unsigned int i = 0; i < count; ++i)
+				listColumn[row].push_back(fileData.readChars(fileData.readGUInt()));
+		}
+	}
+}
+
+void CAccountIndex::save()
+{
+	if (!modified || !server->getSettings()->getBool("saveaccountindex", true))
+		return;
+
+	CString fileData = "GRACCIDX001\n";
+	for (size_t row = 0; row < rowFiles.size(); ++row)
+	{
+		if (rowFiles[row].isEmpty())
+			continue;
+
+		fileData.writeGInt(rowFiles[row].length()) << rowFiles[row];
+		fileData.writeGInt5(rowModTimes[row]);
+		fileData.writeGShort(rowFields[row]);
+
+		for (auto & column : columns)
+			fileData.writeGInt(column[row].length()) << column[row];
+
+		for (auto & listColumn : listColumns)
+		{
+			fileData.writeGInt((int)listColumn[row].size());
+			for (auto & value : listColumn[row])
+				fileData.writeGInt(value.length()) << value;
+		}
+	}
+
+	fileData.save(CString() << server->getServerPath() << "accountindex.dat");
+	modified = false;
+}
+
+void CAccountIndex::clear()
+{
+	rowIds.clear();
+	freeRows.clear();
+	rowFiles.clear();
+	rowModTimes.clear();
+	rowFields.clear();
+	for (auto & column : columns)
+		column.clear();
+	for (auto & listColumn : listColumns)
+		listColumn.clear();
+
+	loaded = modified = false;
+	lastSync = 0;
+}
+
+/*
+	CAccountIndex: Row Management
+*/
+size_t CAccountIndex::getRow(const CString& fileName)
+{
+	auto rowIter = rowIds.find(fileName.text());
+	if (rowIter != rowIds.end())
+		return rowIter->second;
+
+	size_t row;
+	if (!freeRows.empty())
+	{
+		row = freeRows.back();
+		freeRows.pop_back();
+	}
+	else
+	{
+		row = rowFiles.size();
+		rowFiles.emplace_back();
+		rowModTimes.push_back(0);
+		rowFields.push_back(0);
+		for (auto & column : columns)
+			column.emplace_back();
+		for (auto & listColumn : listColumns)
+			listColumn.emplace_back();
+	}
+
+	rowFiles[row] = fileName;
+	rowIds[fileName.text()] = row;
+	return row;
+}
+
+void CAccountIndex::readRow(size_t row, const CString& filePath)
+{
+	// If a newer copy is still waiting on the account writer, use that.
+	CString fileData;
+	if (!server->getAccountSaver()->getPending(filePath, fileData))
+		fileData.load(filePath);
+
+	parseRow(row, fileData);
+
+	struct stat fileStat;
+	rowModTimes[row] = (stat(filePath.text(), &fileStat) != -1 ? (time_t)fileStat.st_mtime : 0);
+}
+
+void CAccountIndex::parseRow(size_t row, const CString& fileData)
+{
+	rowFields[row] = 0;
+	for (auto & column : columns)
+		column[row].clear();
+	for (auto & listColumn : listColumns)
+		listColumn[row].clear();
+
+	std::vector<CString> lines = fileData.tokenize("\n");
+	if (lines.empty() || lines[0].trim() != "GRACC001")
+		return;
+
+	for (auto & line : lines)
+	{
+		line.trimI();
+
+		int sep = line.find(' ');
+		int field = getIndexField(line.subString(0, sep));
+		if (field == -1)
+			continue;
+
+		CString val;
+		if (sep != -1)
+			val = line.subString(sep + 1);
+
+		rowFields[row] |= (1 << field);
+		if (field < ACCIDX_LISTSTART)
+			columns[field][row] = val;
+		else
+			listColumns[field - ACCIDX_LISTSTART][row].push_back(val);
+	}
+
+	modified = true;
+}
+
+void CAccountIndex::update(const CString& fileName, const CString& fileData)
+{
+	// The index gets built on the first search, nothing to keep up to date until then.
+	if (!loaded)
+		return;
+
+	// The file hasn't hit the disk yet.  The next sync takes its mod time without re-reading it.
+	size_t row = getRow(fileName);
+	parseRow(row, fileData);
+	rowModTimes[row] = 0;
+}
+
+void CAccountIndex::sync()
+{
+	if (!loaded)
+		load();
+
+	time_t now = time(0);
+	if (now - lastSync < ACCIDX_SYNCTIME)
+		return;
+	lastSync = now;
+
+	std::vector<char> seen(rowFiles.size(), 0);
+
+	// Re-read any account that was changed outside of the server.
+	CFileSystem* fs = server->getAccountsFileSystem();
+	for (auto & file : *fs->getFileList())
+	{
+		size_t row = getRow(file.first);
+		if (row >= seen.size())
+			seen.resize(row + 1, 0);
+		seen[row] = 1;
+
+		struct stat fileStat;
+		time_t modTime = (stat(file.second.text(), &fileStat) != -1 ? (time_t)fileStat.st_mtime : 0);
+		if (rowModTimes[row] == 0 && rowFields[row] != 0)
+		{
+			rowModTimes[row] = modTime;
+			modified = true;
+		}
+		else if (rowModTimes[row] != modTime)
+			readRow(row, file.second);
+	}
+
+	// Drop accounts that no longer exist.
+	for (size_t row = 0; row < seen.size(); ++row)
+	{
+		if (seen[row] || rowFiles[row].isEmpty())
+			continue;
+
+		rowIds.erase(rowFiles[row].text());
+		rowFiles[row].clear();
+		freeRows.push_back(row);
+		modified = true;
+	}
+}
+
+/*
+	CAccountIndex: Searching
+*/
+std::vector<SAccountCondition> CAccountIndex::compile(CString conditions)
+{
+	std::vector<SAccountCondition> ret;
+
+	conditions.removeAllI("'");
+	conditions.replaceAllI("%", "*");
+	std::vector<CString> cond = conditions.tokenize(",");
+	for (auto & c : cond)
+	{
+		SAccountCondition condition;
+		for (int k = 0; k < ACCCOND_COUNT; ++k)
+		{
+			if (c.find(accountConditionals[k]) != -1)
+			{
+				condition.op = k;
+				break;
+			}
+		}
+
+		if (condition.op != -1)
+		{
+			c.setRead(0);
+			condition.name = c.readString(accountConditionals[condition.op]).trim();
+			condition.value = c.readString("").trim();
+			condition.column = getIndexField(condition.name);
+		}
+
+		ret.push_back(condition);
+	}
+
+	return ret;
+}
+
+bool CAccountIndex::meetsCondition(size_t row, const SAccountCondition& condition) const
+{
+	if (!(rowFields[row] & (1 << condition.column)))
+		return false;
+
+	if (condition.column < ACCIDX_LISTSTART)
+		return testValue(columns[condition.column][row], condition.op, condition.value);
+
+	// != has to hold for every entry, everything else only needs one.
+	const std::vector<CString>& values = listColumns[condition.column - ACCIDX_LISTSTART][row];
+	for (auto & value : values)
+	{
+		bool met = testValue(value, condition.op, condition.value);
+		if (condition.op == ACCCOND_NOTEQUAL && !met)
+			return false;
+		if (condition.op != ACCCOND_NOTEQUAL && met)
+			return true;
+	}
+
+	return condition.op == ACCCOND_NOTEQUAL;
+}
+
+std::vector<CString> CAccountIndex::search(const CString& name, const CString& conditions)
+{
+	std::vector<CString> ret;
+	sync();
+
+	// Anything we don't index still has to be checked against the account file.
+	std::vector<SAccountCondition> compiled = compile(conditions);
+	bool checkFile = false;
+	for (auto & condition : compiled)
+	{
+		// Conditions without an operator can never be met.
+		if (condition.op == -1)
+			return ret;
+
+		if (condition.column == -1)
+			checkFile = true;
+	}
+
+	CFileSystem* fs = server->getAccountsFileSystem();
+	for (auto & file : *fs->getFileList())
+	{
+		CString acc = removeExtension(file.first);
+		if (acc.isEmpty()) continue;
+		if (!acc.match(name)) continue;
+
+		// Accounts added since the last sync.
+		size_t row;
+		auto rowIter = rowIds.find(file.first.text());
+		if (rowIter == rowIds.end())
+		{
+			row = getRow(file.first);
+			readRow(row, file.second);
+		}
+		else row = rowIter->second;
+
+		bool met = true;
+		for (auto & condition : compiled)
+		{
+			if (condition.column != -1 && !meetsCondition(row, condition))
+			{
+				met = false;
+				break;
+			}
+		}
+
+		if (met && checkFile)
+			met = TAccount::meetsConditions(file.second, conditions);
+
+		if (met)
+			ret.push_back(acc);
+	}
+
+	return ret;
+}
@@ -0,0 +1,150 @@
+#include "IDebug.h"
+#include <cstdio>
+#include "CAccountSaver.h"
+#include "TServer.h"
+
+CAccountSaver::~CAccountSaver()
+{
+	stop();
+}
+
+void CAccountSaver::start()
+{
+	std::lock_guard<std::mutex> lock(jobMutex);
+	if (running)
+		return;
+
+	running = true;
+	writerThread = std::thread(std::ref(*this));
+}
+
+void CAccountSaver::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		if (!running)
+			return;
+		running = false;
+	}
+
+	// The writer drains whatever is left in the queue before it exits.
+	jobSignal.notify_all();
+	if (writerThread.joinable())
+		writerThread.join();
+
+	reportErrors();
+}
+
+void CAccountSaver::operator()()
+{
+	std::unique_lock<std::mutex> lock(jobMutex);
+	while (true)
+	{
+		jobSignal.wait(lock, [this] { return !running || !jobs.empty(); });
+		if (jobs.empty())
+			break;
+
+		// Copy the job out so queue() can keep working while we hit the disk.
+		// The job stays at the front of the queue until it is written so getPending() can still find it.
+		SAccountSaveJob job = jobs.front();
+		writing = true;
+		lock.unlock();
+
+		bool saved = writeFile(job);
+
+		lock.lock();
+		jobs.pop_front();
+		writing = false;
+		if (!saved)
+			failedSaves.push_back(job.accountName);
+	}
+}
+
+void CAccountSaver::queue(const CString& accountName, const CString& fileName, const CString& fileData)
+{
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		if (running)
+		{
+			// If this account is already waiting to be written, just replace its data.
+			// Never touch the front job while the writer is busy with it.
+			auto it = jobs.begin();
+			if (writing && it != jobs.end())
+				++it;
+
+			for (; it != jobs.end(); ++it)
+			{
+				if (it->fileName == fileName)
+				{
+					it->fileData = fileData;
+					return;
+				}
+			}
+
+			jobs.push_back({ accountName, fileName, fileData });
+			jobSignal.notify_one();
+			return;
+		}
+	}
+
+	// No writer thread, save it now.
+	SAccountSaveJob job = { accountName, fileName, fileData };
+	if (!writeFile(job))
+		server->getRCLog().out("** Error saving account: %s\n", job.accountName.text());
+}
+
+bool CAccountSaver::getPending(const CString& fileName, CString& fileData)
+{
+	std::lock_guard<std::mutex> lock(jobMutex);
+	for (auto it = jobs.rbegin(); it != jobs.rend(); ++it)
+	{
+		if (it->fileName == fileName)
+		{
+			fileData = it->fileData;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+size_t CAccountSaver::getBacklog()
+{
+	std::lock_guard<std::mutex> lock(jobMutex);
+	return jobs.size();
+}
+
+void CAccountSaver::reportErrors()
+{
+	std::vector<CString> failed;
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		if (failedSaves.empty())
+			return;
+		failed.swap(failedSaves);
+	}
+
+	for (auto & accountName : failed)
+		server->getRCLog().out("** Error saving account: %s\n", accountName.text());
+}
+
+bool CAccountSaver::writeFile(SAccountSaveJob& job)
+{
+	// Write to a temporary file first, then move it over the old one so a crash
+	// mid-write never leaves a truncated account behind.
+	CString tempName = CString() << job.fileName << ".tmp";
+	if (!job.fileData.save(tempName))
+		return false;
+
+#if defined(WIN32) || defined(WIN64)
+	// rename() won't replace an existing file on Windows.
+	std::remove(job.fileName.text());
+#endif
+	if (std::rename(tempName.text(), job.fileName.text()) != 0)
+	{
+		std::remove(tempName.text());
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,74 @@
+#include "IDebug.h"
+#include <cstring>
+#include "CHistogram.h"
+
+int CHistogram::getBucket(unsigned long long value)
+{
+	if (value < HISTOGRAM_LINEAR)
+		return (int)value;
+
+	// Find the highest bit, then use the two bits under it to pick one of its 4 buckets.
+	int msb = 3;
+	while (msb < 63 && (value >> (msb + 1)) != 0)
+		++msb;
+
+	int bucket = HISTOGRAM_LINEAR + (msb - 3) * 4 + (int)((value >> (msb - 2)) & 3);
+	return (bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1);
+}
+
+unsigned long long CHistogram::getBucketLimit(int bucket)
+{
+	if (bucket < HISTOGRAM_LINEAR)
+		return (unsigned long long)bucket;
+
+	int msb = (bucket - HISTOGRAM_LINEAR) / 4 + 3;
+	unsigned long long sub = (unsigned long long)((bucket - HISTOGRAM_LINEAR) % 4);
+	return ((4 + sub + 1) << (msb - 2)) - 1;
+}
+
+void CHistogram::record(unsigned long long value)
+{
+	++buckets[getBucket(value)];
+	++count;
+	sum += value;
+	if (value > maxValue)
+		maxValue = value;
+}
+
+void CHistogram::merge(const CHistogram& other)
+{
+	for (int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+		buckets[i] += other.buckets[i];
+	count += other.count;
+	sum += other.sum;
+	if (other.maxValue > maxValue)
+		maxValue = other.maxValue;
+}
+
+void CHistogram::reset()
+{
+	memset(buckets, 0, sizeof(buckets));
+	count = sum = maxValue = 0;
+}
+
+unsigned long long CHistogram::getPercentile(double percentile) const
+{
+	if (count == 0)
+		return 0;
+
+	unsigned long long target = (unsigned long long)((double)count * percentile / 100.0);
+	if (target == 0)
+		target = 1;
+
+	unsigned long long seen = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+	{
+		seen += buckets[i];
+		if (seen >= target)
+		{
+			unsigned long long limit = getBucketLimit(i);
+			return (limit < maxValue ? limit : maxValue);
+		}
+	}
+	return maxValue;
+}
@@ -0,0 +1,346 @@
+#include "IDebug.h"
+#include <cstdio>
+
+#include "CMetricsServer.h"
+#include "CHistogram.h"
+#include "TServer.h"
+#include "TPlayer.h"
+#include "TLevel.h"
+
+#define serverlog	server->getServerLog()
+
+// Requests bigger than this aren't a scrape.
+#define METRICS_MAXREQUEST		8192
+
+// Connections that haven't sent a request by now are dropped.
+#define METRICS_TIMEOUT			10
+
+static void writeHeader(CString& out, const char* name, const char* type, const char* help)
+{
+	out << "# HELP " << name << " " << help << "\n";
+	out << "# TYPE " << name << " " << type << "\n";
+}
+
+static void writeValue(CString& out, const char* name, const char* labels, unsigned long long value)
+{
+	char line[256];
+	snprintf(line, sizeof(line), "%s%s%s%s %llu\n", name, (*labels ? "{" : ""), labels, (*labels ? "}" : ""), value);
+	out << line;
+}
+
+static void writeValue(CString& out, const char* name, const char* labels, double value)
+{
+	char line[256];
+	snprintf(line, sizeof(line), "%s%s%s%s %.9g\n", name, (*labels ? "{" : ""), labels, (*labels ? "}" : ""), value);
+	out << line;
+}
+
+static void writeHistogram(CString& out, const char* name, const char* labels, const CHistogram& histogram)
+{
+	// CHistogram counts microseconds.  Every power of two from 64 us to 32 s is enough buckets for tick times.
+	char line[256];
+	unsigned long long count = 0;
+	int bucket = 0;
+	for (int msb = 5; msb <= 24; ++msb)
+	{
+		int last = HISTOGRAM_LINEAR + (msb - 3) * 4 + 3;
+		for (; bucket <= last; ++bucket)
+			count += histogram.getBucketCount(bucket);
+
+		snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"%g\"} %llu\n", name, labels, (*labels ? "," : ""), (double)(CHistogram::getBucketLimit(last) + 1) / 1000000.0, count);
+		out << line;
+	}
+	snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, (*labels ? "," : ""), histogram.getCount());
+	out << line;
+
+	CString sumName = CString() << name << "_sum";
+	CString countName = CString() << name << "_count";
+	writeValue(out, sumName.text(), labels, (double)histogram.getSum() / 1000000.0);
+	writeValue(out, countName.text(), labels, histogram.getCount());
+}
+
+/*
+	CMetricsConnection
+*/
+CMetricsConnection::CMetricsConnection(TServer* pServer, CSocket* pSocket)
+: server(pServer), sock(pSocket), closed(false)
+{
+	connectTime = time(0);
+}
+
+CMetricsConnection::~CMetricsConnection()
+{
+	delete sock;
+}
+
+bool CMetricsConnection::canRecv()
+{
+	if (sock->getState() == SOCKET_STATE_DISCONNECTED) return false;
+	return true;
+}
+
+bool CMetricsConnection::onRecv()
+{
+	unsigned int size = 0;
+	char* data = sock->getData(&size);
+	if (size != 0)
+		recvBuffer.write(data, size);
+	else if (sock->getState() == SOCKET_STATE_DISCONNECTED)
+		return false;
+
+	// Only answer once the headers are all in.
+	if (!sendBuffer.isEmpty() || recvBuffer.find("\r\n\r\n") == -1)
+		return recvBuffer.length() < METRICS_MAXREQUEST;
+
+	// GET /metrics HTTP/1.1
+	CString request = recvBuffer.readString("\r\n");
+	std::vector<CString> words = request.tokenize(" ");
+
+	CString status, body;
+	if (words.size() >= 2 && words[0] == "GET" && (words[1] == "/metrics" || words[1].find("/metrics?") == 0))
+	{
+		status = "200 OK";
+		body = server->getMetrics()->getMetrics();
+	}
+	else
+	{
+		status = "404 Not Found";
+		body = "Not found.  The metrics are at /metrics.\n";
+	}
+
+	sendBuffer << "HTTP/1.0 " << status << "\r\n";
+	sendBuffer << "Content-Type: text/plain; version=0.0.4\r\n";
+	sendBuffer << "Content-Length: " << CString(body.length()) << "\r\n";
+	sendBuffer << "Connection: close\r\n\r\n";
+	sendBuffer << body;
+	return true;
+}
+
+bool CMetricsConnection::onSend()
+{
+	if (sock->getState() == SOCKET_STATE_DISCONNECTED)
+		return false;
+
+	unsigned int size = sendBuffer.length();
+	int sent = sock->sendData(sendBuffer.text(), &size);
+	if (sent > 0)
+		sendBuffer.removeI(0, sent);
+
+	// Hang up once the whole page is out.
+	return !sendBuffer.isEmpty();
+}
+
+void CMetricsConnection::onUnregister()
+{
+	// Called when onSend() or onRecv() returns false.  CMetricsServer deletes us later.
+	sock->disconnect();
+	closed = true;
+}
+
+/*
+	CMetricsServer
+*/
+CMetricsServer::CMetricsServer(TServer* pServer)
+: server(pServer), listening(false)
+{
+	sock.setType(SOCKET_TYPE_SERVER);
+	sock.setProtocol(SOCKET_PROTOCOL_TCP);
+	sock.setDescription("metricsSock");
+}
+
+CMetricsServer::~CMetricsServer()
+{
+	cleanup();
+}
+
+bool CMetricsServer::init(const CString& pPort)
+{
+	cleanup();
+
+	// Only ever on localhost.  The scrapers run on the same machine.
+	if (sock.init("127.0.0.1", pPort.text()) || sock.connect())
+	{
+		serverlog.out("[%s] ** [Error] Could not listen for metrics on 127.0.0.1:%s\n", server->getName().text(), pPort.text());
+		sock.disconnect();
+		return false;
+	}
+
+	server->getSocketManager()->registerSocket((CSocketStub*)this);
+	listening = true;
+	serverlog.out("[%s]      Serving metrics at http://127.0.0.1:%s/metrics\n", server->getName().text(), pPort.text());
+	return true;
+}
+
+void CMetricsServer::cleanup()
+{
+	for (auto connection : connections)
+	{
+		if (!connection->isClosed())
+			server->getSocketManager()->unregisterSocket(connection);
+		delete connection;
+	}
+	connections.clear();
+
+	if (listening)
+	{
+		server->getSocketManager()->unregisterSocket(this);
+		sock.disconnect();
+		listening = false;
+	}
+}
+
+bool CMetricsServer::onRecv()
+{
+	CSocket* newSock = sock.accept();
+	if (newSock == nullptr)
+		return true;
+
+	auto* connection = new CMetricsConnection(server, newSock);
+	connections.push_back(connection);
+	server->getSocketManager()->registerSocket((CSocketStub*)connection);
+	return true;
+}
+
+void CMetricsServer::doTimedEvents()
+{
+	time_t now = time(0);
+	for (auto i = connections.begin(); i != connections.end();)
+	{
+		CMetricsConnection* connection = *i;
+		if (!connection->isClosed() && now - connection->getConnectTime() >= METRICS_TIMEOUT)
+			server->getSocketManager()->unregisterSocket(connection);
+
+		if (connection->isClosed())
+		{
+			delete connection;
+			i = connections.erase(i);
+		}
+		else ++i;
+	}
+}
+
+CString CMetricsServer::getMetrics()
+{
+	CString out;
+
+	// Players.
+	unsigned long long clients = 0, rcs = 0, ncs = 0, npcServers = 0, connecting = 0;
+	for (auto player : *server->getPlayerList())
+	{
+		if (player->isNPCServer()) ++npcServers;
+		else if (player->isClient()) ++clients;
+		else if (player->isRC()) ++rcs;
+		else if (player->isNC()) ++ncs;
+		else ++connecting;
+	}
+	writeHeader(out, "gs2emu_players", "gauge", "Connected players by type.  Connecting players haven't finished logging in.");
+	writeValue(out, "gs2emu_players", "type=\"client\"", clients);
+	writeValue(out, "gs2emu_players", "type=\"rc\"", rcs);
+	writeValue(out, "gs2emu_players", "type=\"nc\"", ncs);
+	writeValue(out, "gs2emu_players", "type=\"npcserver\"", npcServers);
+	writeValue(out, "gs2emu_players", "type=\"connecting\"", connecting);
+
+	writeHeader(out, "gs2emu_login_queue", "gauge", "Players waiting in the login queue.");
+	writeValue(out, "gs2emu_login_queue", "", (unsigned long long)server->getLoginQueueSize());
+
+	// The world.
+	unsigned long long groupLevels = 0;
+	for (auto& group : *server->getGroupLevels())
+		groupLevels += group.second.size();
+	writeHeader(out, "gs2emu_levels", "gauge", "Levels loaded.");
+	writeValue(out, "gs2emu_levels", "kind=\"world\"", (unsigned long long)server->getLevelList()->size());
+	writeValue(out, "gs2emu_levels", "kind=\"group\"", groupLevels);
+	writeHeader(out, "gs2emu_level_memory_bytes", "gauge", "Memory the world levels use, as of the last check for idle levels.");
+	writeValue(out, "gs2emu_level_memory_bytes", "", (unsigned long long)server->getLevelMemoryUsage());
+	writeHeader(out, "gs2emu_levels_unloaded_total", "counter", "Idle levels unloaded since the server started.");
+	writeValue(out, "gs2emu_levels_unloaded_total", "", server->getUnloadedLevelCount());
+	writeHeader(out, "gs2emu_level_states", "gauge", "Unloaded levels with board changes, items or baddies kept for when they load again.");
+	writeValue(out, "gs2emu_level_states", "", (unsigned long long)server->getLevelStateCount());
+	writeHeader(out, "gs2emu_level_state_bytes", "gauge", "Memory the kept level state uses.");
+	writeValue(out, "gs2emu_level_state_bytes", "", (unsigned long long)server->getLevelStateBytes());
+	writeHeader(out, "gs2emu_level_timers", "gauge", "Board changes, items, horses and baddies waiting in the timer wheel.");
+	writeValue(out, "gs2emu_level_timers", "", (unsigned long long)server->getTimerWheel()->getTimerCount());
+	writeHeader(out, "gs2emu_maps", "gauge", "Maps loaded.");
+	writeValue(out, "gs2emu_maps", "", (unsigned long long)server->getMapList()->size());
+	writeHeader(out, "gs2emu_npcs", "gauge", "Npcs, level and database.");
+	writeValue(out, "gs2emu_npcs", "", (unsigned long long)server->getNPCList()->size());
+	writeHeader(out, "gs2emu_weapons", "gauge", "Weapons loaded.");
+	writeValue(out, "gs2emu_weapons", "", (unsigned long long)server->getWeaponList()->size());
+
+	writeHeader(out, "gs2emu_account_save_backlog", "gauge", "Account saves waiting for the save thread.");
+	writeValue(out, "gs2emu_account_save_backlog", "", (unsigned long long)server->getAccountSaver()->getBacklog());
+
+#ifdef V8NPCSERVER
+	CScriptEngine* scriptEngine = server->getScriptEngine();
+	writeHeader(out, "gs2emu_script_queue", "gauge", "Script work waiting for the next tick.");
+	writeValue(out, "gs2emu_script_queue", "queue=\"npcs\"", (unsigned long long)scriptEngine->getQueuedNpcCount());
+	writeValue(out, "gs2emu_script_queue", "queue=\"npctimers\"", (unsigned long long)scriptEngine->getNpcTimerCount());
+	writeValue(out, "gs2emu_script_queue", "queue=\"weapons\"", (unsigned long long)scriptEngine->getQueuedWeaponCount());
+	writeValue(out, "gs2emu_script_queue", "queue=\"compiles\"", (unsigned long long)scriptEngine->getPendingCompileCount());
+	writeHeader(out, "gs2emu_script_cache_entries", "gauge", "Compiled scripts in the script cache.");
+	writeValue(out, "gs2emu_script_cache_entries", "", (unsigned long long)scriptEngine->getCachedScriptCount());
+#endif
+
+	// Ticks.
+	CTickProfiler* profiler = server->getTickProfiler();
+	writeHeader(out, "gs2emu_tick_seconds", "histogram", "Time taken by each server tick.");
+	writeHistogram(out, "gs2emu_tick_seconds", "", profiler->getTicks());
+	writeHeader(out, "gs2emu_tick_wait_seconds", "histogram", "Time each tick spent waiting on the sockets, not part of the tick time.");
+	writeHistogram(out, "gs2emu_tick_wait_seconds", "", profiler->getWaits());
+	writeHeader(out, "gs2emu_tick_phase_seconds", "histogram", "Time taken by each phase of a tick, in the ticks it ran.");
+	for (int i = 0; i < TICKPHASE_COUNT; ++i)
+	{
+		CString labels = CString() << "phase=\"" << CTickProfiler::getPhaseName(i) << "\"";
+		writeHistogram(out, "gs2emu_tick_phase_seconds", labels.text(), profiler->getPhase(i));
+	}
+	writeHeader(out, "gs2emu_worst_tick_seconds", "gauge", "The longest tick since the tick stats were reset.");
+	writeValue(out, "gs2emu_worst_tick_seconds", "", (double)profiler->getWorstTick().total / 1000000.0);
+
+	// Traffic.  Outgoing data is compressed by the file queue, so only incoming data has a size on the wire.
+	CPacketStats* stats = server->getPacketStats();
+	unsigned long long packetBytesIn = 0;
+	for (int i = 0; i < 256; ++i)
+		packetBytesIn += stats->getIn((unsigned char)i).bytes;
+	writeHeader(out, "gs2emu_received_bytes_total", "counter", "Bytes read from player sockets.");
+	writeValue(out, "gs2emu_received_bytes_total", "", stats->getSocketBytesIn());
+	writeHeader(out, "gs2emu_receive_compression_ratio", "gauge", "Bytes read from sockets per byte of packets they held.");
+	writeValue(out, "gs2emu_receive_compression_ratio", "", (packetBytesIn == 0 ? 0.0 : (double)stats->getSocketBytesIn() / (double)packetBytesIn));
+
+	// Caches.
+	writeHeader(out, "gs2emu_cache_requests_total", "counter", "Files and levels players asked for, by whether their cached copy was still good.");
+	writeValue(out, "gs2emu_cache_requests_total", "cache=\"file\",result=\"hit\"", stats->getFileCache().hits);
+	writeValue(out, "gs2emu_cache_requests_total", "cache=\"file\",result=\"miss\"", stats->getFileCache().misses);
+	writeValue(out, "gs2emu_cache_requests_total", "cache=\"level\",result=\"hit\"", stats->getLevelCache().hits);
+	writeValue(out, "gs2emu_cache_requests_total", "cache=\"level\",result=\"miss\"", stats->getLevelCache().misses);
+
+	// Packets by id.
+	writeHeader(out, "gs2emu_packets_total", "counter", "Packets by direction and id.");
+	for (int i = 0; i < 256; ++i)
+	{
+		if (stats->getIn((unsigned char)i).packets != 0)
+			writeValue(out, "gs2emu_packets_total", (CString() << "direction=\"in\",id=\"" << CString(i) << "\"").text(), stats->getIn((unsigned char)i).packets);
+		if (stats->getOut((unsigned char)i).packets != 0)
+			writeValue(out, "gs2emu_packets_total", (CString() << "direction=\"out\",id=\"" << CString(i) << "\"").text(), stats->getOut((unsigned char)i).packets);
+	}
+	writeHeader(out, "gs2emu_packet_bytes_total", "counter", "Packet bytes by direction and id, after decompressing incoming data and before compressing outgoing data.");
+	for (int i = 0; i < 256; ++i)
+	{
+		if (stats->getIn((unsigned char)i).packets != 0)
+			writeValue(out, "gs2emu_packet_bytes_total", (CString() << "direction=\"in\",id=\"" << CString(i) << "\"").text(), stats->getIn((unsigned char)i).bytes);
+		if (stats->getOut((unsigned char)i).packets != 0)
+			writeValue(out, "gs2emu_packet_bytes_total", (CString() << "direction=\"out\",id=\"" << CString(i) << "\"").text(), stats->getOut((unsigned char)i).bytes);
+	}
+	writeHeader(out, "gs2emu_packet_handler_seconds", "summary", "Time spent handling incoming packets, by id.");
+	for (int i = 0; i < 256; ++i)
+	{
+		const CHistogram& latency = stats->getLatency((unsigned char)i);
+		if (latency.getCount() == 0)
+			continue;
+
+		CString labels = CString() << "id=\"" << CString(i) << "\"";
+		writeValue(out, "gs2emu_packet_handler_seconds_sum", labels.text(), (double)latency.getSum() / 1000000.0);
+		writeValue(out, "gs2emu_packet_handler_seconds_count", labels.text(), latency.getCount());
+	}
+
+	return out;
+}
@@ -0,0 +1,33 @@
+#include "IDebug.h"
+#include <cstring>
+#include "CPacketStats.h"
+
+void CPacketStats::recordIn(unsigned char id, unsigned int bytes, unsigned long long micros)
+{
+	++in[id].packets;
+	in[id].bytes += bytes;
+	latency[id].record(micros);
+}
+
+void CPacketStats::recordOut(unsigned char id, unsigned int bytes)
+{
+	++out[id].packets;
+	out[id].bytes += bytes;
+}
+
+void CPacketStats::reset()
+{
+	memset(in, 0, sizeof(in));
+	memset(out, 0, sizeof(out));
+	for (int i = 0; i < 256; ++i)
+		latency[i].reset();
+	socketBytesIn = 0;
+	fileCache.hits = fileCache.misses = 0;
+	levelCache.hits = levelCache.misses = 0;
+	startTime = std::chrono::steady_clock::now();
+}
+
+double CPacketStats::getSeconds() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
@@ -0,0 +1,140 @@
+#include "IDebug.h"
+#include <cstring>
+#include <vector>
+#include "CPacketTrace.h"
+
+static const char traceHeader[] = "GRTRACE1";
+
+// Records are buffered and written out in chunks this big.
+#define PACKETTRACE_BUFFERSIZE	65536
+
+CPacketTrace::~CPacketTrace()
+{
+	close();
+}
+
+bool CPacketTrace::open(const CString& pFileName)
+{
+	close();
+
+	file = fopen(pFileName.text(), "wb");
+	if (file == 0)
+		return false;
+
+	fileName = pFileName;
+	fwrite(traceHeader, 1, 8, file);
+	startTime = std::chrono::steady_clock::now();
+	recording = true;
+	return true;
+}
+
+bool CPacketTrace::openRead(const CString& pFileName)
+{
+	close();
+
+	file = fopen(pFileName.text(), "rb");
+	if (file == 0)
+		return false;
+
+	char header[8];
+	if (fread(header, 1, 8, file) != 8 || memcmp(header, traceHeader, 8) != 0)
+	{
+		close();
+		return false;
+	}
+
+	fileName = pFileName;
+	return true;
+}
+
+void CPacketTrace::close()
+{
+	if (file == 0)
+		return;
+
+	flush();
+	fclose(file);
+	file = 0;
+	recording = false;
+}
+
+void CPacketTrace::flush()
+{
+	if (!recording || buffer.length() == 0)
+		return;
+
+	fwrite(buffer.text(), 1, buffer.length(), file);
+	fflush(file);
+	buffer.clear(PACKETTRACE_BUFFERSIZE);
+}
+
+void CPacketTrace::writeConnect(unsigned short id, const CString& ip)
+{
+	writeRecord(PACKETTRACE_CONNECT, id, ip);
+}
+
+void CPacketTrace::writePacket(unsigned short id, const CString& packet)
+{
+	writeRecord(PACKETTRACE_PACKET, id, packet);
+}
+
+void CPacketTrace::writeDisconnect(unsigned short id)
+{
+	writeRecord(PACKETTRACE_DISCONNECT, id, CString());
+}
+
+void CPacketTrace::writeRecord(unsigned char type, unsigned short id, const CString& data)
+{
+	if (!recording)
+		return;
+
+	unsigned int time = (unsigned int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+	unsigned int length = (unsigned int)data.length();
+
+	char head[11];
+	head[0] = (char)type;
+	for (int i = 0; i < 4; ++i)
+		head[1 + i] = (char)((time >> (i * 8)) & 0xFF);
+	head[5] = (char)(id & 0xFF);
+	head[6] = (char)((id >> 8) & 0xFF);
+	for (int i = 0; i < 4; ++i)
+		head[7 + i] = (char)((length >> (i * 8)) & 0xFF);
+
+	buffer.write(head, sizeof(head));
+	if (length != 0)
+		buffer.write(data.text(), (int)length);
+
+	if (buffer.length() >= PACKETTRACE_BUFFERSIZE)
+		flush();
+}
+
+bool CPacketTrace::read(SPacketTraceRecord& record)
+{
+	if (file == 0 || recording)
+		return false;
+
+	unsigned char head[11];
+	if (fread(head, 1, sizeof(head), file) != sizeof(head))
+		return false;
+
+	unsigned int length = 0;
+	record.type = head[0];
+	record.time = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		record.time |= (unsigned int)head[1 + i] << (i * 8);
+		length |= (unsigned int)head[7 + i] << (i * 8);
+	}
+	record.id = (unsigned short)(head[5] | (head[6] << 8));
+
+	record.data.clear();
+	if (length != 0)
+	{
+		std::vector<char> data(length);
+		if (fread(data.data(), 1, length, file) != length)
+			return false;
+		record.data.write(data.data(), (int)length);
+	}
+
+	return true;
+}
@@ -0,0 +1,60 @@
+#include "IDebug.h"
+#include "CReplaySink.h"
+
+void CReplaySink::setCodec(int pGen, unsigned char pKey)
+{
+	out_codec.setGen(pGen);
+	out_codec.reset(pKey);
+}
+
+void CReplaySink::sendCompress()
+{
+	if (buffer.isEmpty())
+		return;
+
+	CString pSend = buffer;
+	buffer.clear();
+
+	switch (out_codec.getGen())
+	{
+		case ENCRYPT_GEN_1:
+			break;
+
+		case ENCRYPT_GEN_2:
+		case ENCRYPT_GEN_3:
+			pSend.zcompressI();
+			break;
+
+		case ENCRYPT_GEN_4:
+			pSend.bzcompressI();
+			out_codec.limitFromType(COMPRESS_BZ2);
+			out_codec.encrypt(pSend);
+			break;
+
+		default:
+		{
+			// Small sends aren't worth compressing, and big ones compress better with bz2.
+			unsigned char compressionType = COMPRESS_UNCOMPRESSED;
+			if (pSend.length() > 0x2000)
+			{
+				compressionType = COMPRESS_BZ2;
+				pSend.bzcompressI();
+			}
+			else if (pSend.length() > 55)
+			{
+				compressionType = COMPRESS_ZLIB;
+				pSend.zcompressI();
+			}
+
+			out_codec.limitFromType(compressionType);
+			out_codec.encrypt(pSend);
+
+			// The compression type goes in front.
+			bytesSent++;
+			break;
+		}
+	}
+
+	// The length the packet would be framed with.
+	bytesSent += 2 + pSend.length();
+}
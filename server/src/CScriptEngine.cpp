@@ -1,5 +1,12 @@
 #ifdef V8NPCSERVER
 
+#include <algorithm>
+#include <sys/stat.h>
+#if defined(_WIN32) || defined(_WIN64)
+	#include <direct.h>
+	#define mkdir _mkdir
+#endif
+#include "CFileSystem.h"
 #include "CScriptEngine.h"
 #include "TNPC.h"
 #include "TPlayer.h"
@@ -14,9 +21,70 @@ extern void bindClass_Player(CScriptEngine *scriptEngine);
 extern void bindClass_Server(CScriptEngine *scriptEngine);
 extern void bindClass_Weapon(CScriptEngine *scriptEngine);
 
+extern void externalRefs_GlobalFunctions(std::vector<intptr_t>& refs);
+extern void externalRefs_Environment(std::vector<intptr_t>& refs);
+extern void externalRefs_Level(std::vector<intptr_t>& refs);
+extern void externalRefs_NPC(std::vector<intptr_t>& refs);
+extern void externalRefs_Player(std::vector<intptr_t>& refs);
+extern void externalRefs_Server(std::vector<intptr_t>& refs);
+extern void externalRefs_Weapon(std::vector<intptr_t>& refs);
+
+// Every binding callback, null terminated. Isolates keep a pointer to this, so it lives for the whole program.
+static const std::vector<intptr_t>& getExternalReferenceList()
+{
+	static const std::vector<intptr_t> externalRefs = []() {
+		std::vector<intptr_t> refs;
+		externalRefs_GlobalFunctions(refs);
+		externalRefs_Environment(refs);
+		externalRefs_Server(refs);
+		externalRefs_Level(refs);
+		externalRefs_NPC(refs);
+		externalRefs_Player(refs);
+		externalRefs_Weapon(refs);
+		refs.push_back(0);
+		return refs;
+	}();
+
+	return externalRefs;
+}
+
+static const intptr_t * getExternalReferences()
+{
+	return getExternalReferenceList().data();
+}
+
+// Snapshots reference callbacks by their position in the list, so one made with different bindings can't be used
+static std::string getSnapshotTag(const CString& bootstrapScript)
+{
+	return CScriptEngine::HashScript(bootstrapScript.text(), bootstrapScript.length()) + "/" + std::to_string(getExternalReferenceList().size());
+}
+
+// Compiled scripts are keyed by a hash of their code, so a changed script leaves its old entry behind.  Reading an
+// entry touches it, so anything nothing has loaded for scriptcodecachedays days is dropped.
+static void pruneCodeCache(TServer *server)
+{
+	int maxDays = server->getSettings()->getInt("scriptcodecachedays", 30);
+	if (maxDays <= 0)
+		return;
+
+	CFileSystem cache(server);
+	cache.addDir("scriptcache", "*", false);
+
+	time_t oldest = time(0) - (time_t)maxDays * 24 * 60 * 60;
+	int removed = 0;
+	for (auto & file : *cache.getFileList())
+	{
+		if (cache.getModTime(file.first) < oldest && std::remove(file.second.text()) == 0)
+			++removed;
+	}
+
+	if (removed != 0)
+		server->getServerLog().out("[%s] Removed %d unused entries from the script cache.\n", server->getName().text(), removed);
+}
+
 CScriptEngine::CScriptEngine(TServer *server)
 	: _server(server), _env(nullptr), _bootstrapFunction(nullptr), _environmentObject(nullptr), _serverObject(nullptr)
-	, _scriptIsRunning(false), _scriptWatcherRunning(false), _scriptWatcherThread()
+	, _scriptSoftLimit(0), _scriptHardLimit(500), _coalesceEvents(false), _dormantNpcs(false), _scriptIsRunning(false), _scriptWatcherRunning(false), _scriptWatcherThread()
 {
     accumulator = std::chrono::nanoseconds(0);
     lastScriptTimer = std::chrono::high_resolution_clock::now();
@@ -43,26 +111,56 @@ bool CScriptEngine::Initialize()
 	SCRIPTENV_D("---START SCRIPT---\n%s\n---END SCRIPT\n\n", bootstrapScript.text());
 
 	// TODO(joey): Clean this the fuck up
-	_env = new V8ScriptEnv();
-	_env->Initialize();
+	V8ScriptEnv *env = new V8ScriptEnv();
 
-	_env->CallFunctionInScope([&]() -> void {
-		CScriptEngine *engine = this;
+	// Start from the startup snapshot if it was made from this bootstrap.
+	if (_server->getSettings()->getBool("scriptsnapshot", false))
+	{
+		CString snapshotFile = CString() << _server->getServerPath() << "v8snapshot.bin";
+		if (!env->LoadSnapshot(snapshotFile.text(), getSnapshotTag(bootstrapScript), getExternalReferences()))
+			_server->getServerLog().out("[%s] Script snapshot is missing or out of date, run the server with --v8-snapshot to rebuild it.\n", _server->getName().text());
+	}
 
-		// Bind global functions
-		bindGlobalFunctions(engine);
+	env->Initialize();
+	env->Isolate()->SetData(V8ENV_ENGINE_SLOT, this);
 
-		// Bind classes to be used for scripts
-		bindClass_Environment(engine);
-		bindClass_Server(engine);
-		bindClass_Level(engine);
-		bindClass_NPC(engine);
-		bindClass_Player(engine);
-		bindClass_Weapon(engine);
-	});
+	// Keep compiled scripts on disk so restarts don't have to compile everything again.
+	if (_server->getSettings()->getBool("scriptcodecache", true))
+	{
+		CString cachePath = CString() << _server->getServerPath() << "scriptcache/";
+#if defined(_WIN32) || defined(_WIN64)
+		mkdir(cachePath.text());
+#else
+		mkdir(cachePath.text(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+#endif
+		pruneCodeCache(_server);
+		env->SetCodeCachePath(cachePath.text());
+	}
+	_env = env;
 
-	// Create a new context (occurs on initial compile)
-	_bootstrapFunction = _env->Compile("bootstrap", bootstrapScript.text());
+	// Script time limits, in milliseconds
+	_scriptSoftLimit = std::chrono::milliseconds(_server->getSettings()->getInt("scriptsoftlimit", 20));
+	_scriptHardLimit = std::chrono::milliseconds(std::max(_server->getSettings()->getInt("scripthardlimit", 500), 100));
+	_coalesceEvents = _server->getSettings()->getBool("scriptcoalesce", true);
+	_dormantNpcs = _server->getSettings()->getBool("scriptdormant", false);
+
+	if (env->HasSnapshot())
+	{
+		// The snapshot already holds the bindings, the context, and the bootstrap function
+		_bootstrapFunction = env->RestoreSnapshot();
+		if (!_bootstrapFunction)
+		{
+			_server->getServerLog().out("[%s] ** [Error] Could not restore the script snapshot.\n", _server->getName().text());
+			return false;
+		}
+	}
+	else
+	{
+		BindClasses();
+
+		// Create a new context (occurs on initial compile)
+		_bootstrapFunction = _env->Compile("bootstrap", bootstrapScript.text());
+	}
 	assert(_bootstrapFunction);
 
 	// Bind the server into two separate objects
@@ -82,6 +180,45 @@ bool CScriptEngine::Initialize()
 	return true;
 }
 
+bool CScriptEngine::CreateSnapshot(const std::string& serverPath)
+{
+	CString bootstrapScript;
+	if (!bootstrapScript.load(CString() << serverPath << "bootstrap.js"))
+		return false;
+
+	// Bindings only look up the engine when they are called, so no server is needed to build them
+	CScriptEngine engine(nullptr);
+	V8ScriptEnv *env = new V8ScriptEnv();
+	env->SetSnapshotCreator(getExternalReferences());
+	env->Initialize();
+	engine._env = env;
+	engine.BindClasses();
+
+	IScriptFunction *bootstrapFunction = env->Compile("bootstrap", bootstrapScript.text());
+	if (!bootstrapFunction)
+		return false;
+
+	return env->SaveSnapshot(serverPath + "v8snapshot.bin", getSnapshotTag(bootstrapScript), bootstrapFunction);
+}
+
+void CScriptEngine::BindClasses()
+{
+	_env->CallFunctionInScope([&]() -> void {
+		CScriptEngine *engine = this;
+
+		// Bind global functions
+		bindGlobalFunctions(engine);
+
+		// Bind classes to be used for scripts
+		bindClass_Environment(engine);
+		bindClass_Server(engine);
+		bindClass_Level(engine);
+		bindClass_NPC(engine);
+		bindClass_Player(engine);
+		bindClass_Weapon(engine);
+	});
+}
+
 void CScriptEngine::ScriptWatcher()
 {
 	const std::chrono::milliseconds sleepTime(50);
@@ -97,12 +234,12 @@ void CScriptEngine::ScriptWatcher()
 				time_diff = std::chrono::duration_cast<std::chrono::milliseconds>(time_now - _scriptStartTime);
 			}
 
-			if (time_diff.count() >= 500) {
+			if (time_diff >= _scriptHardLimit) {
 				_env->TerminateExecution();
 				_scriptIsRunning.store(false);
 				//printf("Killed execution for running too long!\n");
 			}
-			else if (time_diff.count() < 450)
+			else if (time_diff < _scriptHardLimit - sleepTime)
 				std::this_thread::sleep_for(sleepTime);
 		}
 		else std::this_thread::sleep_for(sleepTime);
@@ -131,6 +268,12 @@ void CScriptEngine::Cleanup(bool shutDown)
 	}
 	_callbacks.clear();
 
+	// Wait out any background compiles
+	for (auto & _pendingCompile : _pendingCompiles) {
+		delete _pendingCompile.second.job;
+	}
+	_pendingCompiles.clear();
+
 	// Remove cached scripts
 	for (auto & _cachedScript : _cachedScripts) {
 		delete _cachedScript.second;
@@ -162,19 +305,22 @@ void CScriptEngine::Cleanup(bool shutDown)
 	_env = nullptr;
 }
 
-IScriptFunction * CScriptEngine::CompileCache(const std::string& code, bool referenceCount)
+IScriptFunction * CScriptEngine::FindCache(const std::string& cacheKey, bool referenceCount)
 {
-	// TODO(joey): Temporary naming conventions, maybe pass an optional reference to an object which holds info for the compiler (name, ignore wrap code based off spaces/lines, and execution results?)
-	static int SCRIPT_ID = 1;
+	auto scriptFunctionIter = _cachedScripts.find(cacheKey);
+	if (scriptFunctionIter == _cachedScripts.end())
+		return nullptr;
 
-	auto scriptFunctionIter = _cachedScripts.find(code);
-	if (scriptFunctionIter != _cachedScripts.end())
-	{
-		if (referenceCount)
-			scriptFunctionIter->second->increaseReference();
-		return scriptFunctionIter->second;
-	}
+	if (referenceCount)
+		scriptFunctionIter->second->increaseReference();
+	return scriptFunctionIter->second;
+}
+
+// TODO(joey): Temporary naming conventions, maybe pass an optional reference to an object which holds info for the compiler (name, ignore wrap code based off spaces/lines, and execution results?)
+static int SCRIPT_ID = 1;
 
+IScriptFunction * CScriptEngine::CompileScript(const std::string& cacheKey, const std::string& code, bool referenceCount)
+{
 	// Compile script, send errors to server
 	SCRIPTENV_D("Compiling script:\n---\n%s\n---\n", code.c_str());
 
@@ -192,13 +338,81 @@ IScriptFunction * CScriptEngine::CompileCache(const std::string& code, bool refe
 	// Increase reference count to compiled script, and cache it.
 	if (referenceCount)
 		compiledScript->increaseReference();
-	_cachedScripts[code] = compiledScript;
+	_cachedScripts[cacheKey] = compiledScript;
 	return compiledScript;
 }
 
-bool CScriptEngine::ClearCache(const std::string& code)
+void CScriptEngine::QueueCompile(const std::string& cacheKey, const std::string& code, std::function<void(bool)> callback)
+{
+	// Scripts already being compiled just get another callback
+	auto compileIter = _pendingCompiles.find(cacheKey);
+	if (compileIter == _pendingCompiles.end())
+	{
+		ScriptCompile scriptCompile;
+		scriptCompile.job = _env->StartCompile(std::to_string(SCRIPT_ID++), code);
+		compileIter = _pendingCompiles.emplace(cacheKey, std::move(scriptCompile)).first;
+	}
+
+	compileIter->second.callbacks.push_back(std::move(callback));
+}
+
+void CScriptEngine::RunCompiles()
+{
+	if (_pendingCompiles.empty())
+		return;
+
+	// Callbacks can queue new compiles, so take the finished ones out first
+	std::vector<std::pair<std::string, ScriptCompile>> finished;
+	for (auto it = _pendingCompiles.begin(); it != _pendingCompiles.end(); )
+	{
+		if (it->second.job->isReady())
+		{
+			finished.emplace_back(it->first, std::move(it->second));
+			it = _pendingCompiles.erase(it);
+		}
+		else ++it;
+	}
+
+	for (auto & compile : finished)
+	{
+		// Failed scripts are reported once here, and the callbacks leave the old script in place
+		IScriptFunction *compiledScript = _env->FinishCompile(compile.second.job);
+		bool compiled = (compiledScript != nullptr);
+		if (!compiled)
+		{
+			auto scriptError = _env->getScriptError();
+			_server->reportScriptException(scriptError);
+			SCRIPTENV_D("Error Compiling: %s\n", scriptError.getErrorString().c_str());
+		}
+		else
+		{
+			// Somebody compiled it on this thread in the meantime
+			if (!_cachedScripts.emplace(compile.first, compiledScript).second)
+			{
+				delete compiledScript;
+				compiledScript = nullptr;
+			}
+		}
+
+		for (auto & callback : compile.second.callbacks)
+			callback(compiled);
+
+		// Nobody ended up using it
+		if (compiledScript != nullptr && !compiledScript->isReferenced())
+		{
+			auto cacheIter = _cachedScripts.find(compile.first);
+			if (cacheIter != _cachedScripts.end() && cacheIter->second == compiledScript)
+			{
+				_cachedScripts.erase(cacheIter);
+				delete compiledScript;
+			}
+		}
+	}
+}
+
+bool CScriptEngine::RemoveCache(const std::string& cacheKey)
 {
-	auto scriptFunctionIter = _cachedScripts.find(code);
+	auto scriptFunctionIter = _cachedScripts.find(cacheKey);
 	if (scriptFunctionIter == _cachedScripts.end())
 		return false;
 
@@ -217,19 +431,18 @@ bool CScriptEngine::ExecuteNpc(TNPC *npc)
 {
 	SCRIPTENV_D("Begin Global::ExecuteNPC()\n\n");
 
-	// We always want to create an object for the npc
-	IScriptWrapped<TNPC> *wrappedObject = WrapObject(npc);
+	// We always want to create an object for the npc, dormant npcs already have one
+	IScriptWrapped<TNPC> *wrappedObject = npc->getScriptObject();
+	if (wrappedObject == nullptr)
+		wrappedObject = WrapObject(npc);
 
 	// No script, nothing to execute.
-	CString npcScript = npc->getServerScript();
+	const CString& npcScript = npc->getServerScript();
 	if (npcScript.isEmpty())
 		return false;
 
-	// Wrap user code in a function-object, returning some useful symbols to call for events
-	std::string codeStr = WrapScript<TNPC>(npcScript.text());
-
-	// Search the cache, or compile the script
-	IScriptFunction *compiledScript = CompileCache(codeStr);
+	// Search the cache, or wrap user code in a function-object and compile it
+	IScriptFunction *compiledScript = CompileCache<TNPC>(npcScript.text(), npc->getServerScriptHash());
 
 	// Script failed to compile
 	if (compiledScript == nullptr)
@@ -258,15 +471,13 @@ bool CScriptEngine::ExecuteWeapon(TWeapon *weapon)
 	// Wrap object
 	IScriptWrapped<TWeapon> *wrappedObject = WrapObject(weapon);
 
-	// Wrap user code in a function-object, returning some useful symbols to call for events
-	CString weaponScript = weapon->getServerScript();
+	// No script, nothing to execute.
+	const CString& weaponScript = weapon->getServerScript();
 	if (weaponScript.isEmpty())
 		return false;
 
-	std::string codeStr = WrapScript<TWeapon>(weaponScript.text());
-
-	// Search the cache, or compile the script
-	IScriptFunction *compiledScript = CompileCache(codeStr);
+	// Search the cache, or wrap user code in a function-object and compile it
+	IScriptFunction *compiledScript = CompileCache<TWeapon>(weaponScript.text(), weapon->getServerScriptHash());
 
 	// Script failed to compile
 	if (compiledScript == nullptr)
@@ -313,6 +524,9 @@ void CScriptEngine::RunTimers(const std::chrono::high_resolution_clock::time_poi
 
 void CScriptEngine::RunScripts(const std::chrono::high_resolution_clock::time_point& time)
 {
+	// Swap in scripts that finished compiling in the background
+	RunCompiles();
+
     RunTimers(time);
 
 	if (!_updateNpcs.empty() || !_updateWeapons.empty())
@@ -331,9 +545,16 @@ void CScriptEngine::RunScripts(const std::chrono::high_resolution_clock::time_po
 			}
 
 			// Iterate over weapons
-			for (auto weapon : _updateWeapons)
-				weapon->runScriptEvents();
-			_updateWeapons.clear();
+			for (auto it = _updateWeapons.begin(); it != _updateWeapons.end(); )
+			{
+				TWeapon *weapon = *it;
+				bool hasActions = weapon->runScriptEvents();
+
+				if (!hasActions)
+					it = _updateWeapons.erase(it);
+				else
+					it++;
+			}
 		});
 	}
 
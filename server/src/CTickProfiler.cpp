@@ -0,0 +1,121 @@
+#include "IDebug.h"
+#include <cstring>
+#include "CTickProfiler.h"
+
+static const char* phaseNames[TICKPHASE_COUNT] =
+{
+	"sockets", "packets", "send", "scripts", "logins", "serverlist",
+	"playerevents", "levelevents", "saves", "filesystem"
+};
+
+static unsigned long long getMicros(std::chrono::steady_clock::duration duration)
+{
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+void CTickProfiler::beginTick()
+{
+	memset(&current, 0, sizeof(current));
+	memset(ran, 0, sizeof(ran));
+	depth = 0;
+	waiting = false;
+	tickStart = std::chrono::steady_clock::now();
+}
+
+unsigned long long CTickProfiler::endTick()
+{
+	current.time = time(0);
+	unsigned long long elapsed = getMicros(std::chrono::steady_clock::now() - tickStart);
+	current.total = (elapsed > current.wait ? elapsed - current.wait : 0);
+
+	// Phases that didn't run this tick would only fill their histograms with zeros.
+	ticks.record(current.total);
+	waits.record(current.wait);
+	for (int i = 0; i < TICKPHASE_COUNT; ++i)
+	{
+		if (ran[i])
+			phases[i].record(current.phases[i]);
+	}
+
+	lastTick = current;
+	if (current.total >= worstTick.total)
+		worstTick = current;
+	return current.total;
+}
+
+void CTickProfiler::beginPhase(int phase)
+{
+	if (depth < TICKPROFILER_DEPTH)
+	{
+		stack[depth].phase = phase;
+		stack[depth].start = std::chrono::steady_clock::now();
+		stack[depth].inner = 0;
+	}
+	++depth;
+}
+
+void CTickProfiler::endPhase()
+{
+	if (depth == 0)
+		return;
+
+	--depth;
+	if (depth >= TICKPROFILER_DEPTH)
+		return;
+
+	SPhaseFrame& frame = stack[depth];
+	unsigned long long elapsed = getMicros(std::chrono::steady_clock::now() - frame.start);
+	current.phases[frame.phase] += (elapsed > frame.inner ? elapsed - frame.inner : 0);
+	ran[frame.phase] = true;
+
+	// Take it out of the phase this one ran inside of.
+	if (depth > 0)
+		stack[depth - 1].inner += elapsed;
+}
+
+void CTickProfiler::beginWait()
+{
+	waiting = true;
+	waitStart = std::chrono::steady_clock::now();
+}
+
+void CTickProfiler::endWait()
+{
+	if (!waiting)
+		return;
+
+	waiting = false;
+	unsigned long long elapsed = getMicros(std::chrono::steady_clock::now() - waitStart);
+	current.wait += elapsed;
+
+	// Take it out of the phase we waited in, like an inner phase.
+	if (depth > 0 && depth <= TICKPROFILER_DEPTH)
+		stack[depth - 1].inner += elapsed;
+}
+
+void CTickProfiler::reset()
+{
+	ticks.reset();
+	waits.reset();
+	for (int i = 0; i < TICKPHASE_COUNT; ++i)
+		phases[i].reset();
+	memset(&current, 0, sizeof(current));
+	memset(&lastTick, 0, sizeof(lastTick));
+	memset(&worstTick, 0, sizeof(worstTick));
+	memset(ran, 0, sizeof(ran));
+	depth = 0;
+	waiting = false;
+	tickStart = startTime = std::chrono::steady_clock::now();
+}
+
+double CTickProfiler::getSeconds() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+const char* CTickProfiler::getPhaseName(int phase)
+{
+	if (phase < 0 || phase >= TICKPHASE_COUNT)
+		return "unknown";
+	return phaseNames[phase];
+}
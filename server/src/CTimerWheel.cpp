@@ -0,0 +1,110 @@
+#include "IDebug.h"
+#include "CTimerWheel.h"
+
+/*
+	CTimer
+*/
+CTimer::CTimer()
+: wheel(nullptr), prev(this), next(this), expires(0)
+{
+}
+
+CTimer::~CTimer()
+{
+	unlink();
+}
+
+void CTimer::cancel()
+{
+	unlink();
+}
+
+int CTimer::getTicksLeft() const
+{
+	if (wheel == nullptr)
+		return 0;
+	return (int)(expires - wheel->currentTick);
+}
+
+void CTimer::link(CTimer* head)
+{
+	prev = head->prev;
+	next = head;
+	head->prev->next = this;
+	head->prev = this;
+}
+
+void CTimer::unlink()
+{
+	if (wheel == nullptr)
+		return;
+
+	prev->next = next;
+	next->prev = prev;
+	prev = next = this;
+	--wheel->timerCount;
+	wheel = nullptr;
+}
+
+/*
+	CTimerWheel
+*/
+CTimerWheel::CTimerWheel(unsigned int pSlots)
+: slots(pSlots > 0 ? pSlots : 1), currentTick(0), timerCount(0)
+{
+}
+
+CTimerWheel::~CTimerWheel()
+{
+	// Let go of every timer still waiting, so their owners can be deleted after us.
+	for (auto& slot : slots)
+	{
+		while (slot.next != &slot)
+			slot.next->unlink();
+	}
+	while (firing.next != &firing)
+		firing.next->unlink();
+}
+
+void CTimerWheel::schedule(CTimer* pTimer, int pTicks)
+{
+	pTimer->unlink();
+	if (pTicks < 1)
+		return;
+
+	pTimer->expires = currentTick + (unsigned int)pTicks;
+	pTimer->link(&slots[pTimer->expires % slots.size()]);
+	pTimer->wheel = this;
+	++timerCount;
+}
+
+void CTimerWheel::tick()
+{
+	++currentTick;
+
+	// Timers a full turn or more away share the slot, so only take the ones due now.
+	CTimer* slot = &slots[currentTick % slots.size()];
+	for (CTimer* timer = slot->next; timer != slot; )
+	{
+		CTimer* nextTimer = timer->next;
+		if (timer->expires == currentTick)
+		{
+			timer->prev->next = timer->next;
+			timer->next->prev = timer->prev;
+			timer->link(&firing);
+		}
+		timer = nextTimer;
+	}
+
+	// A callback can delete or reschedule any other timer, which takes it off the firing list.
+	// The callback is copied since it can also delete the object that holds its own timer.
+	while (firing.next != &firing)
+	{
+		CTimer* timer = firing.next;
+		timer->unlink();
+
+		std::function<void()> callback = timer->callback;
+		if (callback)
+			callback();
+	}
+}
@@ -1,4 +1,5 @@
 #include "IDebug.h"
+#include <algorithm>
 #include "CLog.h"
 #include "IEnums.h"
 #include "CWordFilter.h"
@@ -34,6 +35,23 @@ static char toUpper(char c)
 	return c;
 }
 
+static bool isBypass(char c)
+{
+	for (int b = 0; b < sizeof(bypass); ++b)
+	{
+		if (c == bypass[b])
+			return true;
+	}
+	return false;
+}
+
+static bool meetsPrecision(const SWordFilterRule* rule, int wordsMatched)
+{
+	if (rule->precisionPercentage == false && wordsMatched < rule->precision) return false;
+	if (rule->precisionPercentage == true && rule->precision > (int)(((float)wordsMatched / (float)rule->match.length()) * 100)) return false;
+	return true;
+}
+
 CWordFilter::~CWordFilter()
 {
 	for (std::vector<SWordFilterRule*>::iterator i = rules.begin(); i != rules.end();)
@@ -161,6 +179,255 @@ void CWordFilter::load(const CString& file)
 				showWordsToRC = true;
 		}
 	}
+
+	compile();
+}
+
+/*
+	CWordFilter: Compiling
+*/
+// Fewest letters a rule has to match to meet its precision, or -1 if it never can.
+static int getRequiredMatches(const SWordFilterRule* rule)
+{
+	for (int wordsMatched = 0; wordsMatched <= rule->match.length(); ++wordsMatched)
+	{
+		if (meetsPrecision(rule, wordsMatched))
+			return wordsMatched;
+	}
+	return -1;
+}
+
+void CWordFilter::compile()
+{
+	keys.clear();
+	nodes.clear();
+	nodes.emplace_back();
+	unindexedRules.clear();
+
+	for (unsigned int r = 0; r < rules.size(); ++r)
+	{
+		SWordFilterRule* rule = rules[r];
+		rule->indexed = false;
+		if (rule->match.isEmpty())
+		{
+			unindexedRules.push_back(r);
+			continue;
+		}
+
+		// Only letters and ? count towards the precision.  Find the runs of letters.
+		int letters = 0, wildcards = 0;
+		std::vector<std::pair<int, int>> runs;
+		for (int i = 0; i < rule->match.length(); ++i)
+		{
+			char letter = rule->match[i];
+			if (letter == '?')
+				wildcards++;
+			else if (isLower(letter) || isUpper(letter))
+			{
+				letters++;
+				if (!runs.empty() && runs.back().first + runs.back().second == i)
+					runs.back().second++;
+				else runs.emplace_back(i, 1);
+			}
+		}
+
+		// A rule that can never meet its precision never needs checking.
+		int required = getRequiredMatches(rule);
+		int misses = letters + wildcards - required;
+		if (required == -1 || misses < 0)
+		{
+			rule->indexed = true;
+			continue;
+		}
+
+		// If at most `misses` letters can be wrong, one of misses + 1 separate runs has to match in full.
+		// Rules that allow too many misses for that are checked everywhere.
+		if (required == 0 || misses + 1 > letters)
+		{
+			unindexedRules.push_back(r);
+			continue;
+		}
+
+		// Split the longest runs until there are enough of them, then key on the longest.
+		while ((int)runs.size() < misses + 1)
+		{
+			auto longest = std::max_element(runs.begin(), runs.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.second < b.second; });
+			int half = longest->second / 2;
+			std::pair<int, int> tail(longest->first + half, longest->second - half);
+			longest->second = half;
+			runs.insert(longest + 1, tail);
+		}
+
+		std::stable_sort(runs.begin(), runs.end(), [](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.second > b.second; });
+		runs.resize(misses + 1);
+		for (auto & run : runs)
+			addKey(rule->match, r, run.first, run.second);
+		rule->indexed = true;
+	}
+
+	// Link every node to the longest suffix of it that is also in the tree, breadth first.
+	std::vector<int> queue;
+	for (auto & edge : nodes[0].next)
+		queue.push_back(edge.second);
+
+	for (size_t q = 0; q < queue.size(); ++q)
+	{
+		int node = queue[q];
+		for (auto & edge : nodes[node].next)
+		{
+			int child = edge.second;
+			int fail = nodes[node].fail;
+			while (true)
+			{
+				auto next = std::lower_bound(nodes[fail].next.begin(), nodes[fail].next.end(), std::make_pair(edge.first, 0));
+				if (next != nodes[fail].next.end() && next->first == edge.first)
+				{
+					fail = next->second;
+					break;
+				}
+				if (fail == 0)
+					break;
+				fail = nodes[fail].fail;
+			}
+
+			nodes[child].fail = fail;
+			nodes[child].output = (nodes[fail].keys.empty() ? nodes[fail].output : fail);
+			queue.push_back(child);
+		}
+	}
+}
+
+void CWordFilter::addKey(const CString& match, unsigned int rule, int offset, int length)
+{
+	int node = 0;
+	for (int i = offset; i < offset + length; ++i)
+	{
+		char letter = toLower(match[i]);
+		auto next = std::lower_bound(nodes[node].next.begin(), nodes[node].next.end(), std::make_pair(letter, 0));
+		if (next != nodes[node].next.end() && next->first == letter)
+		{
+			node = next->second;
+			continue;
+		}
+
+		int child = (int)nodes.size();
+		nodes[node].next.insert(next, std::make_pair(letter, child));
+		nodes.emplace_back();
+		node = child;
+	}
+
+	nodes[node].keys.push_back((int)keys.size());
+	keys.push_back({ rule, offset, length });
+}
+
+int CWordFilter::getNext(int node, char c) const
+{
+	while (true)
+	{
+		auto next = std::lower_bound(nodes[node].next.begin(), nodes[node].next.end(), std::make_pair(c, 0));
+		if (next != nodes[node].next.end() && next->first == c)
+			return next->second;
+		if (node == 0)
+			return 0;
+		node = nodes[node].fail;
+	}
+}
+
+void CWordFilter::search(const CString& text, int check, std::vector<std::pair<unsigned int, int>>& hits) const
+{
+	if (keys.empty())
+		return;
+
+	// Each hit is a rule, and where in the text the rule's match would start.
+	int node = 0;
+	for (int i = 0; i < text.length(); ++i)
+	{
+		node = getNext(node, toLower(text[i]));
+		for (int found = (nodes[node].keys.empty() ? nodes[node].output : node); found != -1; found = nodes[found].output)
+		{
+			for (int k : nodes[found].keys)
+			{
+				const SWordFilterKey& key = keys[k];
+				int start = i - key.length + 1 - key.offset;
+				if ((rules[key.rule]->check & check) != 0 && start >= 0)
+					hits.push_back(std::make_pair(key.rule, start));
+			}
+		}
+	}
+}
+
+/*
+	CWordFilter: Matching
+*/
+// Start and full rules check whole words.
+static bool matchWord(const SWordFilterRule* rule, const CString& word)
+{
+	// If we are checking for a full word and the words aren't the same length, go to the next word.
+	if (rule->wordPosition == FILTER_POSITION_FULL && word.length() != rule->match.length()) return false;
+
+	// See if it matches the rule.
+	int wordsMatched = 0;
+	for (int chatpos = 0; chatpos < rule->match.length() && chatpos < word.length(); ++chatpos)
+	{
+		char letter = rule->match[chatpos];
+		char wordletter = word[chatpos];
+		if (letter == '?')
+		{
+			wordsMatched++;
+			continue;
+		}
+		if (isLower(letter) && letter == toLower(wordletter))
+			wordsMatched++;
+		else if (isUpper(letter))
+		{
+			if (toLower(letter) == toLower(wordletter)) wordsMatched++;
+			else return false;
+		}
+	}
+
+	// Check and see if we hit the limit.
+	return meetsPrecision(rule, wordsMatched);
+}
+
+// Part rules can match anywhere in the chat, and skip over spaces.  The text that matched is put in word.
+static bool matchPart(const SWordFilterRule* rule, const CString& chat, int wordpos, CString& word)
+{
+	// Don't start on an empty space.
+	if (!rule->match.isEmpty() && isBypass(chat[wordpos]))
+		return false;
+
+	// See if it matches the rule.
+	int wordsMatched = 0;
+	for (int chatpos = 0; chatpos < rule->match.length() && wordpos + chatpos < chat.length(); ++chatpos)
+	{
+		// Don't count empty spaces.
+		while (isBypass(chat[wordpos + chatpos]))
+		{
+			word << chat[wordpos + chatpos];
+			++wordpos;
+		}
+
+		// Check letter for match.
+		char letter = rule->match[chatpos];
+		char wordletter = chat[wordpos + chatpos];
+		if (letter == '?')
+		{
+			word << wordletter;
+			wordsMatched++;
+			continue;
+		}
+		if (isLower(letter) && letter == toLower(wordletter))
+			wordsMatched++;
+		else if (isUpper(letter))
+		{
+			if (toLower(letter) == toLower(wordletter)) wordsMatched++;
+			else return false;
+		}
+		word << wordletter;
+	}
+
+	// Check and see if we hit the limit.
+	return meetsPrecision(rule, wordsMatched);
 }
 
 int CWordFilter::apply(const TPlayer* player, CString& chat, int check)
@@ -173,53 +440,86 @@ int CWordFilter::apply(const TPlayer* player, CString& chat, int check)
 	std::vector<CString> wordsFound;
 	int actionsFound = 0;
 
-	for (std::vector<SWordFilterRule*>::iterator i = rules.begin(); i != rules.end(); ++i)
+	// Find everywhere a rule could match in one pass over the chat, and only check the rules there.
+	// Part rules skip spaces, so they are searched for in the chat with its spaces taken out.
+	// Each hit is a rule and the chat position (part rules) or word (start and full rules) to check it at.
+	std::vector<std::pair<unsigned int, int>>& hits = hitBuffer;
+	hits.clear();
 	{
-		SWordFilterRule* rule = *i;
+		CString& compact = compactBuffer;
+		std::vector<int>& compactPos = compactPosBuffer;
+		compact.clear();
+		compactPos.clear();
+		for (int p = 0; p < chat.length(); ++p)
+		{
+			if (isBypass(chat[p])) continue;
+			compact << chat[p];
+			compactPos.push_back(p);
+		}
+
+		search(compact, check, hits);
+		size_t kept = 0;
+		for (size_t h = 0; h < hits.size(); ++h)
+		{
+			if (rules[hits[h].first]->wordPosition == FILTER_POSITION_PART)
+				hits[kept++] = std::make_pair(hits[h].first, compactPos[hits[h].second]);
+		}
+		hits.resize(kept);
+
+		for (int j = 0; j < (int)chatWords.size(); ++j)
+		{
+			size_t first = hits.size();
+			search(chatWords[j], check, hits);
+
+			kept = first;
+			for (size_t h = first; h < hits.size(); ++h)
+			{
+				if (rules[hits[h].first]->wordPosition != FILTER_POSITION_PART && hits[h].second == 0)
+					hits[kept++] = std::make_pair(hits[h].first, j);
+			}
+			hits.resize(kept);
+		}
+
+		std::sort(hits.begin(), hits.end());
+		hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+	}
+
+	// Only the rules that were hit, and the ones without keys, are checked.  They still go in rule order.
+	size_t nextHit = 0, nextUnindexed = 0;
+	while (nextHit < hits.size() || nextUnindexed < unindexedRules.size())
+	{
+		unsigned int r;
+		std::vector<int>& candidates = candidateBuffer;
+		candidates.clear();
+		if (nextUnindexed < unindexedRules.size() && (nextHit == hits.size() || unindexedRules[nextUnindexed] < hits[nextHit].first))
+			r = unindexedRules[nextUnindexed++];
+		else
+		{
+			r = hits[nextHit].first;
+			for (; nextHit < hits.size() && hits[nextHit].first == r; ++nextHit)
+				candidates.push_back(hits[nextHit].second);
+		}
+		SWordFilterRule* rule = rules[r];
 
 		// Check if we should use this rule.
 		if ((check & rule->check) == 0) continue;
 
+		// Rules without keys are checked at every word or position.
+		if (!rule->indexed)
+		{
+			int count = (rule->wordPosition != FILTER_POSITION_PART ? (int)chatWords.size() : chat.length());
+			for (int i = 0; i < count; ++i)
+				candidates.push_back(i);
+		}
+
 		// Start and full will check whole words.
 		if (rule->wordPosition != FILTER_POSITION_PART)
 		{
-			// Loop through each word of the chat.
-			for (std::vector<CString>::iterator j = chatWords.begin(); j != chatWords.end(); ++j)
+			// Loop through each word of the chat that could match.
+			for (int j : candidates)
 			{
-				CString* word = &(*j);
-
-				// If we are checking for a full word and the words aren't the same length, go to the next word.
-				if (rule->wordPosition == FILTER_POSITION_FULL && word->length() != rule->match.length()) continue;
-
-				// See if it matches the rule.
-				int wordsMatched = 0;
-				bool failed = false;
-				for (int chatpos = 0; chatpos < rule->match.length() && chatpos < word->length(); ++chatpos)
-				{
-					char letter = rule->match[chatpos];
-					char wordletter = (*word)[chatpos];
-					if (letter == '?')
-					{
-						wordsMatched++;
-						continue;
-					}
-					if (isLower(letter) && letter == toLower(wordletter))
-						wordsMatched++;
-					else if (isUpper(letter))
-					{
-						if (toLower(letter) == toLower(wordletter)) wordsMatched++;
-						else
-						{
-							failed = true;
-							break;
-						}
-					}
-				}
-				if (failed) continue;
-
-				// Check and see if we hit the limit.
-				if (rule->precisionPercentage == false && wordsMatched < rule->precision) continue;
-				if (rule->precisionPercentage == true && rule->precision > (int)(((float)wordsMatched / (float)rule->match.length()) * 100)) continue;
+				CString* word = &chatWords[j];
+				if (!matchWord(rule, *word)) continue;
 
 				// Add the word to the list of words found.
 				wordsFound.push_back(*word);
@@ -250,76 +550,10 @@ int CWordFilter::apply(const TPlayer* player, CString& chat, int check)
 		}
 		else if (rule->wordPosition == FILTER_POSITION_PART)
 		{
-			for (int wordpos = 0; wordpos < chat.length(); ++wordpos)
+			for (int wordpos : candidates)
 			{
-				int wordStart = wordpos;
-
-				// See if it matches the rule.
-				int wordsMatched = 0;
-				bool failed = false;
 				CString word;
-				for (int chatpos = 0; chatpos < rule->match.length() && wordpos + chatpos < chat.length(); ++chatpos)
-				{
-					// Don't start on an empty space.
-					if (wordpos + chatpos == wordStart)
-					{
-						bool found = false;
-						for (int b = 0; b < sizeof(bypass); ++b)
-						{
-							if (chat[wordpos + chatpos] == bypass[b])
-							{
-								failed = true;
-								found = true;
-								break;
-							}
-						}
-						if (found) break;
-					}
-					
-					// Don't count empty spaces.
-					while (true)
-					{
-						bool found = false;
-						for (int b = 0; b < sizeof(bypass); ++b)
-						{
-							if (chat[wordpos + chatpos] == bypass[b])
-							{
-								found = true;
-								word << bypass[b];
-								++wordpos;
-							}
-						}
-						if (!found) break;
-					}
-
-					// Check letter for match.
-					char letter = rule->match[chatpos];
-					char wordletter = chat[wordpos + chatpos];
-					if (letter == '?')
-					{
-						word << wordletter;
-						wordsMatched++;
-						continue;
-					}
-					if (isLower(letter) && letter == toLower(wordletter))
-						wordsMatched++;
-					else if (isUpper(letter))
-					{
-						if (toLower(letter) == toLower(wordletter)) wordsMatched++;
-						else
-						{
-							failed = true;
-							break;
-						}
-					}
-					word << wordletter;
-				}
-				wordpos = wordStart;
-				if (failed) continue;
-
-				// Check and see if we hit the limit.
-				if (rule->precisionPercentage == false && wordsMatched < rule->precision) continue;
-				if (rule->precisionPercentage == true && rule->precision > (int)(((float)wordsMatched / (float)rule->match.length()) * 100)) continue;
+				if (!matchPart(rule, chat, wordpos, word)) continue;
 
 				// Trim the word.
 				word.trimI();
@@ -68,8 +68,12 @@ bool TAccount::loadAccount(const CString& pAccount, bool ignoreNickname)
 		loadedFromDefault = true;
 	}
 
-	// Load file.
-	fileData = CString::loadToken(accpath, "\n");
+	// Load file.  If a newer copy is still waiting on the account writer, use that instead.
+	CString pendingData;
+	if (!loadedFromDefault && server->getAccountSaver()->getPending(accpath, pendingData))
+		fileData = pendingData.tokenize("\n");
+	else
+		fileData = CString::loadToken(accpath, "\n");
 	if (fileData.empty() || fileData[0].trim() != "GRACC001")
 		return false;
 
@@ -325,11 +329,17 @@ bool TAccount::saveAccount()
 	CString accountFileName = server->getAccountsFileSystem()->fileExistsAs(CString() << accountName << ".txt");
 	if (accountFileName.isEmpty()) accountFileName = CString() << accountName << ".txt";
 
-	// Save the account now.
+	// Nothing changed since the last write, so skip it.
 	CString accpath = CString() << server->getServerPath() << "accounts/" << accountFileName;
 	CFileSystem::fixPathSeparators(&accpath);
-	if (!newFile.save(accpath))
-		server->getRCLog().out("** Error saving account: %s\n", accountName.text());
+	if (accpath == lastSavedPath && newFile == lastSavedData)
+		return true;
+
+	// Hand the snapshot off to the account writer.
+	server->getAccountSaver()->queue(accountName, accpath, newFile);
+	server->getAccountIndex()->update(accountFileName, newFile);
+	lastSavedPath = accpath;
+	lastSavedData = newFile;
 
 	return true;
 }
@@ -1,4 +1,4 @@
-#include <set>
+#include <algorithm>
 #include <tiletypes.h>
 #include <cmath>
 #include "IDebug.h"
@@ -23,7 +23,7 @@ short respawningTiles[] = {
 */
 TLevel::TLevel(TServer* pServer)
 :
-server(pServer), modTime(0), levelSpar(false), levelSingleplayer(false)
+server(pServer), modTime(0), lastUsed(time(0)), levelSpar(false), levelSingleplayer(false)
 #ifdef V8NPCSERVER
 , _scriptObject(0)
 #endif
@@ -188,6 +188,10 @@ CString TLevel::getNpcsPacket(time_t time, int clientVersion)
 	for (std::vector<TNPC *>::iterator i = levelNPCs.begin(); i != levelNPCs.end(); ++i)
 	{
 		TNPC* npc = *i;
+#ifdef V8NPCSERVER
+		// Somebody is about to see the npc, so its script has to run.
+		npc->wakeScript();
+#endif
 		retVal >> (char)PLO_NPCPROPS >> (int)npc->getId() << npc->getProps(time, clientVersion) << "\n";
 	}
 	return retVal;
@@ -219,6 +223,9 @@ bool TLevel::reload()
 			TNPC *npc = *it;
 			if (npc->isLevelNPC())
 			{
+#ifdef V8NPCSERVER
+				removeNPCBounds(npc);
+#endif
 				server->deleteNPC(npc, false);
 				it = levelNPCs.erase(it);
 			}
@@ -309,6 +316,185 @@ TLevel* TLevel::clone()
 	return level;
 }
 
+/*
+	TLevel: Unloading
+*/
+bool TLevel::canUnload() const
+{
+	if (!levelPlayerList.empty())
+		return false;
+
+	for (auto npc : levelNPCs)
+	{
+		// Database npcs aren't in the level file, so they would be lost.
+		if (!npc->isLevelNPC())
+			return false;
+
+#ifdef V8NPCSERVER
+		// Npcs saved with the server, and level npcs with a timer running, are still doing something.  A server
+		// script that has run can hold state the level file doesn't have, like this. variables or a moved npc.
+		if (npc->getPersist() || npc->hasTimerUpdates() || (!npc->getServerScript().isEmpty() && !npc->isScriptDormant()))
+			return false;
+#endif
+	}
+	return true;
+}
+
+CString TLevel::getState() const
+{
+	CString state;
+	if (levelBoardChanges.empty() && levelItems.empty() && levelHorses.empty() && levelBaddies.empty())
+		return state;
+
+	state >> (short)levelBoardChanges.size();
+	for (auto change : levelBoardChanges)
+	{
+		CString tiles = change->getTiles();
+		CString oldTiles = change->getOldTiles();
+		state >> (char)change->getX() >> (char)change->getY() >> (char)change->getWidth() >> (char)change->getHeight()
+			>> (short)tiles.length() << tiles >> (short)oldTiles.length() << oldTiles
+			>> (long long)change->getModTime() >> (int)change->timer.getTicksLeft();
+	}
+
+	state >> (short)levelItems.size();
+	for (auto item : levelItems)
+		state >> (char)(item->getX() * 2) >> (char)(item->getY() * 2) >> (char)item->getItem() >> (int)item->timer.getTicksLeft();
+
+	state >> (short)levelHorses.size();
+	for (auto horse : levelHorses)
+	{
+		state >> (char)horse->getImage().length() << horse->getImage()
+			>> (char)(horse->getX() * 2) >> (char)(horse->getY() * 2) >> (char)horse->getDir() >> (char)horse->getBushes()
+			>> (int)horse->timer.getTicksLeft();
+	}
+
+	state >> (char)levelBaddies.size();
+	for (auto baddy : levelBaddies)
+	{
+		CString props = baddy->getProps();
+		state >> (char)baddy->getId() >> (char)(baddy->getStartX() * 2) >> (char)(baddy->getStartY() * 2)
+			>> (char)baddy->getType() >> (char)(baddy->getRespawn() ? 1 : 0)
+			>> (short)props.length() << props >> (int)baddy->timer.getTicksLeft();
+	}
+
+	return state;
+}
+
+void TLevel::setState(CString& pState)
+{
+	CTimerWheel* wheel = server->getTimerWheel();
+
+	unsigned short changeCount = pState.readGUShort();
+	for (unsigned short i = 0; i < changeCount; ++i)
+	{
+		int x = pState.readGUChar();
+		int y = pState.readGUChar();
+		int width = pState.readGUChar();
+		int height = pState.readGUChar();
+		CString tiles = pState.readChars(pState.readGUShort());
+		CString oldTiles = pState.readChars(pState.readGUShort());
+		time_t changeTime = (time_t)pState.readGInt5();
+		int ticksLeft = pState.readGInt();
+
+		TLevelBoardChange* change = new TLevelBoardChange(x, y, width, height, tiles, oldTiles);
+		change->setModTime(changeTime);
+		levelBoardChanges.push_back(change);
+		if (ticksLeft > 0)
+		{
+			change->timer.setCallback([this, change]() { doBoardChangeTimeout(change); });
+			wheel->schedule(&change->timer, ticksLeft);
+		}
+	}
+
+	unsigned short itemCount = pState.readGUShort();
+	for (unsigned short i = 0; i < itemCount; ++i)
+	{
+		float x = (float)pState.readGUChar() / 2.0f;
+		float y = (float)pState.readGUChar() / 2.0f;
+		signed char itemId = pState.readGChar();
+		int ticksLeft = pState.readGInt();
+
+		TLevelItem* item = new TLevelItem(x, y, itemId);
+		levelItems.push_back(item);
+		item->timer.setCallback([this, item]() { doItemTimeout(item); });
+		wheel->schedule(&item->timer, ticksLeft);
+	}
+
+	unsigned short horseCount = pState.readGUShort();
+	for (unsigned short i = 0; i < horseCount; ++i)
+	{
+		CString image = pState.readChars(pState.readGUChar());
+		float x = (float)pState.readGUChar() / 2.0f;
+		float y = (float)pState.readGUChar() / 2.0f;
+		char dir = pState.readGChar();
+		char bushes = pState.readGChar();
+		int ticksLeft = pState.readGInt();
+
+		TLevelHorse* horse = new TLevelHorse(image, x, y, dir, bushes);
+		levelHorses.push_back(horse);
+		horse->timer.setCallback([this, horse]() { doHorseTimeout(horse); });
+		wheel->schedule(&horse->timer, ticksLeft);
+	}
+
+	// Replace the baddies the level file made.  Some of them may have been killed, and players can add more.
+	for (auto baddy : levelBaddies)
+		delete baddy;
+	levelBaddies.clear();
+	levelBaddyIds.clear();
+	levelBaddyIds.resize(1, 0);
+
+	unsigned char baddyCount = pState.readGUChar();
+	for (unsigned char i = 0; i < baddyCount; ++i)
+	{
+		char id = pState.readGChar();
+		float startX = (float)pState.readGUChar() / 2.0f;
+		float startY = (float)pState.readGUChar() / 2.0f;
+		unsigned char type = pState.readGUChar();
+		bool respawn = (pState.readGUChar() != 0);
+		CString props = pState.readChars(pState.readGUShort());
+		int ticksLeft = pState.readGInt();
+
+		if (id < 1 || id > 50 || getBaddy(id) != 0)
+			continue;
+
+		TLevelBaddy* baddy = new TLevelBaddy(startX, startY, type, this, server);
+		baddy->setId(id);
+		baddy->setRespawn(respawn);
+		if (levelBaddyIds.size() <= (size_t)id)
+			levelBaddyIds.resize((size_t)id + 1, 0);
+		levelBaddyIds[id] = baddy;
+		levelBaddies.push_back(baddy);
+
+		// Setting the props schedules the baddy's timer again, so set it back to what was left.
+		// A dead baddy that doesn't respawn removes itself.
+		baddy->setProps(props);
+		if (getBaddy(id) == baddy)
+			wheel->schedule(&baddy->timer, ticksLeft);
+	}
+}
+
+size_t TLevel::getMemoryUsage() const
+{
+	size_t size = sizeof(TLevel);
+	size += levelBaddies.size() * sizeof(TLevelBaddy);
+	size += levelChests.size() * sizeof(TLevelChest);
+	size += levelHorses.size() * sizeof(TLevelHorse);
+	size += levelItems.size() * sizeof(TLevelItem);
+	size += levelLinks.size() * sizeof(TLevelLink);
+	for (auto change : levelBoardChanges)
+		size += sizeof(TLevelBoardChange) + change->getTiles().length() + change->getOldTiles().length();
+	for (auto sign : levelSigns)
+		size += sizeof(TLevelSign) + sign->getText().length() + sign->getUText().length();
+
+	// Database npcs aren't counted, since they don't go away with the level.
+	for (auto npc : levelNPCs)
+	{
+		if (npc->isLevelNPC())
+			size += sizeof(TNPC) + npc->getScriptCode().length() + npc->getClientScript().length() + npc->getServerScript().length();
+	}
+	return size;
+}
+
 bool TLevel::loadLevel(const CString& pLevelName)
 {
 #ifdef V8NPCSERVER
@@ -712,6 +898,9 @@ bool TLevel::loadGraal(const CString& pLevelName)
 
 			TNPC* npc = server->addNPC(image, code, x, y, this, true, false);
 			levelNPCs.push_back(npc);
+#ifdef V8NPCSERVER
+			addNPCBounds(npc);
+#endif
 		}
 	}
 
@@ -868,6 +1057,9 @@ bool TLevel::loadNW(const CString& pLevelName)
 			// Add the new NPC.
 			TNPC* npc = server->addNPC(image, code, x, y, this, true, false);
 			levelNPCs.push_back(npc);
+#ifdef V8NPCSERVER
+			addNPCBounds(npc);
+#endif
 		}
 		else if (curLine[0] == "SIGN")
 		{
@@ -938,7 +1130,10 @@ TLevel* TLevel::findLevel(const CString& pLevelName, TServer* server)
 	for (auto it = levelList->begin(); it != levelList->end(); )
 	{
 		if ((*it)->getLevelName().toLower() == pLevelName.toLower())
+		{
+			(*it)->lastUsed = time(0);
 			return (*it);
+		}
 
 		++it;
 	}
@@ -951,6 +1146,9 @@ TLevel* TLevel::findLevel(const CString& pLevelName, TServer* server)
 		return 0;
 	}
 
+	// Put back what it had when it was unloaded.
+	server->restoreLevelState(level);
+
 	// Return Level
 	levelList->push_back(level);
 	return level;
@@ -1055,13 +1253,22 @@ bool TLevel::alterBoard(CString& pTileData, int pX, int pY, int pWidth, int pHei
 
 	// TODO: old gserver didn't save the board change if oldTiles.length() == 0.
 	// Should we do it that way still?
-	levelBoardChanges.push_back(new TLevelBoardChange(pX, pY, pWidth, pHeight, pTileData, oldTiles, (doRespawn ? respawnTime : -1)));
+	TLevelBoardChange* change = new TLevelBoardChange(pX, pY, pWidth, pHeight, pTileData, oldTiles);
+	levelBoardChanges.push_back(change);
+	if (doRespawn)
+	{
+		change->timer.setCallback([this, change]() { doBoardChangeTimeout(change); });
+		server->getTimerWheel()->schedule(&change->timer, respawnTime);
+	}
 	return true;
 }
 
 bool TLevel::addItem(float pX, float pY, char pItem)
 {
-	levelItems.push_back(new TLevelItem(pX, pY, pItem));
+	TLevelItem* item = new TLevelItem(pX, pY, pItem);
+	levelItems.push_back(item);
+	item->timer.setCallback([this, item]() { doItemTimeout(item); });
+	server->getTimerWheel()->schedule(&item->timer, 10);
 	return true;
 }
 
@@ -1083,7 +1290,10 @@ signed char TLevel::removeItem(float pX, float pY)
 
 bool TLevel::addHorse(CString& pImage, float pX, float pY, char pDir, char pBushes)
 {
-	levelHorses.push_back(new TLevelHorse(server, pImage, pX, pY, pDir, pBushes));
+	TLevelHorse* horse = new TLevelHorse(pImage, pX, pY, pDir, pBushes);
+	levelHorses.push_back(horse);
+	horse->timer.setCallback([this, horse]() { doHorseTimeout(horse); });
+	server->getTimerWheel()->schedule(&horse->timer, server->getSettings()->getInt("horselifetime", 30));
 	return true;
 }
 
@@ -1164,13 +1374,17 @@ TLevelBaddy* TLevel::getBaddy(char id)
 int TLevel::addPlayer(TPlayer* player)
 {
 	levelPlayerList.push_back(player);
+	lastUsed = time(0);
 
 #ifdef V8NPCSERVER
 	for (std::vector<TNPC *>::iterator it = levelNPCs.begin(); it != levelNPCs.end(); ++it)
 	{
 		TNPC *npc = *it;
+		if (levelPlayerList.size() == 1)
+			npc->updateScriptSleep();
+
 		if (npc->hasScriptEvent(NPCEVENTFLAG_PLAYERENTERS))
-			npc->queueNpcAction("npc.playerenters", player);
+			npc->queueNpcAction(ScriptActionName::NpcPlayerEnters, player);
 	}
 #endif
 
@@ -1186,12 +1400,16 @@ void TLevel::removePlayer(TPlayer* player)
 			i = levelPlayerList.erase(i);
 		else ++i;
 	}
+	lastUsed = time(0);
 
 #ifdef V8NPCSERVER
 	for (std::vector<TNPC *>::iterator it = levelNPCs.begin(); it != levelNPCs.end(); ++it) {
 		TNPC *npc = *it;
 		if (npc->hasScriptEvent(NPCEVENTFLAG_PLAYERLEAVES))
-			npc->queueNpcAction("npc.playerleaves", player);
+			npc->queueNpcAction(ScriptActionName::NpcPlayerLeaves, player);
+
+		if (levelPlayerList.empty())
+			npc->updateScriptSleep();
 	}
 #endif
 }
@@ -1215,6 +1433,9 @@ bool TLevel::addNPC(TNPC* npc)
 		if (npc == search) return false;
 	}
 	levelNPCs.push_back(npc);
+#ifdef V8NPCSERVER
+	addNPCBounds(npc);
+#endif
 	return true;
 }
 
@@ -1227,113 +1448,73 @@ void TLevel::removeNPC(TNPC* npc)
 			i = levelNPCs.erase(i);
 		else ++i;
 	}
+#ifdef V8NPCSERVER
+	removeNPCBounds(npc);
+#endif
 }
 
-bool TLevel::doTimedEvents()
+void TLevel::doBoardChangeTimeout(TLevelBoardChange* change)
 {
-	// Check if we should revert any board changes.
-	for (std::vector<TLevelBoardChange*>::iterator i = levelBoardChanges.begin(); i != levelBoardChanges.end(); ++i)
-	{
-		TLevelBoardChange* change = *i;
-		int respawnTimer = change->timeout.doTimeout();
-		if (respawnTimer == 0)
-		{
-			// Put the old data back in.  DON'T DELETE THE CHANGE.
-			// The client remembers board changes and if we delete the
-			// change, the client won't get the new data.
-			change->swapTiles();
-			change->setModTime(time(0));
-			server->sendPacketToLevel(CString() >> (char)PLO_BOARDMODIFY << change->getBoardStr(), 0, this);
-		}
-	}
+	// Put the old data back in.  DON'T DELETE THE CHANGE.
+	// The client remembers board changes and if we delete the
+	// change, the client won't get the new data.
+	change->swapTiles();
+	change->setModTime(time(0));
+	server->sendPacketToLevel(CString() >> (char)PLO_BOARDMODIFY << change->getBoardStr(), 0, this);
+}
 
-	// Check if any items have timed out.
+void TLevel::doItemTimeout(TLevelItem* item)
+{
 	// This allows us to delete items that have disappeared if nobody is in the level to send
 	// the PLI_ITEMDEL packet.
-	for (std::vector<TLevelItem*>::iterator i = levelItems.begin(); i != levelItems.end(); )
-	{
-		TLevelItem* item = *i;
-		int deleteTimer = item->timeout.doTimeout();
-		if (deleteTimer == 0)
-		{
-			delete item;
-			i = levelItems.erase(i);
-		} else ++i;
-	}
+	auto i = std::find(levelItems.begin(), levelItems.end(), item);
+	if (i != levelItems.end())
+		levelItems.erase(i);
+	delete item;
+}
 
-	// Check if any horses need to be deleted.
-	for (std::vector<TLevelHorse *>::iterator i = levelHorses.begin(); i != levelHorses.end(); )
+void TLevel::doHorseTimeout(TLevelHorse* horse)
+{
+	server->sendPacketToLevel(CString() >> (char)PLO_HORSEDEL >> (char)(horse->getX() * 2) >> (char)(horse->getY() * 2), 0, this);
+
+	auto i = std::find(levelHorses.begin(), levelHorses.end(), horse);
+	if (i != levelHorses.end())
+		levelHorses.erase(i);
+	delete horse;
+}
+
+void TLevel::doBaddyTimeout(TLevelBaddy* baddy)
+{
+	if (baddy->getType() == 4 /*swamp arrow baddy*/ && baddy->getMode() == BDMODE_HURT)
 	{
-		TLevelHorse* horse = *i;
-		int deleteTimer = horse->timeout.doTimeout();
-		if (deleteTimer == 0)
+		if (baddy->getPower() == 1)
 		{
-			server->sendPacketToLevel(CString() >> (char)PLO_HORSEDEL >> (char)(horse->getX() * 2) >> (char)(horse->getY() * 2), 0, this);
-			delete horse;
-			i = levelHorses.erase(i);
+			// Unset the hurt mode on the baddy.
+			CString props = CString() >> (char)BDPROP_MODE >> (char)BDMODE_SWAMPSHOT;
+			baddy->setProps(props);
+			for (unsigned int i = 1; i < levelPlayerList.size(); ++i)
+				levelPlayerList[i]->sendPacket(CString() >> (char)PLO_BADDYPROPS >> (char)baddy->getId() << props);
 		}
-		else ++i;
 	}
-
-	// Check if any baddies need to be marked as dead or respawned.
-	std::set<TLevelBaddy*> set_dead;
-	for (std::vector<TLevelBaddy *>::iterator i = levelBaddies.begin(); i != levelBaddies.end(); )
+	else if (baddy->getMode() == BDMODE_DIE)
 	{
-		TLevelBaddy* baddy = *i;
-		if (baddy == 0)
-		{
-			i = levelBaddies.erase(i);
-			continue;
-		}
-		++i;
+		// Set the baddy as dead for all the other players in the level.
+		CString props = CString() >> (char)BDPROP_MODE >> (char)BDMODE_DEAD;
+		for (unsigned int i = 1; i < levelPlayerList.size(); ++i)
+			levelPlayerList[i]->sendPacket(CString() >> (char)PLO_BADDYPROPS >> (char)baddy->getId() << props);
 
-		// See if we can respawn him.
-		int respawnTimer = baddy->timeout.doTimeout();
-		if (respawnTimer == 0)
-		{
-			if (baddy->getType() == 4 /*swamp arrow baddy*/ && baddy->getMode() == BDMODE_HURT)
-			{
-				if (baddy->getPower() == 1)
-				{
-					// Unset the hurt mode on the baddy.
-					CString props = CString() >> (char)BDPROP_MODE >> (char)BDMODE_SWAMPSHOT;
-					baddy->setProps(props);
-					for (unsigned int i = 1; i < levelPlayerList.size(); ++i)
-						levelPlayerList[i]->sendPacket(CString() >> (char)PLO_BADDYPROPS >> (char)baddy->getId() << props);
-				}
-			}
-			else if (baddy->getMode() == BDMODE_DIE)
-			{
-				// Setting the baddy props could delete the baddy and invalidate our iterator.
-				// So, save a list of all the baddies we are setting as dead and do it after this loop.
-				set_dead.insert(baddy);
-
-				// Set the baddy as dead for all the other players in the level.
-				CString props = CString() >> (char)BDPROP_MODE >> (char)BDMODE_DEAD;
-				for (unsigned int i = 1; i < levelPlayerList.size(); ++i)
-					levelPlayerList[i]->sendPacket(CString() >> (char)PLO_BADDYPROPS >> (char)baddy->getId() << props);
-			}
-			else
-			{
-				baddy->reset();
-				for (std::vector<TPlayer*>::iterator i = levelPlayerList.begin(); i != levelPlayerList.end(); ++i)
-				{
-					TPlayer* p = *i;
-					p->sendPacket(CString() >> (char)PLO_BADDYPROPS >> (char)baddy->getId() << baddy->getProps(p->getVersion()));
-				}
-			}
-		}
+		// Setting the baddy props can delete the baddy, so do it last.
+		baddy->setProps(props);
 	}
-	{	// Mark all the baddies as dead now.
-		CString props = CString() >> (char)BDPROP_MODE >> (char)BDMODE_DEAD;
-		for (std::set<TLevelBaddy*>::iterator i = set_dead.begin(); i != set_dead.end(); ++i)
+	else
+	{
+		baddy->reset();
+		for (std::vector<TPlayer*>::iterator i = levelPlayerList.begin(); i != levelPlayerList.end(); ++i)
 		{
-			TLevelBaddy* baddy = *i;
-			baddy->setProps(props);
+			TPlayer* p = *i;
+			p->sendPacket(CString() >> (char)PLO_BADDYPROPS >> (char)baddy->getId() << baddy->getProps(p->getVersion()));
 		}
 	}
-
-	return true;
 }
 
 bool TLevel::isOnWall(double pX, double pY)
@@ -1349,20 +1530,90 @@ bool TLevel::isOnWater(double pX, double pY)
 }
 
 #ifdef V8NPCSERVER
+/*
+	TLevel: NPC Hit-Test Grid
+*/
+static inline int getGridCell(int pixel)
+{
+	return std::min(std::max(pixel, 0), (LEVELGRID_SIZE << LEVELGRID_SHIFT) - 1) >> LEVELGRID_SHIFT;
+}
+
+static SLevelGridCells getGridCells(int pX, int pY, int pEndX, int pEndY)
+{
+	return { getGridCell(pX), getGridCell(pY), getGridCell(pEndX), getGridCell(pEndY) };
+}
+
+static SLevelGridCells getNPCGridCells(TNPC *npc)
+{
+	return getGridCells(npc->getPixelX(), npc->getPixelY(),
+		npc->getPixelX() + std::max(npc->getWidth(), 0), npc->getPixelY() + std::max(npc->getHeight(), 0));
+}
+
+void TLevel::addNPCBounds(TNPC *npc)
+{
+	SLevelGridCells cells = getNPCGridCells(npc);
+	if (!npcGridCells.emplace(npc, cells).second)
+		return;
+
+	for (int cy = cells.top; cy <= cells.bottom; ++cy)
+	{
+		for (int cx = cells.left; cx <= cells.right; ++cx)
+			npcGrid[cy * LEVELGRID_SIZE + cx].push_back(npc);
+	}
+}
+
+void TLevel::removeNPCBounds(TNPC *npc)
+{
+	auto it = npcGridCells.find(npc);
+	if (it == npcGridCells.end())
+		return;
+
+	SLevelGridCells cells = it->second;
+	npcGridCells.erase(it);
+
+	for (int cy = cells.top; cy <= cells.bottom; ++cy)
+	{
+		for (int cx = cells.left; cx <= cells.right; ++cx)
+		{
+			std::vector<TNPC *>& cell = npcGrid[cy * LEVELGRID_SIZE + cx];
+			cell.erase(std::remove(cell.begin(), cell.end(), npc), cell.end());
+		}
+	}
+}
+
+void TLevel::updateNPCBounds(TNPC *npc)
+{
+	// Most moves stay within the same cells
+	auto it = npcGridCells.find(npc);
+	if (it == npcGridCells.end() || it->second == getNPCGridCells(npc))
+		return;
+
+	removeNPCBounds(npc);
+	addNPCBounds(npc);
+}
+
 std::vector<TNPC *> TLevel::findAreaNpcs(int pX, int pY, int pWidth, int pHeight)
 {
 	int testEndX = pX + pWidth;
 	int testEndY = pY + pHeight;
 
+	// An npc is in every cell it covers, so only take it from the cell its position is in
+	SLevelGridCells area = getGridCells(pX, pY, testEndX, testEndY);
+
 	std::vector<TNPC *> npcList;
-	for (auto it = levelNPCs.begin(); it != levelNPCs.end(); ++it)
+	for (int cy = area.top; cy <= area.bottom; ++cy)
 	{
-		TNPC *npc = *it;
-
-		if ((npc->getPixelX() >= pX && npc->getPixelX() <= testEndX) &&
-			(npc->getPixelY() >= pY && npc->getPixelY() <= testEndY))
+		for (int cx = area.left; cx <= area.right; ++cx)
 		{
-			npcList.push_back(npc);
+			for (TNPC *npc : npcGrid[cy * LEVELGRID_SIZE + cx])
+			{
+				if ((npc->getPixelX() >= pX && npc->getPixelX() <= testEndX) &&
+					(npc->getPixelY() >= pY && npc->getPixelY() <= testEndY) &&
+					getGridCell(npc->getPixelX()) == cx && getGridCell(npc->getPixelY()) == cy)
+				{
+					npcList.push_back(npc);
+				}
+			}
 		}
 	}
 
@@ -1387,29 +1638,49 @@ TLevelLink * TLevel::isOnLink(int pX, int pY)
 	return nullptr;
 }
 
+static bool isTouchingNPC(TNPC *npc, int pX, int pY, bool checkEventFlag)
+{
+	if (checkEventFlag && !npc->hasScriptEvent(NPCEVENTFLAG_PLAYERTOUCHSME))
+		return false;
+
+	//if (!npc->getImage().isEmpty())
+	{
+		if ((npc->getVisibleFlags() & 1) != 0)
+		{
+			if ((pX >= npc->getPixelX() && pX <= npc->getPixelX() + npc->getWidth()) &&
+				(pY >= npc->getPixelY() && pY <= npc->getPixelY() + npc->getHeight()))
+				return true;
+		}
+	}
+	return false;
+}
+
 TNPC * TLevel::isOnNPC(int pX, int pY, bool checkEventFlag)
 {
-	for (auto it = levelNPCs.begin(); it != levelNPCs.end(); ++it)
+	TNPC *found = nullptr;
+	std::vector<TNPC *>& cell = npcGrid[getGridCell(pY) * LEVELGRID_SIZE + getGridCell(pX)];
+	for (auto it = cell.begin(); it != cell.end(); ++it)
 	{
 		TNPC *npc = *it;
-		if (checkEventFlag && !npc->hasScriptEvent(NPCEVENTFLAG_PLAYERTOUCHSME))
+		if (!isTouchingNPC(npc, pX, pY, checkEventFlag))
 			continue;
 
-		//if (!npc->getImage().isEmpty())
+		if (found == nullptr)
 		{
-			if ((npc->getVisibleFlags() & 1) != 0)
-			{
-				if ((pX >= npc->getPixelX() && pX <= npc->getPixelX() + npc->getWidth()) &&
-					(pY >= npc->getPixelY() && pY <= npc->getPixelY() + npc->getHeight()))
-				{
-					// what if it touches multiple npcs? hm. not sure how graal did it.
-					return npc;
-				}
-			}
+			found = npc;
+			continue;
+		}
+
+		// what if it touches multiple npcs? hm. not sure how graal did it.
+		// The cell's order depends on how the npcs moved, so take the first one in the level's order
+		for (auto levelNpc : levelNPCs)
+		{
+			if (isTouchingNPC(levelNpc, pX, pY, checkEventFlag))
+				return levelNpc;
 		}
 	}
 
-	return nullptr;
+	return found;
 }
 
 void TLevel::sendChatToLevel(const TPlayer *player, const CString& message)
@@ -1418,7 +1689,7 @@ void TLevel::sendChatToLevel(const TPlayer *player, const CString& message)
 	{
 		TNPC *npc = *it;
 		if (npc->hasScriptEvent(NPCEVENTFLAG_PLAYERCHATS))
-			npc->queueNpcEvent("npc.playerchats", true, player->getScriptObject(), std::string(message.text()));
+			npc->queueNpcEvent(ScriptActionName::NpcPlayerChats, true, player->getScriptObject(), std::string(message.text()));
 	}
 }
 
@@ -28,6 +28,11 @@ respawn(true), setImage(false)
 	if (pType > baddytypes) type = 0;
 	verses.resize(3);
 	reset();
+
+	timer.setCallback([this]() {
+		if (level)
+			level->doBaddyTimeout(this);
+	});
 }
 
 void TLevelBaddy::reset()
@@ -182,12 +187,12 @@ void TLevelBaddy::setProps(CString &pProps)
 				{
 					// Workaround for buggy client.  In 2 seconds, set us back to BDMODE_SWAMPSHOT from
 					// inside TLevel.cpp.
-					timeout.setTimeout(2);
+					server->getTimerWheel()->schedule(&timer, 2);
 				}
 				else if (mode == BDMODE_DIE)
 				{
 					// In 2 seconds, set our mode to BDMODE_DEAD inside TLevel.cpp.
-					timeout.setTimeout(2);
+					server->getTimerWheel()->schedule(&timer, 2);
 
 					// Drop items when dead.
 					if (server->getSettings()->getBool("baddyitems", false) == true)
@@ -196,7 +201,7 @@ void TLevelBaddy::setProps(CString &pProps)
 				else if (mode == BDMODE_DEAD)
 				{
 					if (respawn)
-						timeout.setTimeout(server->getSettings()->getInt("baddyrespawntime", 60));
+						server->getTimerWheel()->schedule(&timer, server->getSettings()->getInt("baddyrespawntime", 60));
 					else
 					{
 						if (level)
@@ -1,11 +1,9 @@
 #include "IDebug.h"
 #include "TLevelHorse.h"
-#include "TServer.h"
 
-TLevelHorse::TLevelHorse(TServer* server, const CString& pImage, float pX, float pY, char pDir, char pBushes)
+TLevelHorse::TLevelHorse(const CString& pImage, float pX, float pY, char pDir, char pBushes)
 : image(pImage), x(pX), y(pY), dir(pDir), bushes(pBushes)
 {
-	timeout.setTimeout(server->getSettings()->getInt("horselifetime", 30));
 }
 
 CString TLevelHorse::getHorseStr() const
@@ -54,20 +54,26 @@ TNPC::TNPC(const CString& pImage, const CString& pScript, float pX, float pY, TS
 	// Needs to be called so it creates a script-object
 	//if (!pScript.isEmpty())
 		setScriptCode(pScript);
+
+#ifdef V8NPCSERVER
+	// npc.created is only queued so far, nothing the script does has happened yet.
+	if (levelNPC)
+		origProps = getProps(0);
+#endif
 }
 
 TNPC::TNPC(TServer *pServer, bool pLevelNPC)
 	: server(pServer), levelNPC(pLevelNPC), blockPositionUpdates(false),
 	x(30), y(30.5), x2((int)(x * 16)), y2((int)(y * 16)),
 	gmaplevelx(0), gmaplevely(0),
-	hurtX(32.0f), hurtY(32.0f), id(0), rupees(0),
+	hurtX(32.0f), hurtY(32.0f), id(0), listIndex(0), rupees(0),
 	darts(0), bombs(0), glovePower(0), bombPower(0), swordPower(0), shieldPower(0),
 	visFlags(1), blockFlags(0), sprite(2), power(0), ap(50),
 	gani("idle"), level(nullptr)
 #ifdef V8NPCSERVER
 	, _scriptExecutionContext(pServer->getScriptEngine())
 	, origX(x), origY(y), persistNpc(false), npcDeleteRequested(false), canWarp(false), width(32), height(32)
-	, timeout(0), _scriptEventsMask(0xFF), _scriptObject(0)
+	, timeout(0), _scriptEventsMask(0xFF), _scriptObject(0), _scriptDormant(false), _scriptTimersSuspended(false), _scriptUpload(0)
 #endif
 {
 	memset((void*)colors, 0, sizeof(colors));
@@ -141,6 +147,11 @@ void TNPC::setScriptCode(const CString& pScript)
 	if (!serverScript.isEmpty()) serverScript = doJoins(serverScript, server->getFileSystem());
 	if (!clientScript.isEmpty()) clientScript = doJoins(clientScript, server->getFileSystem());
 
+#ifdef V8NPCSERVER
+	// Hash the server script once, the script engine caches the compiled code by it.
+	serverScriptHash = (serverScript.isEmpty() ? std::string() : CScriptEngine::HashScript(serverScript.text(), serverScript.length()));
+#endif
+
 	// See if the NPC should block position updates from the level leader.
 #ifdef V8NPCSERVER
 		blockPositionUpdates = true;
@@ -167,14 +178,13 @@ void TNPC::setScriptCode(const CString& pScript)
 		printf("WARNING: Clientside script of NPC (%s) exceeds the limit of 28767 bytes.\n", (weaponName.length() != 0 ? weaponName.text() : image.text()));
 
 #ifdef V8NPCSERVER
-	// Compile and execute the script.
-	bool executed = server->getScriptEngine()->ExecuteNpc(this);
-	if (executed) {
-		SCRIPTENV_D("SCRIPT COMPILED\n");
-		this->queueNpcAction("npc.created");
-	}
+	// Compile and execute the script, unless nobody can see the npc yet.  It still gets a script object
+	// so other scripts can find it.
+	_scriptDormant = canScriptSleep();
+	if (_scriptDormant)
+		server->getScriptEngine()->WrapObject(this);
 	else
-		SCRIPTENV_D("Could not compile npc script\n");
+		executeScript();
 
 	// Delete old npc, and send npc to level. Currently only doing this for database npcs, everything else
 	//	would need "update level" to take changes.
@@ -732,12 +742,25 @@ CString TNPC::setProps(CString& pProps, int clientVersion, bool pForward)
 	}
 
 #ifdef V8NPCSERVER
-	if (hasMoved) testTouch();
+	if (hasMoved)
+	{
+		updateLevelBounds();
+		testTouch();
+	}
 #endif
 
 	return ret;
 }
 
+void TNPC::updateLevelBounds()
+{
+#ifdef V8NPCSERVER
+	// Keep the level's hit-test grid in step with where the npc is
+	if (level != nullptr)
+		level->updateNPCBounds(this);
+#endif
+}
+
 #ifdef V8NPCSERVER
 
 void TNPC::testTouch()
@@ -766,9 +789,9 @@ void TNPC::freeScriptResources()
 {
 	CScriptEngine *scriptEngine = server->getScriptEngine();
 
-	// Clear cached script
-	if (!serverScript.isEmpty())
-		scriptEngine->ClearCache(CScriptEngine::WrapScript<TNPC>(serverScript.text()));
+	// Clear cached script, dormant npcs never compiled theirs
+	if (!serverScript.isEmpty() && !_scriptDormant)
+		scriptEngine->ClearCache<TNPC>(serverScriptHash);
 
 	// Clear any queued actions
 	if (_scriptExecutionContext.hasActions())
@@ -803,6 +826,33 @@ void TNPC::freeScriptResources()
 		delete _scriptObject;
 		_scriptObject = nullptr;
 	}
+
+	// A new script gets to run again
+	_scriptExecutionContext.setDisabled(false);
+}
+
+void TNPC::disableScript()
+{
+	std::string name = npcName;
+	if (name.empty())
+		name = "level npc " + std::to_string(id);
+	if (level != nullptr)
+		name.append(" (in level ").append(level->getLevelName().text()).append(")");
+
+	server->reportScriptException((CString() << "Script for " << name << " ran for more than "
+		<< CString((int)server->getScriptEngine()->getScriptHardLimit().count()) << "ms and has been disabled until it is updated.").text());
+
+	// Stop anything that would queue new events.  The timer list drops us on its own once there is nothing left.
+	_scriptEventsMask = 0;
+	timeout = 0;
+
+	for (auto & _scriptTimer : _scriptTimers)
+		delete _scriptTimer.action;
+	_scriptTimers.clear();
+
+	for (auto & _triggerAction : _triggerActions)
+		delete _triggerAction.second;
+	_triggerActions.clear();
 }
 
 // Set callbacks for triggeractions!
@@ -819,6 +869,9 @@ void TNPC::registerTriggerAction(const std::string& action, IScriptFunction *cbF
 
 void TNPC::queueNpcTrigger(const std::string& action, const std::string& data)
 {
+	// Triggers are registered by the script, so it has to run first
+	wakeScript();
+
 	// Check if we respond to this trigger
 	auto triggerIter = _triggerActions.find(action);
 	if (triggerIter == _triggerActions.end())
@@ -826,7 +879,7 @@ void TNPC::queueNpcTrigger(const std::string& action, const std::string& data)
 
 	CScriptEngine *scriptEngine = server->getScriptEngine();
 
-	ScriptAction *scriptAction = scriptEngine->CreateAction("npc.trigger", _scriptObject, triggerIter->second, data);
+	ScriptAction *scriptAction = scriptEngine->CreateAction(ScriptActionName::NpcTrigger, _scriptObject, triggerIter->second, data);
 	_scriptExecutionContext.addAction(scriptAction);
 	scriptEngine->RegisterNpcUpdate(this);
 }
@@ -868,12 +921,36 @@ void TNPC::setTimeout(int newTimeout)
 {
 	timeout = newTimeout;
 
-	if (hasTimerUpdates())
+	if (hasTimerUpdates() && !_scriptTimersSuspended)
 		server->getScriptEngine()->RegisterNpcTimer(this);
 	else
 		server->getScriptEngine()->UnregisterNpcTimer(this);
 }
 
+void TNPC::queueScriptCode(const CString& pScript, std::function<void()> callback)
+{
+	// Same server script setScriptCode ends up with, so it finds the compiled code in the cache.
+	CString script = pScript;
+	CString code = script.readString("//#CLIENTSIDE");
+	if (!code.isEmpty()) code = doJoins(code, server->getFileSystem());
+
+	// The npc could be deleted before the script is ready, and a cached script is ready before an older upload.
+	TServer *npcServer = server;
+	TNPC *npc = this;
+	unsigned int npcId = id;
+	unsigned int upload = ++_scriptUpload;
+	server->getScriptEngine()->CompileCacheAsync<TNPC>(code.text(), CScriptEngine::HashScript(code.text(), code.length()), [npcServer, npc, npcId, upload, pScript, callback = std::move(callback)](bool compiled) {
+		// A script that didn't compile leaves the running one alone
+		if (!compiled || npcServer->getNPC(npcId) != npc || npc->_scriptUpload != upload)
+			return;
+
+		npc->setScriptCode(pScript);
+		npc->saveNPC();
+		if (callback)
+			callback();
+	});
+}
+
 void TNPC::queueNpcAction(const std::string& action, TPlayer *player, bool registerAction)
 {
 	assert(_scriptObject);
@@ -897,6 +974,105 @@ void TNPC::queueNpcAction(const std::string& action, TPlayer *player, bool regis
 		scriptEngine->RegisterNpcUpdate(this);
 }
 
+void TNPC::scheduleEvent(unsigned int timeout, ScriptAction *action)
+{
+	_scriptTimers.push_back({action, timeout});
+
+	if (!_scriptTimersSuspended)
+		server->getScriptEngine()->RegisterNpcTimer(this);
+}
+
+void TNPC::executeScript()
+{
+	bool executed = server->getScriptEngine()->ExecuteNpc(this);
+	if (executed) {
+		SCRIPTENV_D("SCRIPT COMPILED\n");
+		this->queueNpcAction(ScriptActionName::NpcCreated);
+	}
+	else
+		SCRIPTENV_D("Could not compile npc script\n");
+}
+
+bool TNPC::canScriptSleep() const
+{
+	// Database npcs, and npcs saved with the server, always run.
+	return server->getScriptEngine()->getDormantNpcs() && levelNPC && !persistNpc
+		&& level != nullptr && level->getPlayerList()->empty();
+}
+
+void TNPC::wakeScript()
+{
+	if (!_scriptDormant)
+		return;
+
+	// Woken up by another script while the level is still empty.
+	_scriptDormant = false;
+	if (canScriptSleep() && level->getMap() == nullptr)
+		suspendScriptTimers();
+
+	executeScript();
+}
+
+void TNPC::updateScriptSleep()
+{
+	if (!canScriptSleep())
+	{
+		wakeScript();
+		resumeScriptTimers();
+	}
+
+	// Npcs on a gmap can be seen from the levels around them, those are woken when the level is sent
+	else if (level->getMap() == nullptr)
+		suspendScriptTimers();
+}
+
+void TNPC::releaseScript()
+{
+	// Anything still queued has to run first, and gmap npcs can be seen from the levels around them.
+	if (_scriptDormant || !canScriptSleep() || level->getMap() != nullptr || _scriptExecutionContext.hasActions())
+		return;
+
+	// npc.created runs again when a player comes back, so only npcs still the way the level file left them can
+	// start over.  Anything the script changed on them (image, position, colors...) keeps them running.
+	if (level->getLevelName() != origLevel || getProps(0) != origProps)
+		return;
+
+	// Back to how it was loaded, the script starts over from npc.created when a player comes back.
+	freeScriptResources();
+	server->getScriptEngine()->WrapObject(this);
+	_scriptDormant = true;
+	_scriptTimersSuspended = false;
+}
+
+void TNPC::suspendScriptTimers()
+{
+	if (_scriptTimersSuspended)
+		return;
+
+	_scriptTimersSuspended = true;
+	_scriptSuspendTime = std::chrono::steady_clock::now();
+	server->getScriptEngine()->UnregisterNpcTimer(this);
+}
+
+void TNPC::resumeScriptTimers()
+{
+	if (!_scriptTimersSuspended)
+		return;
+
+	_scriptTimersSuspended = false;
+
+	// Catch up on the 0.05s ticks we missed.  Anything that would have gone off runs on the next tick, once.
+	auto missedTicks = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _scriptSuspendTime).count() / 50;
+	if (timeout > 0)
+		timeout = (int)std::max<long long>(timeout - missedTicks, 1);
+
+	for (auto & _scriptTimer : _scriptTimers)
+		_scriptTimer.timer = (unsigned int)std::max<long long>((long long)_scriptTimer.timer - missedTicks, 1);
+
+	if (hasTimerUpdates())
+		server->getScriptEngine()->RegisterNpcTimer(this);
+}
+
 bool TNPC::runScriptTimer()
 {
 	// TODO(joey): Scheduled events, pass in delta, use milliseconds as an integer
@@ -905,7 +1081,7 @@ bool TNPC::runScriptTimer()
 	{
 		timeout--;
 		if (timeout == 0)
-			queueNpcAction("npc.timeout", 0, true);
+			queueNpcAction(ScriptActionName::NpcTimeout, 0, true);
 	}
 
 	// scheduled events
@@ -937,6 +1113,8 @@ bool TNPC::runScriptEvents()
 {
 	// Returns true if we still have actions to run
 	bool hasActions = _scriptExecutionContext.runExecution();
+	if (_scriptExecutionContext.wasTerminated())
+		disableScript();
 
 	// Send properties modified by scripts
 	if (!propModified.empty())
@@ -1198,9 +1376,18 @@ CString TNPC::getVariableDump()
 	if (timeout > 0)
 		npcDump << npcNameStr << ".timeout: " << CString((float)(timeout * 0.05f)) << "\n";
 
-	std::pair<unsigned int, double> executionData = _scriptExecutionContext.getExecutionData();
-	npcDump << npcNameStr << ".scripttime (in the last min): " << CString(executionData.second) << "\n";
-	npcDump << npcNameStr << ".scriptcalls: " << CString(executionData.first) << "\n";
+	ScriptExecutionData executionData = _scriptExecutionContext.getExecutionData();
+	npcDump << npcNameStr << ".scripttime (in the last min): " << CString(executionData.time) << "\n";
+	npcDump << npcNameStr << ".scriptcalls: " << CString(executionData.calls) << "\n";
+	npcDump << npcNameStr << ".scriptpeak: " << CString(executionData.peak) << "\n";
+	npcDump << npcNameStr << ".scriptdeferred: " << CString(executionData.deferred) << "\n";
+	npcDump << npcNameStr << ".scriptcoalesced: " << CString(_scriptExecutionContext.getCoalescedCount()) << "\n";
+	if (_scriptExecutionContext.isDisabled())
+		npcDump << npcNameStr << ".scriptdisabled: 1\n";
+	if (_scriptDormant)
+		npcDump << npcNameStr << ".scriptdormant: 1\n";
+	else if (_scriptTimersSuspended)
+		npcDump << npcNameStr << ".scripttimerssuspended: 1\n";
 
 	if (!flagList.empty())
 	{
@@ -1279,13 +1466,17 @@ void TNPC::warpNPC(TLevel *pLevel, float pX, float pY)
 
 	y = pY;
 	y2 = 16 * pY;
+	updateLevelBounds();
+
+	// Sleep or wake up depending on who is in the new level
+	updateScriptSleep();
 
 	// Send the properties to the players in the new level
 	server->sendPacketToLevel(CString() >> (char)PLO_NPCPROPS >> (int)id << getProps(0), level->getMap(), level, 0, true);
 	server->sendPacketTo(PLTYPE_ANYNC, CString() >> (char)PLO_NC_NPCADD >> (int)id >> (char)NPCPROP_CURLEVEL << getProp(NPCPROP_CURLEVEL));
 
 	// Queue event
-	this->queueNpcAction("npc.warped");
+	this->queueNpcAction(ScriptActionName::NpcWarped);
 }
 
 void TNPC::saveNPC()
@@ -1457,8 +1648,8 @@ bool TNPC::loadNPC(const CString& fileName)
 		}
 		else if (curCommand == "SHAPE")
 		{
-			width = strtoint(curLine.readString(" "));
-			height = strtoint(curLine.readString(" "));
+			setWidth(strtoint(curLine.readString(" ")));
+			setHeight(strtoint(curLine.readString(" ")));
 		}
 		else if (curCommand == "CANWARP")
 			canWarp = strtoint(curLine.readString("")) != 0;
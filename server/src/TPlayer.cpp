@@ -3,6 +3,8 @@
 #include <math.h>
 #include <sys/stat.h>
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
 
 #include "TPlayer.h"
 #include "IEnums.h"
@@ -305,13 +307,13 @@ void TPlayer::createFunctions()
 */
 TPlayer::TPlayer(TServer* pServer, CSocket* pSocket, int pId)
 : TAccount(pServer),
-playerSock(pSocket), key(0),
+playerSock(pSocket), replay(false), localLogin(false), listIndex(0), key(0),
 os("wind"), codepage(1252), level(0),
 id(pId), type(PLTYPE_AWAIT), versionID(CLVER_2_17), allowBomb(false), allowBow(false),
 pmap(0), carryNpcId(0), carryNpcThrown(false), loaded(false),
 nextIsRaw(false), rawPacketSize(0), isFtp(false),
 grMovementUpdated(false),
-fileQueue(pSocket),
+fileQueue(pSocket), replaySink(nullptr),
 packetCount(0), firstLevel(true), invalidPackets(0)
 #ifdef V8NPCSERVER
 , _processRemoval(false), _scriptObject(0)
@@ -337,6 +339,14 @@ TPlayer::~TPlayer()
 	// Send all unsent data (for disconnect messages and whatnot).
 	if (playerSock)
 		fileQueue.sendCompress();
+	else if (replaySink != nullptr)
+	{
+		replaySink->sendCompress();
+		if (server != 0)
+			server->addReplayBytesSent(replaySink->getBytesSent());
+		delete replaySink;
+		replaySink = nullptr;
+	}
 
 	if (id >= 0 && server != 0 && loaded)
 	{
@@ -399,6 +409,8 @@ TPlayer::~TPlayer()
 
 bool TPlayer::onRecv()
 {
+	server->getTickProfiler()->endWait();
+
 	// If our socket is gone, delete ourself.
 	if (playerSock == 0 || playerSock->getState() == SOCKET_STATE_DISCONNECTED)
 		return false;
@@ -407,21 +419,35 @@ bool TPlayer::onRecv()
 	unsigned int size = 0;
 	char* data = playerSock->getData(&size);
 	if (size != 0)
+	{
 		rBuffer.write(data, size);
+		server->getPacketStats()->recordSocketIn(size);
+	}
 	else if (playerSock->getState() == SOCKET_STATE_DISCONNECTED)
 		return false;
 
 	// Do the main function.
+	CTickPhase phase(server->getTickProfiler(), TICKPHASE_PACKETS);
 	return doMain();
 
 }
 
 bool TPlayer::onSend()
 {
+	server->getTickProfiler()->endWait();
+
+	if (replaySink != nullptr)
+	{
+		CTickPhase phase(server->getTickProfiler(), TICKPHASE_SEND);
+		replaySink->sendCompress();
+		return true;
+	}
+
 	if (playerSock == 0 || playerSock->getState() == SOCKET_STATE_DISCONNECTED)
 		return false;
 
 	// Send data.
+	CTickPhase phase(server->getTickProfiler(), TICKPHASE_SEND);
 	fileQueue.sendCompress();
 
 	return true;
@@ -506,7 +532,8 @@ bool TPlayer::doMain()
 	}
 	grMovementUpdated = false;
 
-	server->getSocketManager()->updateSingle(this, false, true);
+	if (playerSock != nullptr)
+		server->getSocketManager()->updateSingle(this, false, true);
 	return true;
 }
 
@@ -515,7 +542,7 @@ bool TPlayer::doTimedEvents()
 	time_t currTime = time(0);
 
 	// If we are disconnected, delete ourself!
-	if (playerSock == 0 || playerSock->getState() == SOCKET_STATE_DISCONNECTED)
+	if (!replay && (playerSock == 0 || playerSock->getState() == SOCKET_STATE_DISCONNECTED))
 	{
 		server->deletePlayer(this);
 		return false;
@@ -568,18 +595,6 @@ bool TPlayer::doTimedEvents()
 		}
 	}
 
-	// Do singleplayer level events.
-	{
-		for (std::map<CString, TLevel *>::iterator i = spLevels.begin(); i != spLevels.end(); ++i)
-		{
-			TLevel* level = i->second;
-			if (level == 0)
-				continue;
-
-			level->doTimedEvents();
-		}
-	}
-
 	// Save player account every 5 minutes.
 	if ((int)difftime(currTime, lastSave) > 300)
 	{
@@ -654,13 +669,57 @@ bool TPlayer::parsePacket(CString& pPacket)
 
 		// Forwards packets from server back to client as rc chat (for debugging)
 		//sendPacket(CString() >> (char)PLO_RC_CHAT << "Server Data [" << CString(id) << "]:" << (curPacket.text() + 1));
-		if (!(*this.*TPLFunc[id])(curPacket))
+
+		// Record the packet if we are tracing.
+		server->getPacketTrace()->writePacket(getId(), curPacket);
+		if (!handlePacket(id, curPacket))
 			return false;
 	}
 
 	return true;
 }
 
+bool TPlayer::handlePacket(unsigned char id, CString& pPacket)
+{
+	// Time the handler for the per-packet stats.
+	auto start = std::chrono::steady_clock::now();
+	bool ret = (*this.*TPLFunc[id])(pPacket);
+	auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	server->getPacketStats()->recordIn(id, pPacket.length(), (unsigned long long)micros);
+	return ret;
+}
+
+void TPlayer::setReplay(const CString& pIp)
+{
+	replay = true;
+	accountIpStr = pIp;
+	if (replaySink == nullptr)
+		replaySink = new CReplaySink();
+}
+
+bool TPlayer::replayPacket(CString& pPacket)
+{
+	lastData = time(0);
+
+	// Raw data was recorded whole, so it doesn't need the packet before it.
+	nextIsRaw = false;
+
+	packetCount++;
+	if (type == PLTYPE_AWAIT)
+		return msgPLI_LOGIN(pPacket);
+
+	unsigned char id = pPacket.readGUChar();
+	return handlePacket(id, pPacket);
+}
+
+bool TPlayer::replayData(const char* pData, unsigned int pSize)
+{
+	// Same as onRecv(), but the data is still framed and encrypted like it came off the socket.
+	rBuffer.write(pData, pSize);
+	return doMain();
+}
+
 void TPlayer::decryptPacket(CString& pPacket)
 {
 	// Version 1.41 - 2.18 encryption
@@ -705,12 +764,47 @@ void TPlayer::decryptPacket(CString& pPacket)
 	}
 }
 
-void TPlayer::sendPacket(CString pPacket, bool appendNL)
+void TPlayer::sendPacket(CString pPacket, bool appendNL, bool rawPacket)
 {
 	// empty buffer?
 	if (pPacket.isEmpty())
 		return;
 
+	// Counted even for replayed players, who have nobody to send to.  Buffers can hold several packets
+	// joined by newlines, so each one is counted on its own.  Raw data inside a buffer is skipped over
+	// by the size it was announced with, since it can have newlines in it.
+	CPacketStats *packetStats = server->getPacketStats();
+	if (rawPacket)
+		packetStats->recordOut((unsigned char)(pPacket[0] - 32), pPacket.length());
+	else
+	{
+		const char *data = pPacket.text();
+		int length = pPacket.length(), pos = 0, rawSize = 0;
+		while (pos < length)
+		{
+			int end;
+			if (rawSize > 0)
+			{
+				end = std::min(pos + rawSize, length);
+				rawSize = 0;
+			}
+			else
+			{
+				const char *newline = (const char *)memchr(data + pos, '\n', length - pos);
+				end = (newline != nullptr ? (int)(newline - data) + 1 : length);
+				if ((unsigned char)(data[pos] - 32) == PLO_RAWDATA)
+				{
+					pPacket.setRead(pos + 1);
+					rawSize = (int)pPacket.readGUInt();
+				}
+			}
+
+			packetStats->recordOut((unsigned char)(data[pos] - 32), end - pos);
+			pos = end;
+		}
+		pPacket.setRead(0);
+	}
+
 	// append '\n'
 	if (appendNL)
 	{
@@ -719,7 +813,10 @@ void TPlayer::sendPacket(CString pPacket, bool appendNL)
 	}
 
 	// append buffer
-	fileQueue.addPacket(pPacket);
+	if (replaySink != nullptr)
+		replaySink->addPacket(pPacket);
+	else
+		fileQueue.addPacket(pPacket);
 }
 
 bool TPlayer::sendFile(const CString& pFile)
@@ -803,12 +900,12 @@ bool TPlayer::sendFile(const CString& pPath, const CString& pFile)
 		{
 			// We don't add a \n to the end of the packet, so subtract 1 from the packet length.
 			sendPacket(CString() >> (char)PLO_RAWDATA >> (int)(packetLength - 1 + sendSize));
-			sendPacket(CString() >> (char)PLO_FILE >> (char)pFile.length() << pFile << fileData.subString(0, sendSize), false);
+			sendPacket(CString() >> (char)PLO_FILE >> (char)pFile.length() << pFile << fileData.subString(0, sendSize), false, true);
 		}
 		else
 		{
 			sendPacket(CString() >> (char)PLO_RAWDATA >> (int)(packetLength + sendSize));
-			sendPacket(CString() >> (char)PLO_FILE >> (long long)modTime >> (char)pFile.length() << pFile << fileData.subString(0, sendSize) << "\n", false);
+			sendPacket(CString() >> (char)PLO_FILE >> (long long)modTime >> (char)pFile.length() << pFile << fileData.subString(0, sendSize) << "\n", false, true);
 		}
 
 		fileData.removeI(0, sendSize);
@@ -851,7 +948,7 @@ void TPlayer::testTouch()
 
 	TNPC *npcTouched = level->isOnNPC(x2 + touchtestd[dir*2], y2 + touchtestd[dir*2+1], true);
 	if (npcTouched != 0)
-		npcTouched->queueNpcAction("npc.playertouchsme", this);
+		npcTouched->queueNpcAction(ScriptActionName::NpcPlayerTouchsMe, this);
 #endif
 }
 
@@ -1438,6 +1535,23 @@ bool TPlayer::isStaff()
 	return false;
 }
 
+bool TPlayer::isLocalBotAccount()
+{
+	// Bot accounts are the prefix followed by a number, like loadbot12.
+	CString prefix = server->getSettings()->getStr("localaccountprefix", "loadbot").trim();
+	if (prefix.isEmpty() || accountName.length() <= prefix.length()
+		|| accountName.subString(0, prefix.length()).toLower() != prefix.toLower())
+		return false;
+
+	for (int i = prefix.length(); i < accountName.length(); ++i)
+	{
+		if (accountName[i] < '0' || accountName[i] > '9')
+			return false;
+	}
+
+	return !isStaff();
+}
+
 /*
 	TPlayer: Set Properties
 */
@@ -1622,12 +1736,13 @@ bool TPlayer::sendLevel(TLevel* pLevel, time_t modTime, bool fromAdjacent)
 	sendPacket(CString() >> (char)PLO_LEVELNAME << pLevel->getLevelName());
 	time_t l_time = getCachedLevelModTime(pLevel);
 	if (modTime == -1) modTime = pLevel->getModTime();
+	server->getPacketStats()->recordLevelCache(l_time != 0 || modTime == pLevel->getModTime());
 	if (l_time == 0)
 	{
 		if (modTime != pLevel->getModTime())
 		{
 			sendPacket(CString() >> (char)PLO_RAWDATA >> (int)(1+(64*64*2)+1));
-			sendPacket(CString() << pLevel->getBoardPacket());
+			sendPacket(CString() << pLevel->getBoardPacket(), true, true);
 		}
 
 		// Send links, signs, and mod time.
@@ -1742,6 +1857,7 @@ bool TPlayer::sendLevel141(TLevel* pLevel, time_t modTime, bool fromAdjacent)
 
 	time_t l_time = getCachedLevelModTime(pLevel);
 	if (modTime == -1) modTime = pLevel->getModTime();
+	server->getPacketStats()->recordLevelCache(l_time != 0 || modTime == pLevel->getModTime());
 	if (l_time != 0)
 	{
 		sendPacket(CString() << pLevel->getBoardChangesPacket(l_time));
@@ -1751,7 +1867,7 @@ bool TPlayer::sendLevel141(TLevel* pLevel, time_t modTime, bool fromAdjacent)
 		if (modTime != pLevel->getModTime())
 		{
 			sendPacket(CString() >> (char)PLO_RAWDATA >> (int)(1+(64*64*2)+1));
-			sendPacket(CString() << pLevel->getBoardPacket());
+			sendPacket(CString() << pLevel->getBoardPacket(), true, true);
 
 			if (firstLevel)
 				sendPacket(CString() >> (char)PLO_LEVELNAME << pLevel->getLevelName());
@@ -2160,8 +2276,9 @@ bool TPlayer::msgPLI_NULL(CString& pPacket)
 
 bool TPlayer::msgPLI_LOGIN(CString& pPacket)
 {
-	// Read Player-Ip
-	accountIpStr = playerSock->getRemoteIp();
+	// Read Player-Ip.  Replayed players already have theirs.
+	if (playerSock != nullptr)
+		accountIpStr = playerSock->getRemoteIp();
 #ifdef HAVE_INET_PTON
 	inet_pton(AF_INET, accountIpStr.text(), &accountIp);
 #else
@@ -2220,7 +2337,11 @@ bool TPlayer::msgPLI_LOGIN(CString& pPacket)
 		key = (unsigned char)pPacket.readGChar();
 		in_codec.reset(key);
 		if (in_codec.getGen() > ENCRYPT_GEN_3)
+		{
 			fileQueue.setCodec(in_codec.getGen(), key);
+			if (replaySink != nullptr)
+				replaySink->setCodec(in_codec.getGen(), key);
+		}
 	}
 
 	// Read Client-Version
@@ -2232,21 +2353,26 @@ bool TPlayer::msgPLI_LOGIN(CString& pPacket)
 
 	// Read Account & Password
 	accountName = pPacket.readChars(pPacket.readGUChar());
+	int passwordPos = pPacket.readPos();
 	CString password = pPacket.readChars(pPacket.readGUChar());
 
+	// Record the login without the password.
+	if (server->getPacketTrace()->isRecording() && playerSock != nullptr)
+		server->getPacketTrace()->writePacket(getId(), pPacket.subString(0, passwordPos) >> (char)0);
+
 	//serverlog.out("[%s]    Key: %d\n", server->getName().text(), key);
 	serverlog.out("[%s]    Version:\t%s (%s)\n", server->getName().text(), version.text(), getVersionString(version, type));
 	serverlog.out("[%s]    Account:\t%s\n", server->getName().text(), accountName.text());
 
-	// Check for available slots on the server.
-	if (server->getPlayerList()->size() >= (unsigned int)server->getSettings()->getInt("maxplayers", 128))
+	// Check for available slots on the server.  Players waiting in the login queue have one too.
+	if (server->getPlayerList()->size() + server->getLoginQueueSize() >= (unsigned int)server->getSettings()->getInt("maxplayers", 128))
 	{
 		sendPacket(CString() >> (char)PLO_DISCMESSAGE << "This server has reached its player limit.");
 		return false;
 	}
 
 	// Check if they are ip-banned or not.
-	if (server->isIpBanned(playerSock->getRemoteIp()) && !hasRight(PLPERM_MODIFYSTAFFACCOUNT))
+	if (server->isIpBanned(accountIpStr) && !hasRight(PLPERM_MODIFYSTAFFACCOUNT))
 	{
 		sendPacket(CString() >> (char)PLO_DISCMESSAGE << "You have been banned from this server.");
 		return false;
@@ -2288,8 +2414,24 @@ bool TPlayer::msgPLI_LOGIN(CString& pPacket)
 		}
 	}
 
+	// Replayed logins were already checked when they were recorded.
+	if (replay)
+	{
+		server->queueLogin(this);
+		return true;
+	}
+
+	// Local accounts skip the serverlist, for load testing.  A proxy or tunnel on this machine makes every client
+	// look local, so only bot accounts can use them.  Everybody else is checked by the serverlist as usual.
+	if (isClient() && server->getSettings()->getBool("localaccounts", false) && accountIpStr == "127.0.0.1" && isLocalBotAccount())
+	{
+		serverlog.out("[%s] Local account login: %s\n", server->getName().text(), accountName.text());
+		localLogin = true;
+		server->queueLogin(this);
+		return true;
+	}
+
 	// Verify login details with the serverlist.
-	// TODO: localhost mode.
 	if ( !server->getServerList()->getConnected())
 	{
 		sendPacket(CString() >> (char)PLO_DISCMESSAGE << "The login server is offline.  Try again later.");
@@ -2561,7 +2703,7 @@ bool TPlayer::msgPLI_CLAIMPKER(CString& pPacket)
 		float oldStats[4] = { rating, deviation, (float)((otherRating >> 9) & 0xFFF), (float)(otherRating & 0x1FF) };
 
 		// If the IPs are the same, don't update the rating to prevent cheating.
-		if (CString(playerSock->getRemoteIp()) == CString(player->getSocket()->getRemoteIp()))
+		if (accountIpStr == player->getIpStr())
 			return true;
 
 		float gSpar[2] = {static_cast<float>(1.0f / pow((1.0f+3.0f*pow(0.0057565f,2)*(pow(oldStats[3],2))/pow(3.14159265f,2)),0.5f)),	//Winner
@@ -3131,7 +3273,9 @@ bool TPlayer::msgPLI_UPDATEFILE(CString& pPacket)
 
 	// If the file on disk is different, send it to the player.
 	file.setRead(0);
-	if ( !isDefault && fModTime > modTime)
+	bool upToDate = (isDefault || fModTime <= modTime);
+	server->getPacketStats()->recordFileCache(upToDate);
+	if (!upToDate)
 		return msgPLI_WANTFILE(file);
 
 	if (versionID < CLVER_2_1)
@@ -53,6 +53,14 @@ bool TPlayer::sendLogin()
 		return false;
 	}
 
+	// Local logins have no password, so they can't use an account with rights.
+	if (localLogin && (getAdminRights() != 0 || isStaff()))
+	{
+		serverlog.out("[%s] Refused local account login: %s has staff rights.\n", server->getName().text(), accountName.text());
+		sendPacket(CString() >> (char)PLO_DISCMESSAGE << "Staff accounts can't log in as local accounts.");
+		return false;
+	}
+
 	// If we are an RC, check to see if we can log in.
 	if (isRC() || isNC())
 	{
@@ -149,25 +157,12 @@ bool TPlayer::sendLogin()
 	// This also lets us send data.
 	loaded = true;
 
-	CSettings* settings = server->getSettings();
-
 	// Send out what guilds should be placed in the Staff section of the playerlist.
-	std::vector<CString> guilds = settings->getStr("staffguilds").tokenize(",");
-	CString guildPacket = CString() >> (char)PLO_STAFFGUILDS;
-	for (std::vector<CString>::iterator i = guilds.begin(); i != guilds.end(); ++i)
-		guildPacket << "\"" << ((CString)(*i)).trim() << "\",";
-	sendPacket(guildPacket.remove(guildPacket.length() - 1, 1));
+	sendPacket(server->getStaffGuildsPacket());
 
 	// Send out the server's available status list options.
 	if ((isClient() && versionID >= CLVER_2_1) || isRC())
-	{
-		// graal doesn't quote these
-		std::vector<CString>* plicons = server->getStatusList();
-		CString pliconPacket = CString() >> (char)PLO_STATUSLIST;
-		for (std::vector<CString>::iterator i = plicons->begin(); i != plicons->end(); ++i)
-			pliconPacket << ((CString)(*i)).trim() << ",";
-		sendPacket(pliconPacket.remove(pliconPacket.length() - 1, 1));
-	}
+		sendPacket(server->getStatusListPacket());
 
 	// This comes after status icons for RC
 	if (isRC())
@@ -189,7 +184,8 @@ bool TPlayer::sendLogin()
 		// Get our client props.
 		CString myClientProps = (isClient() ? getProps(__getLogin, sizeof(__getLogin)/sizeof(bool)) : getProps(__getRCLogin, sizeof(__getRCLogin)/sizeof(bool)));
 
-		CString rcsOnline;
+		// Everybody else's props are sent to us in one go.
+		CString playerProps, rcsOnline;
 		std::vector<TPlayer*>* playerList = server->getPlayerList();
 		for (std::vector<TPlayer*>::iterator i = playerList->begin(); i != playerList->end(); ++i)
 		{
@@ -205,20 +201,20 @@ bool TPlayer::sendLogin()
 
 			// Add Player / RC.
 			if (isClient())
-				sendPacket(player->isClient() ? player->getProps(__getLogin, sizeof(__getLogin)/sizeof(bool)) : player->getProps(__getRCLogin, sizeof(__getRCLogin)/sizeof(bool)));
+				playerProps << (player->isClient() ? player->getProps(__getLogin, sizeof(__getLogin)/sizeof(bool)) : player->getProps(__getRCLogin, sizeof(__getRCLogin)/sizeof(bool))) << "\n";
 			else
 			{
 				// Level name.  If no level, send an empty space.
 				CString levelName = (player->getLevel() ? player->getLevel()->getLevelName() : " ");
 
 				// Get the other player's RC props.
-				this->sendPacket(CString()
+				playerProps
 					>> (char)PLO_ADDPLAYER >> (short)player->getId()
 					>> (char)player->getAccountName().length() << player->getAccountName()
 					>> (char)PLPROP_CURLEVEL >> (char)levelName.length() << levelName
 					>> (char)PLPROP_PSTATUSMSG << player->getProp(PLPROP_PSTATUSMSG)
 					>> (char)PLPROP_NICKNAME << player->getProp(PLPROP_NICKNAME)
-					>> (char)PLPROP_COMMUNITYNAME << player->getProp(PLPROP_COMMUNITYNAME));
+					>> (char)PLPROP_COMMUNITYNAME << player->getProp(PLPROP_COMMUNITYNAME) << "\n";
 
 				// If the other player is an RC, add them to the list of logged in RCs.
 				if (player->isRC())
@@ -226,6 +222,9 @@ bool TPlayer::sendLogin()
 			}
 		}
 
+		if (!playerProps.isEmpty())
+			sendPacket(playerProps);
+
 		// If we are an RC, announce the list of currently logged in RCs.
 		if (isRC() && !rcsOnline.isEmpty())
 			sendPacket(CString() >> (char)PLO_RC_CHAT << "Currently online: " << rcsOnline);
@@ -282,21 +281,24 @@ bool TPlayer::sendLoginClient()
 		this->setFlag("gr.ip", this->accountIpStr, true, true);
 
 	// Send the player's flags.
+	CString flagPacket;
 	for (auto i = flagList.begin(); i != flagList.end(); ++i)
 	{
-		if (i->second.isEmpty()) sendPacket(CString() >> (char)PLO_FLAGSET << i->first);
-		else sendPacket(CString() >> (char)PLO_FLAGSET << i->first << "=" << i->second);
+		if (i->second.isEmpty()) flagPacket >> (char)PLO_FLAGSET << i->first << "\n";
+		else flagPacket >> (char)PLO_FLAGSET << i->first << "=" << i->second << "\n";
 	}
+	if (!flagPacket.isEmpty())
+		sendPacket(flagPacket);
 
 	// Send the server's flags to the player.
-	std::unordered_map<std::string, CString> * serverFlags = server->getServerFlags();
-	for (auto i = serverFlags->begin(); i != serverFlags->end(); ++i)
-		sendPacket(CString() >> (char)PLO_FLAGSET << i->first << "=" << i->second);
+	sendPacket(server->getServerFlagsPacket());
 
 	// Delete the bomb and bow.  They get automagically added by the client for
 	// God knows which reason.  Bomb and Bow must be capitalized.
-	sendPacket(CString() >> (char)PLO_NPCWEAPONDEL << "Bomb");
-	sendPacket(CString() >> (char)PLO_NPCWEAPONDEL << "Bow");
+	// The player's weapons are sent in the same packet.
+	CString weaponPacket;
+	weaponPacket >> (char)PLO_NPCWEAPONDEL << "Bomb" << "\n";
+	weaponPacket >> (char)PLO_NPCWEAPONDEL << "Bow" << "\n";
 
 	// Send the player's weapons.
 	for (std::vector<CString>::iterator i = weaponList.begin(); i != weaponList.end(); ++i)
@@ -308,6 +310,13 @@ bool TPlayer::sendLoginClient()
 			int wId = TLevelItem::getItemId(*i);
 			if (wId != -1)
 			{
+				// Keep the packets in order.
+				if (!weaponPacket.isEmpty())
+				{
+					sendPacket(weaponPacket);
+					weaponPacket.clear();
+				}
+
 				CString defWeapPacket = CString() >> (char)PLI_WEAPONADD >> (char)0 >> (char)wId;
 				defWeapPacket.readGChar();
 				msgPLI_WEAPONADD(defWeapPacket);
@@ -315,8 +324,14 @@ bool TPlayer::sendLoginClient()
 			}
 			continue;
 		}
-		sendPacket(weapon->getWeaponPacket());
+
+		const CString& packet = weapon->getWeaponPacket();
+		weaponPacket << packet;
+		if (packet[packet.length() - 1] != '\n')
+			weaponPacket << "\n";
 	}
+	if (!weaponPacket.isEmpty())
+		sendPacket(weaponPacket);
 
 	// Send the zlib fixing NPC to client versions 2.21 - 2.31.
 	if (versionID >= CLVER_2_21 && versionID <= CLVER_2_31)
@@ -340,33 +355,9 @@ bool TPlayer::sendLoginClient()
 		return false;
 	}
 
-	// Send the bigmap if it was set.
-	if (isClient() && versionID >= CLVER_2_1)
-	{
-		CString bigmap = settings->getStr("bigmap");
-		if (!bigmap.isEmpty())
-		{
-			std::vector<CString> vbigmap = bigmap.tokenize(",");
-			if (vbigmap.size() == 4)
-				sendPacket(CString() >> (char)PLO_BIGMAP << vbigmap[0].trim() << "," << vbigmap[1].trim() << "," << vbigmap[2].trim() << "," << vbigmap[3].trim());
-		}
-	}
-
-	// Send the minimap if it was set.
-	if (isClient() && versionID >= CLVER_2_1)
-	{
-		CString minimap = settings->getStr("minimap");
-		if (!minimap.isEmpty())
-		{
-			std::vector<CString> vminimap = minimap.tokenize(",");
-			if (vminimap.size() == 4)
-				sendPacket(CString() >> (char)PLO_MINIMAP << vminimap[0].trim() << "," << vminimap[1].trim() << "," << vminimap[2].trim() << "," << vminimap[3].trim());
-		}
-	}
-
-	// Send out RPG Window greeting.
+	// Send the bigmap and minimap if they were set, and the RPG Window greeting.
 	if (isClient() && versionID >= CLVER_2_1)
-		sendPacket(CString() >> (char)PLO_RPGWINDOW << "\"Welcome to " << settings->getStr("name") << ".\",\"Graal Reborn GServer programmed by " << CString(GSERVER_CREDITS) << ".\"" );
+		sendPacket(server->getLoginMapPacket());
 
 	// Send the start message to the player.
 	sendPacket(CString() >> (char)PLO_STARTMESSAGE << *(server->getServerMessage()));
@@ -428,8 +419,11 @@ bool TPlayer::sendLoginRC()
 
 	// Send the RC join message to the RC.
 	std::vector<CString> rcmessage = CString::loadToken(CString() << server->getServerPath() << "config/rcmessage.txt", "\n", true);
+	CString rcmessagePacket;
 	for (std::vector<CString>::iterator i = rcmessage.begin(); i != rcmessage.end(); ++i)
-		sendPacket(CString() >> (char)PLO_RC_CHAT << (*i));
+		rcmessagePacket >> (char)PLO_RC_CHAT << (*i) << "\n";
+	if (!rcmessagePacket.isEmpty())
+		sendPacket(rcmessagePacket);
 
     sendPacket(CString() >> (char)PLO_UNKNOWN190);
 
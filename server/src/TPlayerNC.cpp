@@ -179,13 +179,13 @@ bool TPlayer::msgPLI_NC_NPCSCRIPTSET(CString& pPacket)
 	TNPC *npc = server->getNPC(npcId);
 	if (npc != nullptr)
 	{
-		npc->setScriptCode(npcScript);
-		npc->saveNPC();
-
-		CString logMsg;
-		logMsg << "NPC script of " << npc->getName() << " updated by " << accountName << "\n";
-		npclog.out(logMsg);
-		server->sendToNC(logMsg);
+		// Logged once the script is swapped in
+		npc->queueScriptCode(npcScript, [server = server, accountName = accountName, npc]() {
+			CString logMsg;
+			logMsg << "NPC script of " << npc->getName() << " updated by " << accountName << "\n";
+			npclog.out(logMsg);
+			server->sendToNC(logMsg);
+		});
 	}
 
 	return true;
@@ -499,39 +499,48 @@ bool TPlayer::msgPLI_NC_WEAPONADD(CString& pPacket)
 	CString weaponImage = pPacket.readChars(pPacket.readGUChar());
 	CString weaponCode = pPacket.readString("");
 
-	CString actionTaken;
+	// The script is compiled off the game thread, and the weapon is added or updated on the tick it's ready.
+	// A cached script is ready right away, so an older upload still compiling can finish after a newer one.
+	unsigned int upload = server->startWeaponUpload(weaponName);
+	TWeapon::precompileScript(server, weaponCode, [server = server, accountName = accountName, upload, weaponName, weaponImage, weaponCode](bool compiled) {
+		// A script that didn't compile leaves the weapon as it was
+		if (!compiled || !server->isLatestWeaponUpload(weaponName, upload))
+			return;
 
-	// Find Weapon
-	TWeapon *weaponObj = server->getWeapon(weaponName);
-	if (weaponObj != 0)
-	{
-		// default weapon, don't update!
-		if (weaponObj->isDefault())
-			return true;
+		CString actionTaken;
 
-		// Update Weapon
-		weaponObj->updateWeapon(weaponImage, weaponCode);
+		// Find Weapon
+		TWeapon *weaponObj = server->getWeapon(weaponName);
+		if (weaponObj != 0)
+		{
+			// default weapon, don't update!
+			if (weaponObj->isDefault())
+				return;
 
-		// Update Player-Weapons
-		server->updateWeaponForPlayers(weaponObj);
+			// Update Weapon
+			weaponObj->updateWeapon(weaponImage, weaponCode);
 
-		actionTaken = "updated";
-	}
-	else
-	{
-		// add weapon
-		bool success = server->NC_AddWeapon(new TWeapon(server, weaponName, weaponImage, weaponCode, 0, true));
-		if (success)
-			actionTaken = "added";
-	}
+			// Update Player-Weapons
+			server->updateWeaponForPlayers(weaponObj);
 
-	if (!actionTaken.isEmpty())
-	{
-		CString logMsg;
-		logMsg << "Weapon/GUI-script " << weaponName << " " << actionTaken << " by " << accountName << "\n";
-		npclog.out(logMsg);
-		server->sendToNC(logMsg);
-	}
+			actionTaken = "updated";
+		}
+		else
+		{
+			// add weapon
+			bool success = server->NC_AddWeapon(new TWeapon(server, weaponName, weaponImage, weaponCode, 0, true));
+			if (success)
+				actionTaken = "added";
+		}
+
+		if (!actionTaken.isEmpty())
+		{
+			CString logMsg;
+			logMsg << "Weapon/GUI-script " << weaponName << " " << actionTaken << " by " << accountName << "\n";
+			npclog.out(logMsg);
+			server->sendToNC(logMsg);
+		}
+	});
 
 	return true;
 }
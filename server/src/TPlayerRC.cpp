@@ -1,6 +1,8 @@
 #include "IDebug.h"
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <functional>
 #include <sys/stat.h>
 #if defined(_WIN32) || defined(_WIN64)
 	#include <direct.h>
@@ -54,6 +56,9 @@ const int __importantFileRights[] = {
 };
 
 static void updateFile(TPlayer* player, TServer* server, CString& dir, CString& file);
+static void sendPacketStats(TPlayer* player, TServer* server, bool outbound);
+static void sendTickStats(TPlayer* player, TServer* server);
+static void sendLevelStats(TPlayer* player, TServer* server);
 
 void TPlayer::setPropsRC(CString& pPacket, TPlayer* rc)
 {
@@ -506,7 +511,7 @@ bool TPlayer::msgPLI_RC_SERVERFLAGSSET(CString& pPacket)
 	std::unordered_map<std::string, CString> oldFlags = *serverFlags;
 
 	// Delete server flags.
-	serverFlags->clear();
+	server->clearFlags();
 
 	// Assemble the new server flags.
 	for (unsigned int i = 0; i < count; ++i)
@@ -637,19 +642,9 @@ bool TPlayer::msgPLI_RC_ACCOUNTLISTGET(CString& pPacket)
 	ret >> (char)PLO_RC_ACCOUNTLISTGET;
 
 	// Search through all the accounts.
-	CFileSystem* fs = server->getAccountsFileSystem();
-	for (std::map<CString, CString>::iterator i = fs->getFileList()->begin(); i != fs->getFileList()->end(); ++i)
-	{
-		CString acc = removeExtension(i->first);
-		if (acc.isEmpty()) continue;
-		if (!acc.match(name)) continue;
-		if (conditions.length() != 0)
-		{
-			if (TAccount::meetsConditions(i->second, conditions))
-				ret >> (char)acc.length() << acc;
-		}
-		else ret >> (char)acc.length() << acc;
-	}
+	std::vector<CString> accounts = server->getAccountIndex()->search(name, conditions);
+	for (auto & acc : accounts)
+		ret >> (char)acc.length() << acc;
 
 	sendPacket(ret);
 	return true;
@@ -1119,6 +1114,28 @@ bool TPlayer::msgPLI_RC_CHAT(CString& pPacket)
 			server->saveNpcs();
 		}
 #endif
+		else if (words[0] == "/packetstats" && words.size() <= 2)
+		{
+			if (words.size() == 2 && words[1] == "reset")
+			{
+				server->getPacketStats()->reset();
+				sendPacket(CString() >> (char)PLO_RC_CHAT << "Server: The packet stats were reset.");
+			}
+			else sendPacketStats(this, server, words.size() == 2 && words[1] == "out");
+		}
+		else if (words[0] == "/tickstats" && words.size() <= 2)
+		{
+			if (words.size() == 2 && words[1] == "reset")
+			{
+				server->getTickProfiler()->reset();
+				sendPacket(CString() >> (char)PLO_RC_CHAT << "Server: The tick stats were reset.");
+			}
+			else sendTickStats(this, server);
+		}
+		else if (words[0] == "/levelstats" && words.size() == 1)
+		{
+			sendLevelStats(this, server);
+		}
 		else if(words[0] == "/find" && words.size() > 1)
 		{
 			std::map<CString, CString> found;
@@ -2192,3 +2209,134 @@ void updateFile(TPlayer* player, TServer* server, CString& dir, CString& file)
 	else if (file == "rules.txt")
 		server->loadWordFilter();
 }
+
+void sendPacketStats(TPlayer* player, TServer* server, bool outbound)
+{
+	CPacketStats* stats = server->getPacketStats();
+
+	// Incoming packets are listed by the time spent handling them, outgoing ones by bytes.
+	std::vector<std::pair<unsigned long long, int> > order;
+	for (int i = 0; i < 256; ++i)
+	{
+		if (outbound && stats->getOut((unsigned char)i).packets != 0)
+			order.push_back(std::make_pair(stats->getOut((unsigned char)i).bytes, i));
+		else if (!outbound && stats->getIn((unsigned char)i).packets != 0)
+			order.push_back(std::make_pair(stats->getLatency((unsigned char)i).getSum(), i));
+	}
+	std::sort(order.begin(), order.end(), std::greater<std::pair<unsigned long long, int> >());
+
+	char line[256];
+	snprintf(line, sizeof(line), "Server: Packet %s stats for the last %.0f seconds:", (outbound ? "out" : "in"), stats->getSeconds());
+	player->sendPacket(CString() >> (char)PLO_RC_CHAT << line);
+
+	for (unsigned int i = 0; i < order.size() && i < 25; ++i)
+	{
+		unsigned char id = (unsigned char)order[i].second;
+		if (outbound)
+		{
+			const SPacketCounter& out = stats->getOut(id);
+			snprintf(line, sizeof(line), "PLO %d: %llu packets, %.1f KB", id, out.packets, (double)out.bytes / 1024.0);
+		}
+		else
+		{
+			const SPacketCounter& in = stats->getIn(id);
+			const CHistogram& latency = stats->getLatency(id);
+			snprintf(line, sizeof(line), "PLI %d: %llu packets, %.1f KB, %.1f ms total, avg %.1f us, p50 %llu us, p99 %llu us, max %llu us",
+				id, in.packets, (double)in.bytes / 1024.0, (double)latency.getSum() / 1000.0, latency.getMean(),
+				latency.getPercentile(50.0), latency.getPercentile(99.0), latency.getMax());
+		}
+		player->sendPacket(CString() >> (char)PLO_RC_CHAT << line);
+	}
+}
+
+void sendTickStats(TPlayer* player, TServer* server)
+{
+	CTickProfiler* profiler = server->getTickProfiler();
+	const CHistogram& ticks = profiler->getTicks();
+
+	char line[256];
+	snprintf(line, sizeof(line), "Server: %llu ticks in the last %.0f seconds.  avg %.2f ms, p50 %.2f ms, p99 %.2f ms, max %.2f ms",
+		ticks.getCount(), profiler->getSeconds(), ticks.getMean() / 1000.0,
+		(double)ticks.getPercentile(50.0) / 1000.0, (double)ticks.getPercentile(99.0) / 1000.0, (double)ticks.getMax() / 1000.0);
+	player->sendPacket(CString() >> (char)PLO_RC_CHAT << line);
+
+	// Not part of the tick times above.
+	const CHistogram& waits = profiler->getWaits();
+	snprintf(line, sizeof(line), "Socket wait: %.1f ms total, avg %.2f ms, p99 %.2f ms, max %.2f ms",
+		(double)waits.getSum() / 1000.0, waits.getMean() / 1000.0, (double)waits.getPercentile(99.0) / 1000.0, (double)waits.getMax() / 1000.0);
+	player->sendPacket(CString() >> (char)PLO_RC_CHAT << line);
+
+	// Phases are only counted in the ticks they ran.
+	for (int i = 0; i < TICKPHASE_COUNT; ++i)
+	{
+		const CHistogram& phase = profiler->getPhase(i);
+		if (phase.getCount() == 0)
+			continue;
+
+		snprintf(line, sizeof(line), "%s: %llu ticks, %.1f ms total, avg %.2f ms, p99 %.2f ms, max %.2f ms",
+			CTickProfiler::getPhaseName(i), phase.getCount(), (double)phase.getSum() / 1000.0, phase.getMean() / 1000.0,
+			(double)phase.getPercentile(99.0) / 1000.0, (double)phase.getMax() / 1000.0);
+		player->sendPacket(CString() >> (char)PLO_RC_CHAT << line);
+	}
+
+	// What the worst tick spent its time on.
+	const STickSample& worst = profiler->getWorstTick();
+	if (worst.total == 0)
+		return;
+
+	char when[32];
+	strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&worst.time));
+	CString phases;
+	for (int i = 0; i < TICKPHASE_COUNT; ++i)
+	{
+		if (worst.phases[i] == 0)
+			continue;
+
+		snprintf(line, sizeof(line), "%s%s %.2f ms", (phases.isEmpty() ? "" : ", "), CTickProfiler::getPhaseName(i), (double)worst.phases[i] / 1000.0);
+		phases << line;
+	}
+	snprintf(line, sizeof(line), "Worst tick: %.2f ms at %s", (double)worst.total / 1000.0, when);
+	player->sendPacket(CString() >> (char)PLO_RC_CHAT << line << " (" << phases << ")");
+}
+
+void sendLevelStats(TPlayer* player, TServer* server)
+{
+	std::vector<TLevel*>* levels = server->getLevelList();
+	time_t now = time(0);
+
+	// Biggest levels first.
+	size_t total = 0;
+	std::vector<std::pair<size_t, TLevel*> > order;
+	for (auto level : *levels)
+	{
+		size_t size = level->getMemoryUsage();
+		total += size;
+		order.push_back(std::make_pair(size, level));
+	}
+	std::sort(order.begin(), order.end(), std::greater<std::pair<size_t, TLevel*> >());
+
+	size_t groupLevels = 0;
+	for (auto& group : *server->getGroupLevels())
+		groupLevels += group.second.size();
+
+	char line[256];
+	snprintf(line, sizeof(line), "Server: %d levels loaded using %.1f KB, plus %d group levels.",
+		(int)levels->size(), (double)total / 1024.0, (int)groupLevels);
+	player->sendPacket(CString() >> (char)PLO_RC_CHAT << line);
+
+	int unloadTime = server->getSettings()->getInt("levelunloadtime", 0);
+	if (unloadTime > 0)
+		snprintf(line, sizeof(line), "Levels are unloaded after %d idle minutes.  %llu were unloaded so far, and %d of them have saved state using %.1f KB.",
+			unloadTime, server->getUnloadedLevelCount(), (int)server->getLevelStateCount(), (double)server->getLevelStateBytes() / 1024.0);
+	else snprintf(line, sizeof(line), "Idle levels are never unloaded.  Set levelunloadtime to unload them.");
+	player->sendPacket(CString() >> (char)PLO_RC_CHAT << line);
+
+	for (unsigned int i = 0; i < order.size() && i < 10; ++i)
+	{
+		TLevel* level = order[i].second;
+		snprintf(line, sizeof(line), "%s: %.1f KB, %d players, %d npcs, last used %d minutes ago",
+			level->getLevelName().text(), (double)order[i].first / 1024.0, (int)level->getPlayerList()->size(),
+			(int)level->getLevelNPCs()->size(), (int)difftime(now, level->getLastUsed()) / 60);
+		player->sendPacket(CString() >> (char)PLO_RC_CHAT << line);
+	}
+}
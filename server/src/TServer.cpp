@@ -1,9 +1,14 @@
 #include "IDebug.h"
+#include <cstdio>
+#include <ctime>
 #include <thread>
 #include <atomic>
 #include <chrono>
 #include <functional>
+#include <algorithm>
+#include <unordered_set>
 
+#include "IConfig.h"
 #include "TServer.h"
 #include "main.h"
 #include "TPlayer.h"
@@ -27,17 +32,55 @@ static const char* const filesystemTypes[] =
 
 extern std::atomic_bool shutdownProgram;
 
+static void pushFreeId(std::vector<unsigned int>& ids, unsigned int id)
+{
+	ids.push_back(id);
+	std::push_heap(ids.begin(), ids.end(), std::greater<unsigned int>());
+}
+
+static unsigned int popFreeId(std::vector<unsigned int>& ids)
+{
+	std::pop_heap(ids.begin(), ids.end(), std::greater<unsigned int>());
+	unsigned int id = ids.back();
+	ids.pop_back();
+	return id;
+}
+
+// Moves the last entry into obj's slot instead of shifting the whole list down.
+template <class T>
+static bool swapRemove(std::vector<T*>& list, T* obj)
+{
+	size_t index = obj->getListIndex();
+	if (index >= list.size() || list[index] != obj)
+		return false;
+
+	list[index] = list.back();
+	list[index]->setListIndex(index);
+	list.pop_back();
+	return true;
+}
+
+template <class T>
+static void pushListed(std::vector<T*>& list, T* obj)
+{
+	obj->setListIndex(list.size());
+	list.push_back(obj);
+}
+
 TServer::TServer(CString pName)
-	: running(false), doRestart(false), name(pName), serverlist(this), wordFilter(this)
+	: running(false), doRestart(false), replay(false), name(pName), serverlist(this), wordFilter(this), accountIndex(this), accountSaver(this), metrics(this), mServerFlagsJournalCount(0), mServerFlagsPacketSize(-1), slowTickTime(0), slowTicks(0), levelStateBytes(0), levelMemoryUsage(0), unloadedLevelCount(0), replayTime(0), replayBytesSent(0)
 #ifdef V8NPCSERVER
-	, mScriptEngine(this), mPmHandlerNpc(nullptr)
+	, mScriptEngine(this), mPmHandlerNpc(nullptr), weaponUploadCount(0)
 #endif
 #ifdef UPNP
 	, upnp(this)
 #endif
 {
 	auto time_now = std::chrono::high_resolution_clock::now();
-	lastTimer = lastNWTimer = last1mTimer = last5mTimer = last3mTimer = time_now;
+	lastTimer = lastNWTimer = last1mTimer = last5mTimer = last3mTimer = replayStart = time_now;
+#ifdef V8NPCSERVER
+	mScriptEngine.resetScriptTimer(time_now);
+#endif
 
 	// This has the full path to the server directory.
 	serverpath = CString() << getHomePath() << "servers/" << name << "/";
@@ -79,10 +122,13 @@ int TServer::init(const CString& serverip, const CString& serverport, const CStr
 	// Player ids 16000 and up is used for players on other servers and "IRC"-channels.
 	// The players from other servers should be unique lists for each player as they are fetched depending on
 	// what the player chooses to see (buddies, "global guilds" tab, "other servers" tab)
-	playerIds.resize(2);
-	npcIds.resize(10001); // Starting npc ids at 10,000 for now on..
+	growPlayerIds(2);
+	growNPCIds(10001); // Starting npc ids at 10,000 for now on..
 
 #ifdef V8NPCSERVER
+	// The script engine takes its options from serveroptions.txt
+	loadSettings();
+
 	// Initialize the Script Engine
 	if (!mScriptEngine.Initialize())
 	{
@@ -96,6 +142,14 @@ int TServer::init(const CString& serverip, const CString& serverport, const CStr
 	int ret = loadConfigFiles();
 	if (ret) return ret;
 
+	// Start the account writer.  Account saves are queued to it so the disk writes don't stall the server.
+	if (settings.getBool("accountsavethread", true))
+		accountSaver.start();
+
+	// Record what the players send so it can be replayed later.
+	if (!replay && settings.getBool("packettrace", false))
+		openPacketTrace();
+
 	// If an override serverip and serverport were specified, fix the options now.
 	if (!serverip.isEmpty())
 		settings.addKey("serverip", serverip);
@@ -118,31 +172,40 @@ int TServer::init(const CString& serverip, const CString& serverport, const CStr
 	if (oInter == "AUTO")
 		oInter.clear();
 
-	// Initialize the player socket.
-	playerSock.setType(SOCKET_TYPE_SERVER);
-	playerSock.setProtocol(SOCKET_PROTOCOL_TCP);
-	playerSock.setDescription("playerSock");
-
-	// Start listening on the player socket.
-	serverlog.out("[%s]      Initializing player listen socket.\n", name.text());
-	if (playerSock.init((oInter.isEmpty() ? 0 : oInter.text()), settings.getStr("serverport").text()))
+	// Replays feed the players in directly, so there is nothing to listen on.
+	if (!replay)
 	{
-		serverlog.out("[%s] ** [Error] Could not initialize listening socket...\n", name.text());
-		return ERR_LISTEN;
-	}
-	if (playerSock.connect())
-	{
-		serverlog.out("[%s] ** [Error] Could not connect listening socket...\n", name.text());
-		return ERR_LISTEN;
-	}
+		// Initialize the player socket.
+		playerSock.setType(SOCKET_TYPE_SERVER);
+		playerSock.setProtocol(SOCKET_PROTOCOL_TCP);
+		playerSock.setDescription("playerSock");
+
+		// Start listening on the player socket.
+		serverlog.out("[%s]      Initializing player listen socket.\n", name.text());
+		if (playerSock.init((oInter.isEmpty() ? 0 : oInter.text()), settings.getStr("serverport").text()))
+		{
+			serverlog.out("[%s] ** [Error] Could not initialize listening socket...\n", name.text());
+			return ERR_LISTEN;
+		}
+		if (playerSock.connect())
+		{
+			serverlog.out("[%s] ** [Error] Could not connect listening socket...\n", name.text());
+			return ERR_LISTEN;
+		}
 
 #ifdef UPNP
-	// Start a UPNP thread.  It will try to set a UPNP port forward in the background.
-	serverlog.out("[%s]      Starting UPnP discovery thread.\n", name.text());
-	upnp.initialize((oInter.isEmpty() ? playerSock.getLocalIp() : oInter.text()), settings.getStr("serverport").text());
-	upnp_thread = std::thread(std::ref(upnp));
+		// Start a UPNP thread.  It will try to set a UPNP port forward in the background.
+		serverlog.out("[%s]      Starting UPnP discovery thread.\n", name.text());
+		upnp.initialize((oInter.isEmpty() ? playerSock.getLocalIp() : oInter.text()), settings.getStr("serverport").text());
+		upnp_thread = std::thread(std::ref(upnp));
 #endif
 
+		// Serve the metrics page on localhost if asked to.
+		CString metricsPort = settings.getStr("metricsport");
+		if (!metricsPort.isEmpty() && metricsPort != "0")
+			metrics.init(metricsPort);
+	}
+
 #ifdef V8NPCSERVER
 	// Setup NPC Control port
 	mNCPort = strtoint(settings.getStr("serverport"));
@@ -165,21 +228,40 @@ int TServer::init(const CString& serverip, const CString& serverport, const CStr
 	addPlayer(mNpcServer);
 #endif
 
-	// Connect to the serverlist.
-	serverlog.out("[%s]      Initializing serverlist socket.\n", name.text());
-	if (!serverlist.init(settings.getStr("listip"), settings.getStr("listport")))
+	if (!replay)
 	{
-		serverlog.out("[%s] ** [Error] Could not initialize serverlist socket.\n", name.text());
-		return ERR_LISTEN;
-	}
-	serverlist.connectServer();
+		// Connect to the serverlist.
+		serverlog.out("[%s]      Initializing serverlist socket.\n", name.text());
+		if (!serverlist.init(settings.getStr("listip"), settings.getStr("listport")))
+		{
+			serverlog.out("[%s] ** [Error] Could not initialize serverlist socket.\n", name.text());
+			return ERR_LISTEN;
+		}
+		serverlist.connectServer();
 
-	// Register ourself with the socket manager.
-	sockManager.registerSocket((CSocketStub*)this);
+		// Register ourself with the socket manager.
+		sockManager.registerSocket((CSocketStub*)this);
+	}
 
 	return 0;
 }
 
+void TServer::openPacketTrace()
+{
+	char timestamp[32];
+	time_t now = time(0);
+	strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", localtime(&now));
+
+	CString tracePath = CString() << serverpath << "logs/packettrace_" << timestamp << ".bin";
+	CFileSystem::fixPathSeparators(&tracePath);
+	if (!packetTrace.open(tracePath))
+	{
+		serverlog.out("[%s] ** [Error] Could not open packet trace %s\n", name.text(), tracePath.text());
+		return;
+	}
+	serverlog.out("[%s]      Recording packets to %s\n", name.text(), tracePath.text());
+}
+
 // Called when the TServer is put into its own thread.
 void TServer::operator()()
 {
@@ -237,7 +319,7 @@ void TServer::cleanupDeletedPlayers()
 					for (auto it = npcNameList.begin(); it != npcNameList.end(); ++it)
 					{
 						TNPC *npcObject = (*it).second;
-						npcObject->queueNpcAction("npc.playerlogout", player);
+						npcObject->queueNpcAction(ScriptActionName::NpcPlayerLogout, player);
 					}
 				}
 
@@ -256,19 +338,12 @@ void TServer::cleanupDeletedPlayers()
 #endif
 
 		// Get rid of the player now.
-		playerIds[player->getId()] = nullptr;
-		for ( auto j = playerList.begin(); j != playerList.end();)
+		freePlayerId(player);
+		if (swapRemove(playerList, player))
 		{
-			TPlayer* p = *j;
-			if (p == player)
-			{
-				// Unregister the player.
-				sockManager.unregisterSocket(p);
-
-				delete p;
-				j = playerList.erase(j);
-			}
-			else ++j;
+			// Unregister the player.
+			sockManager.unregisterSocket(player);
+			delete player;
 		}
 
 		i = deletedPlayers.erase(i);
@@ -291,7 +366,10 @@ void TServer::cleanup()
 	this->TS_Save();
 
 	// Save server flags.
-	saveServerFlags();
+	compactServerFlags();
+
+	// Finish the packet trace.
+	packetTrace.close();
 
 #ifdef V8NPCSERVER
 	// Save npcs
@@ -304,13 +382,27 @@ void TServer::cleanup()
 	for (auto& player : playerList) {
 		delete player;
 	}
+	for (auto& queued : loginQueue) {
+		delete queued.first;
+	}
 	playerIds.clear();
 	playerList.clear();
+	freePlayerIds.clear();
+	loginQueue.clear();
+
+	// Write out any queued account saves.
+	accountSaver.stop();
+
+	// Save the account search index.
+	accountIndex.save();
+	accountIndex.clear();
 
 	for (auto& level : levelList) {
 		delete level;
 	}
 	levelList.clear();
+	levelStates.clear();
+	levelStateBytes = 0;
 
 	for (auto& map : mapList) {
 		delete map;
@@ -323,6 +415,7 @@ void TServer::cleanup()
     npcList.clear();
 	npcIds.clear();
 	npcNameList.clear();
+	freeNPCIds.clear();
 
 	saveWeapons();
 	for (auto& weapon : weaponList) {
@@ -335,6 +428,7 @@ void TServer::cleanup()
 	mScriptEngine.Cleanup();
 #endif
 
+	metrics.cleanup();
 	playerSock.disconnect();
 	serverlist.getSocket()->disconnect();
 
@@ -349,16 +443,42 @@ void TServer::restart()
 
 bool TServer::doMain()
 {
-	// Update our socket manager.
-	sockManager.update(0, 5000);		// 5ms
+	tickProfiler.beginTick();
+
+	// Update our socket manager.  Replays have no sockets to wait on.
+	{
+		CTickPhase phase(&tickProfiler, TICKPHASE_SOCKETS);
+		tickProfiler.beginWait();
+		sockManager.update(0, replay ? 0 : 5000);		// 5ms
+		tickProfiler.endWait();
+	}
 
-	// Current time
-	auto currentTimer = std::chrono::high_resolution_clock::now();
+	// Current time.  Replays go by the trace's clock.
+	auto currentTimer = (replay ? replayStart + std::chrono::milliseconds(replayTime) : std::chrono::high_resolution_clock::now());
+
+	// Replays have no sockets, so their players' queues are sent here.
+	if (replay)
+	{
+		for (auto player : playerList)
+		{
+			if (player->isReplay())
+				player->onSend();
+		}
+	}
 
 #ifdef V8NPCSERVER
-    mScriptEngine.RunScripts(currentTimer);
+	{
+		CTickPhase phase(&tickProfiler, TICKPHASE_SCRIPTS);
+		mScriptEngine.RunScripts(currentTimer);
+	}
 #endif
 
+	// Log in as many queued players as our budget allows.
+	{
+		CTickPhase phase(&tickProfiler, TICKPHASE_LOGINS);
+		processLoginQueue();
+	}
+
 	// Every second, do some events.
 	auto time_diff = std::chrono::duration_cast<std::chrono::milliseconds>(currentTimer - lastTimer);
 	if (time_diff.count() >= 1000)
@@ -367,16 +487,51 @@ bool TServer::doMain()
 		doTimedEvents();
 	}
 
+	unsigned long long tickTime = tickProfiler.endTick();
+	if (slowTickTime > 0 && tickTime >= (unsigned long long)slowTickTime * 1000)
+		reportSlowTick();
+
 	return true;
 }
 
+void TServer::reportSlowTick()
+{
+	// Only log every 10 seconds so a server that is always slow doesn't flood the log.
+	++slowTicks;
+	auto now = std::chrono::steady_clock::now();
+	if (std::chrono::duration_cast<std::chrono::seconds>(now - lastSlowTickReport).count() < 10)
+		return;
+
+	const STickSample& tick = tickProfiler.getLastTick();
+	CString phases;
+	for (int i = 0; i < TICKPHASE_COUNT; ++i)
+	{
+		// Leave out the phases that didn't take a noticeable part of it.
+		if (tick.phases[i] < 1000)
+			continue;
+
+		char phase[64];
+		snprintf(phase, sizeof(phase), "%s%s %.1f ms", (phases.isEmpty() ? "" : ", "), CTickProfiler::getPhaseName(i), (double)tick.phases[i] / 1000.0);
+		phases << phase;
+	}
+
+	serverlog.out("[%s] Slow tick: %.1f ms (%s).  %d ticks went over %d ms since the last report.\n", name.text(), (double)tick.total / 1000.0, phases.text(), slowTicks, slowTickTime);
+	slowTicks = 0;
+	lastSlowTickReport = now;
+}
+
 bool TServer::doTimedEvents()
 {
 	// Do serverlist events.
-	serverlist.doTimedEvents();
+	if (!replay)
+	{
+		CTickPhase phase(&tickProfiler, TICKPHASE_SERVERLIST);
+		serverlist.doTimedEvents();
+	}
 
 	// Do player events.
 	{
+		CTickPhase phase(&tickProfiler, TICKPHASE_PLAYEREVENTS);
 		for (auto & player : playerList)
 		{
 			assert(player);
@@ -388,25 +543,24 @@ bool TServer::doTimedEvents()
 		}
 	}
 
-	// Do level events.
+	// Do level events.  Board changes, items, horses and baddies in every level, including
+	// group and singleplayer levels, sit in the timer wheel until they expire.
 	{
-		for (auto level : levelList)
-		{
-            assert(level);
-			level->doTimedEvents();
-		}
+		CTickPhase phase(&tickProfiler, TICKPHASE_LEVELEVENTS);
+		timerWheel.tick();
+	}
 
-		// Group levels.
-		for (auto & groupLevel : groupLevels)
-		{
-			for (auto & j : groupLevel.second)
-			{
-				TLevel* level = j.second;
-				assert(level);
+	// Drop finished metrics scrapes.
+	metrics.doTimedEvents();
 
-				level->doTimedEvents();
-			}
-		}
+	// Log any account saves the writer thread couldn't make.
+	accountSaver.reportErrors();
+
+	// Let players waiting to log in know where they are in the queue.
+	{
+		CTickPhase phase(&tickProfiler, TICKPHASE_LOGINS);
+		dropDisconnectedLogins();
+		sendLoginQueuePositions();
 	}
 
 	// Send NW time.
@@ -422,9 +576,22 @@ bool TServer::doTimedEvents()
 	if (time_diff.count() >= 60)
 	{
 		last1mTimer = lastTimer;
+		CTickPhase phase(&tickProfiler, TICKPHASE_SAVES);
 
 		// Save server flags.
 		this->saveServerFlags();
+
+		// Keep the packet trace on disk in case we crash.
+		packetTrace.flush();
+
+		// Unload levels nobody has used for a while.
+		{
+			CTickPhase levelPhase(&tickProfiler, TICKPHASE_LEVELEVENTS);
+			unloadIdleLevels();
+#ifdef V8NPCSERVER
+			releaseIdleScripts();
+#endif
+		}
 	}
 
 	// Stuff that happens every 3 minutes.
@@ -432,6 +599,7 @@ bool TServer::doTimedEvents()
 	if (time_diff.count() >= 180)
 	{
 		last3mTimer = lastTimer;
+		CTickPhase phase(&tickProfiler, TICKPHASE_FILESYSTEM);
 
 		// TODO(joey): probably a better way to do this..
 
@@ -448,20 +616,27 @@ bool TServer::doTimedEvents()
 		last5mTimer = lastTimer;
 
 		// Reload some server settings.
-		loadAllowedVersions();
-		loadServerMessage();
-		loadIPBans();
+		{
+			CTickPhase phase(&tickProfiler, TICKPHASE_FILESYSTEM);
+			loadAllowedVersions();
+			loadServerMessage();
+			loadIPBans();
+		}
 
 		// Save some stuff.
 		// TODO(joey): Is this really needed? We save weapons to disk when it is updated or created anyway..
-		saveWeapons();
+		{
+			CTickPhase phase(&tickProfiler, TICKPHASE_SAVES);
+			saveWeapons();
 #ifdef V8NPCSERVER
-		saveNpcs();
+			saveNpcs();
 #endif
+		}
 
 		// Check all of the instanced maps to see if the players have left.
 		if (!groupLevels.empty())
 		{
+			CTickPhase phase(&tickProfiler, TICKPHASE_LEVELEVENTS);
 			for (auto i = groupLevels.begin(); i != groupLevels.end();)
 			{
 				// Check if any players are found.
@@ -495,8 +670,104 @@ bool TServer::doTimedEvents()
 	return true;
 }
 
+void TServer::unloadIdleLevels()
+{
+	int unloadTime = settings.getInt("levelunloadtime", 0);
+	bool keepState = settings.getBool("levelunloadstate", true);
+	time_t now = time(0);
+
+	// Players and database npcs can point at a level without being in its lists, like while warping.
+	std::unordered_set<TLevel *> inUse;
+	for (auto player : playerList)
+	{
+		if (player->getLevel() != nullptr)
+			inUse.insert(player->getLevel());
+	}
+	for (auto npc : npcList)
+	{
+		if (!npc->isLevelNPC() && npc->getLevel() != nullptr)
+			inUse.insert(npc->getLevel());
+	}
+
+	std::vector<TLevel *> keptLevels;
+	keptLevels.reserve(levelList.size());
+	size_t memory = 0;
+	int unloaded = 0;
+	for (auto level : levelList)
+	{
+		if (unloadTime <= 0 || (int)difftime(now, level->getLastUsed()) < unloadTime * 60 || inUse.count(level) != 0 || !level->canUnload())
+		{
+			memory += level->getMemoryUsage();
+			keptLevels.push_back(level);
+			continue;
+		}
+
+		std::string key = level->getLevelName().toLower().text();
+		auto oldState = levelStates.find(key);
+		if (oldState != levelStates.end())
+		{
+			levelStateBytes -= oldState->second.length();
+			levelStates.erase(oldState);
+		}
+		if (keepState)
+		{
+			CString state = level->getState();
+			if (!state.isEmpty())
+			{
+				levelStateBytes += state.length();
+				levelStates[key] = state;
+			}
+		}
+
+		// Players on gmaps keep the levels next to them in their level cache.
+		for (auto player : playerList)
+			player->resetLevelCache(level);
+
+		delete level;
+		++unloaded;
+	}
+	levelList.swap(keptLevels);
+	levelMemoryUsage = memory;
+	unloadedLevelCount += unloaded;
+
+	if (unloaded != 0)
+		serverlog.out("[%s] Unloaded %d idle levels.  %d levels are still loaded.\n", name.text(), unloaded, (int)levelList.size());
+}
+
+#ifdef V8NPCSERVER
+void TServer::releaseIdleScripts()
+{
+	if (!mScriptEngine.getDormantNpcs())
+		return;
+
+	// Levels that have been empty for a minute put their npcs back to sleep and free their compiled scripts.
+	time_t now = time(0);
+	for (auto level : levelList)
+	{
+		if (!level->getPlayerList()->empty() || difftime(now, level->getLastUsed()) < 60)
+			continue;
+
+		for (auto npc : *level->getLevelNPCs())
+			npc->releaseScript();
+	}
+}
+#endif
+
+void TServer::restoreLevelState(TLevel* pLevel)
+{
+	auto state = levelStates.find(pLevel->getLevelName().toLower().text());
+	if (state == levelStates.end())
+		return;
+
+	levelStateBytes -= state->second.length();
+	pLevel->setState(state->second);
+	levelStates.erase(state);
+}
+
 bool TServer::onRecv()
 {
+	tickProfiler.endWait();
+
 	// Create socket.
 	CSocket *newSock = playerSock.accept();
 	if (newSock == nullptr)
@@ -514,6 +785,7 @@ bool TServer::onRecv()
 
 	// Add them to the socket manager.
 	sockManager.registerSocket((CSocketStub*)newPlayer);
+	packetTrace.writeConnect(newPlayer->getId(), newSock->getRemoteIp());
 
 	return true;
 }
@@ -655,11 +927,47 @@ void TServer::loadSettings()
 			serverlog.out("[%s] ** [Error] Could not open config/serveroptions.txt.  Will use default config.\n", name.text());
 	}
 
+	// Ticks longer than this get logged.
+	slowTickTime = settings.getInt("slowtick", 100);
+
 	// Load status list.
 	statusList = settings.getStr("playerlisticons", "Online,Away,DND,Eating,Hiding,No PMs,RPing,Sparring,PKing").tokenize(",");
 
-	// Send our ServerHQ info in case we got changed the staffonly setting.
-	getServerList()->sendServerHQ();
+	// Rebuild the login packets that depend on our settings.
+	buildLoginPackets();
+
+	// Send our ServerHQ info in case we got changed the staffonly setting.  The password is in adminconfig.txt, so on
+	// startup this waits for loadAdminSettings to send it.
+	if (adminsettings.isOpened())
+		getServerList()->sendServerHQ();
+}
+
+void TServer::buildLoginPackets()
+{
+	// graal doesn't quote these
+	mStatusListPacket = CString() >> (char)PLO_STATUSLIST;
+	for (auto & status : statusList)
+		mStatusListPacket << status.trim() << ",";
+	mStatusListPacket.remove(mStatusListPacket.length() - 1, 1);
+
+	// Guilds that should be placed in the Staff section of the playerlist.
+	std::vector<CString> guilds = settings.getStr("staffguilds").tokenize(",");
+	mStaffGuildsPacket = CString() >> (char)PLO_STAFFGUILDS;
+	for (auto & guild : guilds)
+		mStaffGuildsPacket << "\"" << guild.trim() << "\",";
+	mStaffGuildsPacket.remove(mStaffGuildsPacket.length() - 1, 1);
+
+	// Bigmap, minimap and RPG Window greeting for 2.1+ clients.
+	mLoginMapPacket.clear();
+	std::vector<CString> vbigmap = settings.getStr("bigmap").tokenize(",");
+	if (vbigmap.size() == 4)
+		mLoginMapPacket >> (char)PLO_BIGMAP << vbigmap[0].trim() << "," << vbigmap[1].trim() << "," << vbigmap[2].trim() << "," << vbigmap[3].trim() << "\n";
+
+	std::vector<CString> vminimap = settings.getStr("minimap").tokenize(",");
+	if (vminimap.size() == 4)
+		mLoginMapPacket >> (char)PLO_MINIMAP << vminimap[0].trim() << "," << vminimap[1].trim() << "," << vminimap[2].trim() << "," << vminimap[3].trim() << "\n";
+
+	mLoginMapPacket >> (char)PLO_RPGWINDOW << "\"Welcome to " << settings.getStr("name") << ".\",\"Graal Reborn GServer programmed by " << CString(GSERVER_CREDITS) << ".\"\n";
 }
 
 void TServer::loadAdminSettings()
@@ -668,7 +976,9 @@ void TServer::loadAdminSettings()
 	adminsettings.loadFile(CString() << serverpath << "config/adminconfig.txt");
 	if (!adminsettings.isOpened())
 		serverlog.out("[%s] ** [Error] Could not open config/adminconfig.txt.  Will use default config.\n", name.text());
-	else getServerList()->sendServerHQ();
+
+	// serveroptions.txt is loaded first, so this has everything the ServerHQ info needs.
+	getServerList()->sendServerHQ();
 }
 
 void TServer::loadAllowedVersions()
@@ -715,9 +1025,32 @@ void TServer::loadFileSystem()
 
 void TServer::loadServerFlags()
 {
+	// If we already have flags, they are newer than anything in the journal.
+	bool replayJournal = mServerFlags.empty();
+
 	std::vector<CString> lines = CString::loadToken(CString() << serverpath << "serverflags.txt", "\n", true);
 	for (auto & line : lines)
 		this->setFlag(line, false);
+
+	// Apply the changes made since the flags were last compacted.
+	if (replayJournal)
+	{
+		lines = CString::loadToken(CString() << serverpath << "serverflags_journal.txt", "\n", true);
+		for (auto & line : lines)
+		{
+			if (line.isEmpty())
+				continue;
+
+			switch (line[0])
+			{
+				case '+': this->setFlag(line.subString(1), false); break;
+				case '-': this->deleteFlag(line.subString(1).text(), false); break;
+				case '!': this->clearFlags(); break;
+			}
+		}
+	}
+
+	compactServerFlags();
 }
 
 void TServer::loadServerMessage()
@@ -744,6 +1077,9 @@ void TServer::loadClasses(bool print)
 		CString scriptData;
 		scriptData.load(scriptFile.second);
 		classList[className] = scriptData.text();
+#ifdef V8NPCSERVER
+		classHashes[className] = CScriptEngine::HashScript(scriptData.text(), scriptData.length());
+#endif
 	}
 }
 
@@ -909,10 +1245,10 @@ void TServer::loadNpcs(bool print)
 			{
 				// Assign id to npc
 				if (npcIds.size() <= npcId)
-					npcIds.resize((size_t)npcId + 10);
+					growNPCIds((size_t)npcId + 10);
 
 				npcIds[npcId] = newNPC;
-				npcList.push_back(newNPC);
+				addToNPCList(newNPC);
 				assignNPCName(newNPC, newNPC->getName());
 
 				// Add npc to level
@@ -941,11 +1277,54 @@ void TServer::loadWordFilter()
 }
 
 void TServer::saveServerFlags()
+{
+	if (mServerFlagsJournal.isEmpty())
+		return;
+
+	// Compact once the journal holds more entries than there are flags.  Rewriting serverflags.txt costs one line per
+	// flag, so it never costs more than writing the journal entries it replaces did.
+	if (mServerFlagsJournalCount > (int)mServerFlags.size())
+	{
+		compactServerFlags();
+		return;
+	}
+
+	// Only append the changes.
+	CString journalPath = CString() << serverpath << "serverflags_journal.txt";
+	FILE* file = fopen(journalPath.text(), "ab");
+	if (file == nullptr)
+	{
+		serverlog.out("[%s] ** [Error] Could not write serverflags_journal.txt.\n", name.text());
+		return;
+	}
+
+	fwrite(mServerFlagsJournal.text(), 1, mServerFlagsJournal.length(), file);
+	fclose(file);
+	mServerFlagsJournal.clear();
+}
+
+void TServer::compactServerFlags()
 {
 	CString out;
 	for (auto & mServerFlag : mServerFlags)
 		out << mServerFlag.first << "=" << mServerFlag.second << "\r\n";
-	out.save(CString() << serverpath << "serverflags.txt");
+
+	// Write the full flag list, then throw away the journal.
+	CString flagsPath = CString() << serverpath << "serverflags.txt";
+	CString tempPath = CString() << flagsPath << ".tmp";
+	if (!out.save(tempPath))
+	{
+		serverlog.out("[%s] ** [Error] Could not write serverflags.txt.\n", name.text());
+		return;
+	}
+#if defined(WIN32) || defined(WIN64)
+	remove(flagsPath.text());
+#endif
+	rename(tempPath.text(), flagsPath.text());
+
+	CString().save(CString() << serverpath << "serverflags_journal.txt");
+	mServerFlagsJournal.clear();
+	mServerFlagsJournalCount = 0;
 }
 
 void TServer::saveWeapons()
@@ -984,6 +1363,20 @@ void TServer::saveNpcs()
 	}
 }
 
+// Longest tick, and how often the script ran over its budget
+static std::string getScriptBudgetStats(ScriptExecutionContext *context, const ScriptExecutionData& executionData)
+{
+	std::string stats(" [peak ");
+	stats.append(CString(executionData.peak * 1000.0).text()).append("ms");
+	if (executionData.deferred > 0)
+		stats.append(", over budget ").append(std::to_string(executionData.deferred)).append("x");
+	if (context->getCoalescedCount() > 0)
+		stats.append(", coalesced ").append(std::to_string(context->getCoalescedCount()));
+	if (context->isDisabled())
+		stats.append(", disabled");
+	return stats.append("]");
+}
+
 std::vector<std::pair<double, std::string>> TServer::calculateNpcStats()
 {
 	std::vector<std::pair<double, std::string>> script_profiles;
@@ -993,8 +1386,8 @@ std::vector<std::pair<double, std::string>> TServer::calculateNpcStats()
 	{
 		TNPC *npc = *it;
 		ScriptExecutionContext *context = npc->getExecutionContext();
-		std::pair<unsigned int, double> executionData = context->getExecutionData();
-		if (executionData.second > 0.0)
+		ScriptExecutionData executionData = context->getExecutionData();
+		if (executionData.time > 0.0 || context->isDisabled())
 		{
 			std::string npcName = npc->getName();
 			if (npcName.empty())
@@ -1007,7 +1400,7 @@ std::vector<std::pair<double, std::string>> TServer::calculateNpcStats()
 					append(", ").append(CString((float)npc->getPixelY() / 16.0f).text()).append(")");
 			}
 
-			script_profiles.push_back(std::make_pair(executionData.second, npcName));
+			script_profiles.push_back(std::make_pair(executionData.time, npcName + getScriptBudgetStats(context, executionData)));
 		}
 	}
 
@@ -1016,13 +1409,13 @@ std::vector<std::pair<double, std::string>> TServer::calculateNpcStats()
 	{
 		TWeapon *weapon = (*it).second;
 		ScriptExecutionContext *context = weapon->getExecutionContext();
-		std::pair<unsigned int, double> executionData = context->getExecutionData();
+		ScriptExecutionData executionData = context->getExecutionData();
 
-		if (executionData.second > 0.0)
+		if (executionData.time > 0.0 || context->isDisabled())
 		{
 			std::string weaponName("Weapon ");
 			weaponName.append((*it).first.text());
-			script_profiles.push_back(std::make_pair(executionData.second, weaponName));
+			script_profiles.push_back(std::make_pair(executionData.time, weaponName + getScriptBudgetStats(context, executionData)));
 		}
 	}
 
@@ -1242,10 +1635,10 @@ TNPC* TServer::addServerNpc(int npcId, float pX, float pY, TLevel *pLevel, bool
 	// Create the npc
 	TNPC* newNPC = new TNPC("", "", pX, pY, this, pLevel, false);
 	newNPC->setId(npcId);
-	npcList.push_back(newNPC);
+	addToNPCList(newNPC);
 
 	if (npcIds.size() <= npcId)
-		npcIds.resize((size_t)npcId + 10);
+		growNPCIds((size_t)npcId + 10);
 	npcIds[npcId] = newNPC;
 
 	// Add the npc to the level
@@ -1280,7 +1673,7 @@ void TServer::handlePM(TPlayer * player, const CString & message)
 
 	printf("Msg: %s\n", std::string(message.text()).c_str());
 
-	ScriptAction *scriptAction = mScriptEngine.CreateAction("npcserver.playerpm", player->getScriptObject(), std::string(message.text()));
+	ScriptAction *scriptAction = mScriptEngine.CreateAction(ScriptActionName::NpcServerPlayerPM, player->getScriptObject(), std::string(message.text()));
 	mPmHandlerNpc->getExecutionContext()->addAction(scriptAction);
 	mScriptEngine.RegisterNpcUpdate(mPmHandlerNpc);
 }
@@ -1304,27 +1697,12 @@ TNPC* TServer::addNPC(const CString& pImage, const CString& pScript, float pX, f
 {
 	// New Npc
 	TNPC* newNPC = new TNPC(pImage, pScript, pX, pY, this, pLevel, pLevelNPC);
-	npcList.push_back(newNPC);
-
-	// Assign NPC Id
-	bool assignedId = false;
-	for (unsigned int i = 10000; i < npcIds.size(); ++i)
-	{
-		if (npcIds[i] == 0)
-		{
-			npcIds[i] = newNPC;
-			newNPC->setId(i);
-			assignedId = true;
-			break;
-		}
-	}
+	addToNPCList(newNPC);
 
 	// Assign NPC Id
-	if ( !assignedId )
-	{
-		newNPC->setId(npcIds.size());
-		npcIds.push_back(newNPC);
-	}
+	unsigned int npcId = getFreeNPCId();
+	npcIds[npcId] = newNPC;
+	newNPC->setId(npcId);
 
 	// Send the NPC's props to everybody in range.
 	if (sendToPlayers)
@@ -1353,15 +1731,14 @@ bool TServer::deleteNPC(TNPC* npc, bool eraseFromLevel)
 	if (npc == nullptr) return false;
 	if (npc->getId() >= npcIds.size()) return false;
 
-	// Remove the NPC from all the lists.
-	npcIds[npc->getId()] = nullptr;
-
-	for ( auto npcL = npcList.begin(); npcL != npcList.end(); )
+	// Remove the NPC from all the lists.  Database npc ids are picked by hand, so only give back the automatic ones.
+	if (npcIds[npc->getId()] == npc)
 	{
-		if ((*npcL) == npc)
-			npcL = npcList.erase(npcL);
-		else ++npcL;
+		npcIds[npc->getId()] = nullptr;
+		if (npc->getId() >= 10000)
+			pushFreeId(freeNPCIds, npc->getId());
 	}
+	swapRemove(npcList, npc);
 
 	TLevel *level = npc->getLevel();
 
@@ -1421,6 +1798,9 @@ bool TServer::deleteClass(const std::string& className)
 		return false;
 
 	classList.erase(classIter);
+#ifdef V8NPCSERVER
+	classHashes.erase(className);
+#endif
 	CString filePath = getServerPath() << "scripts/" << className << ".txt";
 	CFileSystem::fixPathSeparators(&filePath);
 	remove(filePath.text());
@@ -1432,6 +1812,9 @@ void TServer::updateClass(const std::string& className, const std::string& class
 {
 	// TODO(joey): filenames...
 	classList[className] = classCode;
+#ifdef V8NPCSERVER
+	classHashes[className] = CScriptEngine::HashScript(classCode.c_str(), classCode.length());
+#endif
 
 	CString filePath = getServerPath() << "scripts/" << className << ".txt";
 	CFileSystem::fixPathSeparators(&filePath);
@@ -1442,22 +1825,70 @@ void TServer::updateClass(const std::string& className, const std::string& class
 
 unsigned int TServer::getFreePlayerId()
 {
-	unsigned int newId = 0;
-	for (unsigned int i = 2; i < playerIds.size(); ++i)
+	// Ids can be taken by hand after they were freed, so skip the ones that are in use again.
+	while (!freePlayerIds.empty())
 	{
-		if (playerIds[i] == nullptr)
-		{
-			newId = i;
-			i = playerIds.size();
-		}
+		unsigned int id = popFreeId(freePlayerIds);
+		if (id < playerIds.size() && playerIds[id] == nullptr)
+			return id;
 	}
-	if (newId == 0)
+
+	playerIds.push_back(nullptr);
+	return (unsigned int)(playerIds.size() - 1);
+}
+
+unsigned int TServer::getFreeNPCId()
+{
+	while (!freeNPCIds.empty())
 	{
-		newId = playerIds.size();
-		playerIds.push_back(nullptr);
+		unsigned int id = popFreeId(freeNPCIds);
+		if (id < npcIds.size() && npcIds[id] == nullptr)
+			return id;
 	}
 
-	return newId;
+	npcIds.push_back(nullptr);
+	return (unsigned int)(npcIds.size() - 1);
+}
+
+void TServer::growPlayerIds(size_t size)
+{
+	// Player ids 0 and 1 are never handed out.
+	for (size_t i = std::max(playerIds.size(), (size_t)2); i < size; ++i)
+		pushFreeId(freePlayerIds, (unsigned int)i);
+	if (playerIds.size() < size)
+		playerIds.resize(size);
+}
+
+void TServer::growNPCIds(size_t size)
+{
+	// Ids under 10000 are for database npcs, which pick their own.
+	for (size_t i = std::max(npcIds.size(), (size_t)10000); i < size; ++i)
+		pushFreeId(freeNPCIds, (unsigned int)i);
+	if (npcIds.size() < size)
+		npcIds.resize(size);
+}
+
+void TServer::freePlayerId(TPlayer* player)
+{
+	unsigned int id = (unsigned int)player->getId();
+	if (id >= playerIds.size() || playerIds[id] != player)
+	{
+		// Failed logins are set to id 0 so their account doesn't get saved.  Find the id they really had.
+		auto slot = std::find(playerIds.begin(), playerIds.end(), player);
+		if (slot == playerIds.end())
+			return;
+		id = (unsigned int)(slot - playerIds.begin());
+	}
+
+	playerIds[id] = nullptr;
+	if (id >= 2)
+		pushFreeId(freePlayerIds, id);
+}
+
+void TServer::addToNPCList(TNPC* npc)
+{
+	npc->setListIndex(npcList.size());
+	npcList.push_back(npc);
 }
 
 bool TServer::addPlayer(TPlayer *player, unsigned int id)
@@ -1468,14 +1899,14 @@ bool TServer::addPlayer(TPlayer *player, unsigned int id)
 	if (id == UINT_MAX)
 		id = getFreePlayerId();
 	else if (playerIds.size() <= id)
-		playerIds.resize((size_t)id + 10);
+		growPlayerIds((size_t)id + 10);
 	else if (playerIds[id] != nullptr)
 		return false;
 
 	// Add them to the player list.
 	player->setId(id);
 	playerIds[id] = player;
-	playerList.push_back(player);
+	pushListed(playerList, player);
 
 #ifdef V8NPCSERVER
 	// Create script object for player
@@ -1493,8 +1924,23 @@ bool TServer::deletePlayer(TPlayer* player)
 	// Add the player to the set of players to delete.
 	if ( deletedPlayers.insert(player).second )
 	{
+		// Drop the player from the login queue.  cleanupDeletedPlayers takes them off the player list, so they go
+		// back on it.
+		for (auto i = loginQueue.begin(); i != loginQueue.end(); ++i)
+		{
+			if (i->first == player)
+			{
+				loginQueue.erase(i);
+				pushListed(playerList, player);
+				break;
+			}
+		}
+
 		// Remove the player from the serverlist.
 		getServerList()->deletePlayer(player);
+
+		if (player->getSocket() != nullptr)
+			packetTrace.writeDisconnect(player->getId());
 	}
 
 	return true;
@@ -1510,11 +1956,84 @@ void TServer::playerLoggedIn(TPlayer *player)
 	for (auto it = npcNameList.begin(); it != npcNameList.end(); ++it)
 	{
 		TNPC *npcObject = (*it).second;
-		npcObject->queueNpcAction("npc.playerlogin", player);
+		npcObject->queueNpcAction(ScriptActionName::NpcPlayerLogin, player);
 	}
 #endif
 }
 
+void TServer::queueLogin(TPlayer *player)
+{
+	// RC and NC logins skip the queue, as does everybody when there is no budget set.
+	if (!player->isClient() || settings.getInt("loginbudget", 20) <= 0)
+	{
+		loginPlayer(player);
+		return;
+	}
+
+	// Queued players aren't logged in, so they stay off the player list until they are.  Broadcasts and
+	// everything else that goes through the player list only sees players that are in.
+	loginQueue.emplace_back(player, 0);
+	swapRemove(playerList, player);
+}
+
+void TServer::loginPlayer(TPlayer *player)
+{
+	// Send the player his account.  If it fails, disconnect him.
+	if (player->sendLogin() == false)
+	{
+		//player->sendPacket(CString() >> (char)PLO_DISCMESSAGE << "Failed to send login information.");
+		player->setId(0);	// Prevent saving of the account.
+		player->disconnect();
+	}
+}
+
+void TServer::processLoginQueue()
+{
+	if (loginQueue.empty())
+		return;
+
+	// Always log in at least one player per tick, then keep going until we use up the budget (ms).
+	int budget = settings.getInt("loginbudget", 20);
+	auto startTimer = std::chrono::high_resolution_clock::now();
+	do
+	{
+		TPlayer *player = loginQueue.front().first;
+		loginQueue.pop_front();
+		pushListed(playerList, player);
+		loginPlayer(player);
+	} while (!loginQueue.empty() && (budget <= 0 || std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTimer).count() < budget));
+}
+
+void TServer::dropDisconnectedLogins()
+{
+	// Queued players miss the disconnect check in the player events, so it is done here.
+	std::vector<TPlayer *> disconnected;
+	for (auto & queued : loginQueue)
+	{
+		CSocket *socket = queued.first->getSocket();
+		if (!queued.first->isReplay() && (socket == nullptr || socket->getState() == SOCKET_STATE_DISCONNECTED))
+			disconnected.push_back(queued.first);
+	}
+
+	for (auto player : disconnected)
+		deletePlayer(player);
+}
+
+void TServer::sendLoginQueuePositions()
+{
+	size_t position = 0;
+	for (auto & queued : loginQueue)
+	{
+		// Only tell them when it changes.
+		++position;
+		if (queued.second == position)
+			continue;
+
+		queued.second = position;
+		queued.first->sendPacket(CString() >> (char)PLO_STARTMESSAGE << "You are number " << CString((int)position) << " in the login queue.  Please wait.");
+	}
+}
+
 unsigned int TServer::getNWTime() const
 {
 	// timevar apparently subtracts 11078 days from time(0) then divides by 5.
@@ -1548,6 +2067,33 @@ void TServer::logToFile(const std::string & fileName, const std::string & messag
 /*
 	TServer: Server Flag Management
 */
+void TServer::journalFlag(const CString& pEntry)
+{
+	mServerFlagsJournal << pEntry << "\r\n";
+	mServerFlagsJournalCount++;
+}
+
+const CString& TServer::getServerFlagsPacket()
+{
+	// Rebuild the packet once it is mostly made up of appended changes.
+	if (mServerFlagsPacketSize == -1 || mServerFlagsPacket.length() > mServerFlagsPacketSize * 2 + 4096)
+	{
+		mServerFlagsPacket.clear();
+		for (auto & mServerFlag : mServerFlags)
+			mServerFlagsPacket >> (char)PLO_FLAGSET << mServerFlag.first << "=" << mServerFlag.second << "\n";
+		mServerFlagsPacketSize = mServerFlagsPacket.length();
+	}
+
+	return mServerFlagsPacket;
+}
+
+void TServer::clearFlags()
+{
+	mServerFlags.clear();
+	journalFlag("!");
+	mServerFlagsPacketSize = -1;
+}
+
 bool TServer::deleteFlag(const std::string& pFlagName, bool pSendToPlayers)
 {
 	if ( settings.getBool("dontaddserverflags", false))
@@ -1557,6 +2103,10 @@ bool TServer::deleteFlag(const std::string& pFlagName, bool pSendToPlayers)
 	if ((mServerFlag = mServerFlags.find(pFlagName)) != mServerFlags.end())
 	{
 		mServerFlags.erase(mServerFlag);
+		journalFlag(CString() << "-" << pFlagName);
+		if (mServerFlagsPacketSize != -1)
+			mServerFlagsPacket >> (char)PLO_FLAGDEL << pFlagName << "\n";
+
 		if (pSendToPlayers)
 			sendPacketToAll(CString() >> (char)PLO_FLAGDEL << pFlagName);
 		return true;
@@ -1593,6 +2143,10 @@ bool TServer::setFlag(const std::string& pFlagName, const CString& pFlagValue, b
 	}
 	else mServerFlags[pFlagName] = pFlagValue;
 
+	journalFlag(CString() << "+" << pFlagName << "=" << mServerFlags[pFlagName]);
+	if (mServerFlagsPacketSize != -1)
+		mServerFlagsPacket >> (char)PLO_FLAGSET << pFlagName << "=" << mServerFlags[pFlagName] << "\n";
+
 	if (pSendToPlayers)
 		sendPacketToAll(CString() >> (char)PLO_FLAGSET << pFlagName << "=" << pFlagValue);
 	return true;
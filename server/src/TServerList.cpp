@@ -79,6 +79,8 @@ bool TServerList::getConnected() const
 
 bool TServerList::onRecv()
 {
+	_server->getTickProfiler()->endWait();
+
 	// Grab the data from the socket and put it into our receive buffer.
 	unsigned int size = 0;
 	char* data = sock.getData(&size);
@@ -94,6 +96,8 @@ bool TServerList::onRecv()
 
 bool TServerList::onSend()
 {
+	_server->getTickProfiler()->endWait();
+
 	_fileQueue.sendCompress();
 	return true;
 }
@@ -706,13 +710,8 @@ void TServerList::msgSVI_VERIACC2(CString& pPacket)
 		return;
 	}
 
-	// Send the player his account.  If it fails, disconnect him.
-	if (player->sendLogin() == false)
-	{
-		//player->sendPacket(CString() >> (char)PLO_DISCMESSAGE << "Failed to send login information.");
-		player->setId(0);	// Prevent saving of the account.
-		player->disconnect();
-	}
+	// Queue the player to be sent his account.
+	_server->queueLogin(player);
 }
 
 void TServerList::msgSVI_FILESTART2(CString& pPacket)
@@ -120,7 +120,10 @@ TWeapon * TWeapon::loadWeapon(const CString& pWeapon, TServer *server)
 
 	TWeapon* ret = new TWeapon(server, weaponName, weaponImage, weaponScript, 0);
 	if (byteCode.size() != 0)
+	{
 		ret->mByteCode = byteCode;
+		ret->mWeaponPacket.clear();
+	}
 
 	return ret;
 }
@@ -165,14 +168,17 @@ bool TWeapon::saveWeapon()
 }
 
 // -- Function: Get Player Packet -- //
-CString TWeapon::getWeaponPacket() const
+const CString& TWeapon::getWeaponPacket() const
 {
-	if (this->isDefault())
-		return CString() >> (char)PLO_DEFAULTWEAPON >> (char)mWeaponDefault;
+	// Bytecode packets carry the current time, so those are rebuilt every time.
+	if (!mWeaponPacket.isEmpty() && mByteCode.empty())
+		return mWeaponPacket;
 
-	if (mByteCode.empty())
+	if (this->isDefault())
+		mWeaponPacket = CString() >> (char)PLO_DEFAULTWEAPON >> (char)mWeaponDefault;
+	else if (mByteCode.empty())
 	{
-		return CString() >> (char)PLO_NPCWEAPONADD
+		mWeaponPacket = CString() >> (char)PLO_NPCWEAPONADD
 			>> (char)mWeaponName.length() << mWeaponName
 			>> (char)NPCPROP_IMAGE >> (char)mWeaponImage.length() << mWeaponImage
 			>> (char)NPCPROP_SCRIPT >> (short)mScriptClient.length() << mScriptClient;
@@ -207,8 +213,10 @@ CString TWeapon::getWeaponPacket() const
 			out << b;
 		}
 
-		return out;
+		mWeaponPacket = out;
 	}
+
+	return mWeaponPacket;
 }
 
 // -- Function: Update Weapon Image/Script -- //
@@ -244,7 +252,7 @@ void TWeapon::updateWeapon(const CString& pImage, const CString& pCode, const ti
 	{
 		SCRIPTENV_D("WEAPON SCRIPT COMPILED\n");
 
-		ScriptAction *scriptAction = scriptEngine->CreateAction("weapon.created", _scriptObject);
+		ScriptAction *scriptAction = scriptEngine->CreateAction(ScriptActionName::WeaponCreated, _scriptObject);
 		_scriptExecutionContext.addAction(scriptAction);
 		scriptEngine->RegisterWeaponUpdate(this);
 	}
@@ -259,11 +267,36 @@ void TWeapon::updateWeapon(const CString& pImage, const CString& pCode, const ti
 		saveWeapon();
 }
 
+#ifdef V8NPCSERVER
+void TWeapon::precompileScript(TServer *server, const CString& pCode, std::function<void(bool)> callback)
+{
+	// Same server script updateWeapon ends up with, so it finds the compiled code in the cache.
+	CString fixedScript;
+	if (pCode.find("\xa7") != -1)
+		fixedScript = pCode.replaceAll("\xa7", "\n");
+	else
+		fixedScript = pCode;
+
+	CString code = fixedScript.readString("//#CLIENTSIDE");
+	server->getScriptEngine()->CompileCacheAsync<TWeapon>(code.text(), CScriptEngine::HashScript(code.text(), code.length()), std::move(callback));
+}
+#endif
+
+void TWeapon::setServerScript(const CString& pScript)
+{
+	mScriptServer = pScript;
+#ifdef V8NPCSERVER
+	// Hash the script once, the script engine caches the compiled code by it.
+	mScriptServerHash = (mScriptServer.isEmpty() ? std::string() : CScriptEngine::HashScript(mScriptServer.text(), mScriptServer.length()));
+#endif
+}
+
 void TWeapon::setClientScript(const CString& pScript)
 {
 	// Remove any comments in the code
 	CString formattedScript = removeComments(pScript);
 	mScriptClient.clear(formattedScript.length());
+	mWeaponPacket.clear();
 
 	// Split code into tokens, trim each line, and use the clientside line ending '\xa7'
 	std::vector<CString> code = formattedScript.tokenize("\n");
@@ -277,7 +310,7 @@ void TWeapon::freeScriptResources()
 {
 	CScriptEngine *scriptEngine = server->getScriptEngine();
 
-	scriptEngine->ClearCache(CScriptEngine::WrapScript<TWeapon>(mScriptServer.text()));
+	scriptEngine->ClearCache<TWeapon>(mScriptServerHash);
 
 	// Clear any queued actions
 	if (_scriptExecutionContext.hasActions())
@@ -295,13 +328,30 @@ void TWeapon::freeScriptResources()
 		delete _scriptObject;
 		_scriptObject = nullptr;
 	}
+
+	// A new script gets to run again
+	_scriptExecutionContext.setDisabled(false);
+}
+
+bool TWeapon::runScriptEvents()
+{
+	// Returns true if we still have actions to run
+	bool hasActions = _scriptExecutionContext.runExecution();
+
+	if (_scriptExecutionContext.wasTerminated())
+	{
+		server->reportScriptException((CString() << "Script for weapon " << mWeaponName << " ran for more than "
+			<< CString((int)server->getScriptEngine()->getScriptHardLimit().count()) << "ms and has been disabled until it is updated.").text());
+	}
+
+	return hasActions;
 }
 
 void TWeapon::queueWeaponAction(TPlayer *player, const std::string& args)
 {
 	CScriptEngine *scriptEngine = server->getScriptEngine();
 
-	ScriptAction *scriptAction = scriptEngine->CreateAction("weapon.serverside", _scriptObject, player->getScriptObject(), args);
+	ScriptAction *scriptAction = scriptEngine->CreateAction(ScriptActionName::WeaponServerside, _scriptObject, player->getScriptObject(), args);
 	_scriptExecutionContext.addAction(scriptAction);
 	scriptEngine->RegisterWeaponUpdate(this);
 }
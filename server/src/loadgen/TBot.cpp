@@ -0,0 +1,375 @@
+#include "IDebug.h"
+#include "IEnums.h"
+#include "CLog.h"
+#include "TAccount.h"
+#include "TBot.h"
+#include "TLoadGen.h"
+
+extern CLog loadgenlog;
+
+// Bots that haven't been let in by now are given up on.
+#define BOT_LOGINTIMEOUT	30
+
+// Sprite directions, in the order the client numbers them.
+static const float botMoves[4][2] =
+{
+	{ 0.0f, -0.5f },	// Up
+	{ -0.5f, 0.0f },	// Left
+	{ 0.0f, 0.5f },		// Down
+	{ 0.5f, 0.0f },		// Right
+};
+
+TBot::TBot(TBotWorker* pWorker, const CString& pAccountName, unsigned int seed)
+: worker(pWorker), loadGen(pWorker->getLoadGen()), accountName(pAccountName), fileQueue(&sock),
+nextIsRaw(false), rawPacketSize(0), largeFile(false),
+state(BOTSTATE_WAITING), x(30.0f), y(30.5f), direction(2), steps(0), random(seed)
+{
+	const SLoadGenOptions& options = loadGen->getOptions();
+	actionMix = std::discrete_distribution<int>(std::begin(options.mix), std::end(options.mix));
+}
+
+/*
+	Socket-Control Functions
+*/
+bool TBot::canRecv()
+{
+	if (sock.getState() == SOCKET_STATE_DISCONNECTED) return false;
+	return true;
+}
+
+bool TBot::onRecv()
+{
+	if (sock.getState() == SOCKET_STATE_DISCONNECTED)
+		return false;
+
+	// Grab the data from the socket and put it into our receive buffer.
+	unsigned int size = 0;
+	char* data = sock.getData(&size);
+	if (size != 0)
+	{
+		rBuffer.write(data, size);
+		worker->getStats().bytesIn += size;
+	}
+	else if (sock.getState() == SOCKET_STATE_DISCONNECTED)
+		return false;
+
+	return doMain();
+}
+
+bool TBot::onSend()
+{
+	if (sock.getState() == SOCKET_STATE_DISCONNECTED)
+		return false;
+
+	fileQueue.sendCompress();
+	return true;
+}
+
+void TBot::onUnregister()
+{
+	// Called when onSend() or onRecv() returns false.
+	SLoadGenStats& stats = worker->getStats();
+	if (state == BOTSTATE_PLAYING)
+		stats.online--;
+	if (state != BOTSTATE_DISCONNECTED && loadGen->isRunning())
+		stats.disconnects++;
+
+	sock.disconnect();
+	state = BOTSTATE_DISCONNECTED;
+}
+
+bool TBot::connect()
+{
+	const SLoadGenOptions& options = loadGen->getOptions();
+	SLoadGenStats& stats = worker->getStats();
+	stats.connects++;
+
+	connectTime = std::chrono::steady_clock::now();
+	if (sock.init(options.host.text(), options.port.text()) != 0 || sock.connect() != 0)
+	{
+		loadgenlog.out("[%s] Could not connect to %s:%s\n", accountName.text(), options.host.text(), options.port.text());
+		stats.failures++;
+		state = BOTSTATE_DISCONNECTED;
+		return false;
+	}
+	worker->getSocketManager()->registerSocket((CSocketStub*)this);
+
+	// The client type is sent as the bit it sets.
+	int clientType = 0;
+	while (clientType < 31 && (1 << clientType) != PLTYPE_CLIENT3)
+		++clientType;
+
+	// The login is sent zlib compressed and unencrypted.  Everything after it uses the gen 5 codec.
+	unsigned char key = (unsigned char)(random() & 0x7F);
+	CString password("loadgen");
+	fileQueue.setCodec(ENCRYPT_GEN_2, 0);
+	sendPacket(CString() >> (char)clientType >> (char)key << options.version.subString(0, 8)
+		>> (char)accountName.length() << accountName
+		>> (char)password.length() << password);
+	fileQueue.sendCompress();
+
+	fileQueue.setCodec(ENCRYPT_GEN_5, key);
+	in_codec.setGen(ENCRYPT_GEN_5);
+	in_codec.reset(key);
+
+	state = BOTSTATE_LOGGINGIN;
+	return true;
+}
+
+void TBot::disconnect()
+{
+	if (state == BOTSTATE_WAITING || state == BOTSTATE_DISCONNECTED)
+		return;
+
+	worker->getSocketManager()->unregisterSocket((CSocketStub*)this);
+	sock.disconnect();
+	state = BOTSTATE_DISCONNECTED;
+}
+
+bool TBot::doMain()
+{
+	CString unBuffer;
+
+	// parse data
+	rBuffer.setRead(0);
+	while (rBuffer.length() > 1)
+	{
+		// packet length
+		unsigned short len = (unsigned short)rBuffer.readShort();
+		if ((unsigned int)len > (unsigned int)rBuffer.length() - 2)
+			break;
+
+		// get packet
+		unBuffer = rBuffer.readChars(len);
+		rBuffer.removeI(0, len + 2);
+
+		decryptPacket(unBuffer);
+		if (!parsePacket(unBuffer))
+			return false;
+	}
+
+	worker->getSocketManager()->updateSingle(this, false, true);
+	return true;
+}
+
+void TBot::decryptPacket(CString& pPacket)
+{
+	// Find the compression type and remove it.
+	int pType = pPacket.readChar();
+	pPacket.removeI(0, 1);
+
+	// Decrypt the packet.
+	in_codec.limitFromType(pType);
+	in_codec.decrypt(pPacket);
+
+	// Uncompress packet
+	if (pType == COMPRESS_ZLIB)
+		pPacket.zuncompressI();
+	else if (pType == COMPRESS_BZ2)
+		pPacket.bzuncompressI();
+}
+
+bool TBot::parsePacket(CString& pPacket)
+{
+	SLoadGenStats& stats = worker->getStats();
+
+	while (pPacket.bytesLeft() > 0)
+	{
+		// Grab a packet out of the input stream.
+		CString curPacket;
+		if (nextIsRaw)
+		{
+			nextIsRaw = false;
+			curPacket = pPacket.readChars(rawPacketSize);
+		}
+		else curPacket = pPacket.readString("\n");
+
+		stats.packetsIn++;
+		unsigned char id = curPacket.readGUChar();
+		switch (id)
+		{
+			case PLO_RAWDATA:
+				nextIsRaw = true;
+				rawPacketSize = curPacket.readGUInt();
+				break;
+
+			// The server sends its signature once it has taken the login.
+			case PLO_SIGNATURE:
+				if (state == BOTSTATE_LOGGINGIN)
+				{
+					state = BOTSTATE_PLAYING;
+					stats.logins++;
+					stats.online++;
+					addLatency(BOTLATENCY_LOGIN, connectTime);
+					nextAction = std::chrono::steady_clock::now();
+				}
+				break;
+
+			case PLO_DISCMESSAGE:
+				loadgenlog.out("[%s] Disconnected: %s\n", accountName.text(), curPacket.readString("").text());
+				if (state == BOTSTATE_LOGGINGIN)
+					stats.failures++;
+				return false;
+
+			case PLO_PLAYERWARP:
+			case PLO_PLAYERWARP2:
+				x = (float)curPacket.readGChar() / 2.0f;
+				y = (float)curPacket.readGChar() / 2.0f;
+				if (!pendingWarps.empty())
+				{
+					addLatency(BOTLATENCY_WARP, pendingWarps.front());
+					pendingWarps.pop_front();
+				}
+				break;
+
+			case PLO_WARPFAILED:
+				if (!pendingWarps.empty())
+				{
+					addLatency(BOTLATENCY_WARP, pendingWarps.front());
+					pendingWarps.pop_front();
+				}
+				break;
+
+			// Large files come in pieces.  Only the end counts.
+			case PLO_LARGEFILESTART:
+				largeFile = true;
+				break;
+
+			case PLO_FILE:
+				if (largeFile)
+					break;
+				// Fall through.
+			case PLO_LARGEFILEEND:
+			case PLO_FILESENDFAILED:
+			case PLO_FILEUPTODATE:
+				largeFile = false;
+				if (!pendingFiles.empty())
+				{
+					addLatency(BOTLATENCY_FILE, pendingFiles.front());
+					pendingFiles.pop_front();
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	return true;
+}
+
+void TBot::sendPacket(CString pPacket)
+{
+	if (pPacket.isEmpty())
+		return;
+
+	// append '\n'
+	if (pPacket[pPacket.length() - 1] != '\n')
+		pPacket.writeChar('\n');
+
+	fileQueue.addPacket(pPacket);
+	worker->getStats().packetsOut++;
+}
+
+/*
+	Bot Behavior
+*/
+void TBot::doTimedEvents(std::chrono::steady_clock::time_point now)
+{
+	if (state == BOTSTATE_LOGGINGIN && now - connectTime > std::chrono::seconds(BOT_LOGINTIMEOUT))
+	{
+		loadgenlog.out("[%s] Timed out logging in.\n", accountName.text());
+		worker->getStats().failures++;
+		disconnect();
+		return;
+	}
+
+	if (state != BOTSTATE_PLAYING || now < nextAction)
+		return;
+
+	doAction();
+	worker->getSocketManager()->updateSingle(this, false, true);
+
+	// Spread the bots out so they don't all act in the same tick.
+	int interval = loadGen->getOptions().interval;
+	nextAction = now + std::chrono::milliseconds(interval / 2 + (interval > 0 ? (int)(random() % interval) : 0));
+}
+
+void TBot::doAction()
+{
+	int action = actionMix(random);
+	worker->getStats().actions[action]++;
+
+	switch (action)
+	{
+		case BOTACTION_WALK:	walk();		break;
+		case BOTACTION_CHAT:	chat();		break;
+		case BOTACTION_WARP:	warp();		break;
+		case BOTACTION_FILE:	wantFile();	break;
+		default:							break;
+	}
+}
+
+void TBot::walk()
+{
+	// Keep going the same way for a few steps, and turn around at the edge of the level.
+	if (steps-- <= 0)
+	{
+		direction = (int)(random() % 4);
+		steps = 4 + (int)(random() % 12);
+	}
+
+	float newX = x + botMoves[direction][0];
+	float newY = y + botMoves[direction][1];
+	if (newX < 0.0f || newX > 62.0f || newY < 0.0f || newY > 62.0f)
+	{
+		direction = (direction + 2) % 4;
+		newX = x + botMoves[direction][0];
+		newY = y + botMoves[direction][1];
+	}
+	x = newX;
+	y = newY;
+
+	sendPacket(CString() >> (char)PLI_PLAYERPROPS
+		>> (char)PLPROP_X >> (char)(x * 2)
+		>> (char)PLPROP_Y >> (char)(y * 2)
+		>> (char)PLPROP_SPRITE >> (char)direction);
+}
+
+void TBot::chat()
+{
+	const std::vector<CString>& chats = loadGen->getOptions().chats;
+
+	CString message;
+	if (chats.empty())
+		message << "Hello from " << accountName;
+	else message = chats[random() % chats.size()];
+
+	sendPacket(CString() >> (char)PLI_PLAYERPROPS >> (char)PLPROP_CURCHAT >> (char)message.length() << message);
+}
+
+void TBot::warp()
+{
+	const SLoadGenOptions& options = loadGen->getOptions();
+	const CString& level = (options.levels.empty() ? options.startLevel : options.levels[random() % options.levels.size()]);
+
+	float warpX = (float)(8 + random() % 48);
+	float warpY = (float)(8 + random() % 48);
+	sendPacket(CString() >> (char)PLI_LEVELWARP >> (char)(warpX * 2) >> (char)(warpY * 2) << level);
+	pendingWarps.push_back(std::chrono::steady_clock::now());
+}
+
+void TBot::wantFile()
+{
+	const SLoadGenOptions& options = loadGen->getOptions();
+	const CString& file = (options.files.empty() ? options.startLevel : options.files[random() % options.files.size()]);
+
+	sendPacket(CString() >> (char)PLI_WANTFILE << file);
+	pendingFiles.push_back(std::chrono::steady_clock::now());
+}
+
+void TBot::addLatency(int type, std::chrono::steady_clock::time_point start)
+{
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	worker->getStats().latency[type].push_back(ms);
+}
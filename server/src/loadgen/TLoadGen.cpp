@@ -0,0 +1,258 @@
+#include "IDebug.h"
+#include <algorithm>
+#include <sys/stat.h>
+#include "CLog.h"
+#include "TBot.h"
+#include "TLoadGen.h"
+
+extern CLog loadgenlog;
+
+// Roughly how many bots one select() call can handle.
+#define LOADGEN_BOTSPERTHREAD	500
+
+SLoadGenOptions::SLoadGenOptions()
+: host("127.0.0.1"), port("14802"), version("GNW03014"), accountPrefix("loadbot"), startLevel("onlinestartlocal.nw"),
+bots(100), rate(50), duration(60), interval(500), reportInterval(5), threads(0)
+{
+	mix[BOTACTION_WALK] = 60;
+	mix[BOTACTION_CHAT] = 10;
+	mix[BOTACTION_WARP] = 5;
+	mix[BOTACTION_FILE] = 5;
+	mix[BOTACTION_IDLE] = 20;
+}
+
+/*
+	SLoadGenStats
+*/
+void SLoadGenStats::clear()
+{
+	online = 0;
+	connects = logins = failures = disconnects = 0;
+	packetsIn = packetsOut = bytesIn = 0;
+	for (auto & action : actions)
+		action = 0;
+	for (auto & samples : latency)
+		samples.clear();
+}
+
+void SLoadGenStats::merge(SLoadGenStats& other)
+{
+	online += other.online;
+	connects += other.connects;
+	logins += other.logins;
+	failures += other.failures;
+	disconnects += other.disconnects;
+	packetsIn += other.packetsIn;
+	packetsOut += other.packetsOut;
+	bytesIn += other.bytesIn;
+	for (int i = 0; i < BOTACTION_COUNT; ++i)
+		actions[i] += other.actions[i];
+	for (int i = 0; i < BOTLATENCY_COUNT; ++i)
+		latency[i].insert(latency[i].end(), other.latency[i].begin(), other.latency[i].end());
+}
+
+/*
+	TBotWorker
+*/
+TBotWorker::~TBotWorker()
+{
+	for (auto & bot : bots)
+	{
+		bot.first->disconnect();
+		delete bot.first;
+	}
+	bots.clear();
+}
+
+void TBotWorker::operator()()
+{
+	while (loadGen->isRunning())
+	{
+		// The stats are only touched by the bots, so hold them for the whole tick.
+		std::lock_guard<std::mutex> lock(statsMutex);
+
+		auto now = std::chrono::steady_clock::now();
+		for (auto & bot : bots)
+		{
+			if (bot.first->getState() == BOTSTATE_WAITING)
+			{
+				if (now >= bot.second)
+					bot.first->connect();
+				continue;
+			}
+
+			bot.first->doTimedEvents(now);
+		}
+
+		sockManager.update(0, 5000);		// 5ms
+	}
+
+	for (auto & bot : bots)
+		bot.first->disconnect();
+}
+
+void TBotWorker::addBot(TBot* bot, std::chrono::steady_clock::time_point connectTime)
+{
+	bots.emplace_back(bot, connectTime);
+}
+
+void TBotWorker::takeStats(SLoadGenStats& pStats)
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	pStats.merge(stats);
+	stats.clear();
+}
+
+/*
+	TLoadGen
+*/
+TLoadGen::~TLoadGen()
+{
+	for (auto & worker : workers)
+		delete worker;
+	workers.clear();
+}
+
+CString TLoadGen::getAccountName(int bot) const
+{
+	return CString() << options.accountPrefix << CString(bot + 1);
+}
+
+void TLoadGen::writeAccounts()
+{
+	if (options.accountsPath.isEmpty())
+		return;
+
+	// New accounts are copies of the server's default account.
+	std::vector<CString> defaultAccount = CString::loadToken(CString() << options.accountsPath << "defaultaccount.txt", "\n", true);
+	if (defaultAccount.empty() || defaultAccount[0] != "GRACC001")
+	{
+		defaultAccount.clear();
+		defaultAccount.push_back("GRACC001");
+	}
+
+	int written = 0;
+	for (int i = 0; i < options.bots; ++i)
+	{
+		CString accountName = getAccountName(i);
+		CString path = CString() << options.accountsPath << accountName << ".txt";
+
+		struct stat fileStat;
+		if (stat(path.text(), &fileStat) != -1)
+			continue;
+
+		CString fileData;
+		fileData << "GRACC001\r\n";
+		fileData << "NAME " << accountName << "\r\n";
+		fileData << "NICK " << accountName << "\r\n";
+		fileData << "COMMUNITYNAME " << accountName << "\r\n";
+		fileData << "LEVEL " << options.startLevel << "\r\n";
+		for (auto & line : defaultAccount)
+		{
+			CString section = line.subString(0, line.find(' '));
+			if (section == "GRACC001" || section == "NAME" || section == "NICK" || section == "COMMUNITYNAME" || section == "LEVEL")
+				continue;
+			fileData << line << "\r\n";
+		}
+
+		if (!fileData.save(path))
+		{
+			loadgenlog.out("** [Error] Could not write account %s\n", path.text());
+			continue;
+		}
+		++written;
+	}
+
+	loadgenlog.out(":: Wrote %d bot accounts to %s\n", written, options.accountsPath.text());
+}
+
+int TLoadGen::run()
+{
+	writeAccounts();
+
+	int threadCount = options.threads;
+	if (threadCount <= 0)
+		threadCount = (options.bots + LOADGEN_BOTSPERTHREAD - 1) / LOADGEN_BOTSPERTHREAD;
+	threadCount = std::max(1, std::min(threadCount, options.bots));
+
+	for (int i = 0; i < threadCount; ++i)
+		workers.push_back(new TBotWorker(this));
+
+	// Bots connect at the given rate.
+	startTime = std::chrono::steady_clock::now();
+	std::mt19937 seeds((unsigned int)time(0));
+	for (int i = 0; i < options.bots; ++i)
+	{
+		TBotWorker* worker = workers[i % threadCount];
+		auto connectTime = startTime + std::chrono::milliseconds(options.rate > 0 ? (long long)i * 1000 / options.rate : 0);
+		worker->addBot(new TBot(worker, getAccountName(i), seeds()), connectTime);
+	}
+
+	loadgenlog.out(":: Starting %d bots on %d threads against %s:%s\n", options.bots, threadCount, options.host.text(), options.port.text());
+	running = true;
+	for (auto & worker : workers)
+		workerThreads.emplace_back(std::ref(*worker));
+
+	auto lastReport = startTime;
+	while (running)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+		auto now = std::chrono::steady_clock::now();
+		bool finished = (options.duration > 0 && now - startTime >= std::chrono::seconds(options.duration));
+		if (finished || now - lastReport >= std::chrono::seconds(options.reportInterval))
+		{
+			SLoadGenStats stats;
+			for (auto & worker : workers)
+				worker->takeStats(stats);
+			totals.online += stats.online;
+
+			report(stats, std::chrono::duration<double>(now - lastReport).count(), false);
+			stats.online = 0;
+			totals.merge(stats);
+			lastReport = now;
+		}
+
+		if (finished)
+			running = false;
+	}
+
+	for (auto & thread : workerThreads)
+		thread.join();
+	workerThreads.clear();
+
+	report(totals, std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count(), true);
+	return (totals.logins == 0 ? 1 : 0);
+}
+
+static CString getLatencyString(std::vector<double>& samples)
+{
+	if (samples.empty())
+		return "-";
+
+	std::sort(samples.begin(), samples.end());
+	auto percentile = [&samples](double p) { return samples[std::min(samples.size() - 1, (size_t)(p * samples.size()))]; };
+
+	char buffer[128];
+	snprintf(buffer, sizeof(buffer), "p50 %.1f p95 %.1f p99 %.1f max %.1f ms (%zu)", percentile(0.50), percentile(0.95), percentile(0.99), samples.back(), samples.size());
+	return buffer;
+}
+
+void TLoadGen::report(SLoadGenStats& stats, double seconds, bool final)
+{
+	if (seconds <= 0.0)
+		seconds = 1.0;
+
+	if (final)
+		loadgenlog.out(":: Totals over %.0f seconds:\n", seconds);
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	loadgenlog.out("[%5.0fs] online %d/%d, %u logins, %u failed, %u dropped | in %.0f packets/s %.1f KB/s | out %.0f packets/s\n",
+		elapsed, totals.online, options.bots, stats.logins, stats.failures, stats.disconnects,
+		(double)stats.packetsIn / seconds, (double)stats.bytesIn / seconds / 1024.0, (double)stats.packetsOut / seconds);
+	loadgenlog.out("          actions: walk %u, chat %u, warp %u, file %u, idle %u\n",
+		stats.actions[BOTACTION_WALK], stats.actions[BOTACTION_CHAT], stats.actions[BOTACTION_WARP], stats.actions[BOTACTION_FILE], stats.actions[BOTACTION_IDLE]);
+	loadgenlog.out("          login %s\n", getLatencyString(stats.latency[BOTLATENCY_LOGIN]).text());
+	loadgenlog.out("          warp  %s\n", getLatencyString(stats.latency[BOTLATENCY_WARP]).text());
+	loadgenlog.out("          file  %s\n", getLatencyString(stats.latency[BOTLATENCY_FILE]).text());
+}
@@ -0,0 +1,194 @@
+#include "IDebug.h"
+#include <signal.h>
+#include <stdlib.h>
+
+#include "IConfig.h"
+#include "CString.h"
+#include "CLog.h"
+#include "CSocket.h"
+#include "TLoadGen.h"
+
+// Linux specific stuff.
+#if !(defined(_WIN32) || defined(_WIN64))
+	#ifndef SIGBREAK
+		#define SIGBREAK SIGQUIT
+	#endif
+#endif
+
+// Function pointer for signal handling.
+typedef void (*sighandler_t)(int);
+
+CLog loadgenlog("loadgenlog.txt");
+static TLoadGen* loadGen = nullptr;
+
+static bool parseArgs(int argc, char* argv[], SLoadGenOptions& options);
+static void printHelp(const char* pname);
+
+static void stopLoadGen(int sig)
+{
+	if (loadGen != nullptr)
+		loadGen->stop();
+}
+
+int main(int argc, char* argv[])
+{
+	SLoadGenOptions options;
+	if (parseArgs(argc, argv, options))
+		return 1;
+
+	signal(SIGINT, (sighandler_t) stopLoadGen);
+	signal(SIGTERM, (sighandler_t) stopLoadGen);
+	signal(SIGBREAK, (sighandler_t) stopLoadGen);
+#if !(defined(_WIN32) || defined(_WIN64))
+	// A server closing on a bot shouldn't take the whole process down.
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	loadgenlog.out("Graal Reborn GServer load generator version %s\n\n", GSERVER_VERSION);
+
+	loadGen = new TLoadGen(options);
+	int ret = loadGen->run();
+	delete loadGen;
+	loadGen = nullptr;
+
+	CSocket::socketSystemDestroy();
+	return ret;
+}
+
+static std::vector<CString> getList(const CString& arg)
+{
+	std::vector<CString> ret = arg.tokenize(",");
+	for (auto & i : ret)
+		i.trimI();
+	return ret;
+}
+
+static bool parseMix(const CString& arg, SLoadGenOptions& options)
+{
+	static const char* const actionNames[BOTACTION_COUNT] = { "walk", "chat", "warp", "file", "idle" };
+
+	for (auto & action : options.mix)
+		action = 0;
+
+	int total = 0;
+	for (auto & entry : getList(arg))
+	{
+		CString name = entry.readString("=").trim();
+		int weight = strtoint(entry.readString(""));
+
+		int action = 0;
+		while (action < BOTACTION_COUNT && name != actionNames[action])
+			++action;
+		if (action == BOTACTION_COUNT || weight < 0)
+			return false;
+
+		options.mix[action] = weight;
+		total += weight;
+	}
+	return total > 0;
+}
+
+static bool parseArgs(int argc, char* argv[], SLoadGenOptions& options)
+{
+	std::vector<CString> args;
+	for (int i = 0; i < argc; ++i)
+		args.push_back(CString(argv[i]));
+
+	for (auto i = args.begin(); i != args.end(); ++i)
+	{
+		if ((*i).find("--") != 0)
+		{
+			if (i == args.begin())
+				continue;
+			printHelp(args[0].text());
+			return true;
+		}
+
+		CString key((*i).subString(2));
+		if (key == "help")
+		{
+			printHelp(args[0].text());
+			return true;
+		}
+
+		// Everything else takes a value.
+		++i;
+		if (i == args.end())
+		{
+			printHelp(args[0].text());
+			return true;
+		}
+
+		CString val = *i;
+		if (key == "host") options.host = val;
+		else if (key == "port") options.port = val;
+		else if (key == "version") options.version = val;
+		else if (key == "prefix") options.accountPrefix = val;
+		else if (key == "accounts")
+		{
+			options.accountsPath = val;
+			if (options.accountsPath[options.accountsPath.length() - 1] != '/' && options.accountsPath[options.accountsPath.length() - 1] != '\\')
+				options.accountsPath << "/";
+		}
+		else if (key == "level") options.startLevel = val;
+		else if (key == "levels") options.levels = getList(val);
+		else if (key == "files") options.files = getList(val);
+		else if (key == "chats") options.chats = val.tokenize("|");
+		else if (key == "bots") options.bots = strtoint(val);
+		else if (key == "rate") options.rate = strtoint(val);
+		else if (key == "duration") options.duration = strtoint(val);
+		else if (key == "interval") options.interval = strtoint(val);
+		else if (key == "report") options.reportInterval = strtoint(val);
+		else if (key == "threads") options.threads = strtoint(val);
+		else if (key == "mix")
+		{
+			if (!parseMix(val, options))
+			{
+				loadgenlog.out("** [Error] Bad --mix.  Use weights like walk=60,chat=10,warp=5,file=5,idle=20\n");
+				return true;
+			}
+		}
+		else
+		{
+			printHelp(args[0].text());
+			return true;
+		}
+	}
+
+	if (options.bots <= 0)
+	{
+		loadgenlog.out("** [Error] --bots has to be at least 1.\n");
+		return true;
+	}
+	if (options.reportInterval <= 0)
+		options.reportInterval = 5;
+
+	return false;
+}
+
+static void printHelp(const char* pname)
+{
+	loadgenlog.out("Graal Reborn GServer load generator version %s\n\n", GSERVER_VERSION);
+	loadgenlog.out("USAGE: %s [options]\n\n", pname);
+	loadgenlog.out("Connection:\n");
+	loadgenlog.out(" --host IP\t\tServer to connect to.  Default: 127.0.0.1\n");
+	loadgenlog.out(" --port PORT\t\tServer port.  Default: 14802\n");
+	loadgenlog.out(" --version VER\t\tClient version string sent at login.  Default: GNW03014\n");
+	loadgenlog.out("\nBots:\n");
+	loadgenlog.out(" --bots N\t\tNumber of bots.  Default: 100\n");
+	loadgenlog.out(" --rate N\t\tBots connected per second.  Default: 50\n");
+	loadgenlog.out(" --duration SECS\tHow long to run, 0 runs until stopped.  Default: 60\n");
+	loadgenlog.out(" --threads N\t\tThreads to run the bots on.  Default: one per 500 bots\n");
+	loadgenlog.out(" --prefix NAME\t\tBot accounts are NAME1, NAME2, ...  Default: loadbot\n");
+	loadgenlog.out(" --accounts DIR\t\tWrite bot accounts that don't exist yet into the server's accounts folder.\n");
+	loadgenlog.out("\nBehavior:\n");
+	loadgenlog.out(" --interval MS\t\tAverage time between bot actions.  Default: 500\n");
+	loadgenlog.out(" --mix WEIGHTS\t\tHow often each action is picked.  Default: walk=60,chat=10,warp=5,file=5,idle=20\n");
+	loadgenlog.out(" --level LEVEL\t\tStart level for new accounts.  Default: onlinestartlocal.nw\n");
+	loadgenlog.out(" --levels A,B,...\tLevels to warp to.  Default: the start level\n");
+	loadgenlog.out(" --files A,B,...\tFiles to request.  Default: the start level\n");
+	loadgenlog.out(" --chats A|B|...\tChat lines to say.\n");
+	loadgenlog.out(" --report SECS\t\tTime between reports.  Default: 5\n");
+	loadgenlog.out("\nThe server needs localaccounts = true in serveroptions.txt so the bots can log in without the serverlist.\n");
+	loadgenlog.out("\n");
+}
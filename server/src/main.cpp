@@ -5,6 +5,8 @@
 #include <signal.h>
 #include <stdlib.h>
 #include <map>
+#include <chrono>
+#include <ctime>
 
 #include "main.h"
 #include "IConfig.h"
@@ -13,6 +15,7 @@
 #include "CLog.h"
 #include "CSocket.h"
 #include "TServer.h"
+#include "TPlayer.h"
 #include <TAccount.h>
 
 // Linux specific stuff.
@@ -37,10 +40,13 @@ CString overrideLocalIp = nullptr;
 CString overrideServerInterface = nullptr;
 CString overrideName = nullptr;
 CString overrideStaff = nullptr;
+bool createSnapshot = false;
+CString replayTrace;
 
 // Home path of the gserver.
 CString homepath;
 static void getBasePath();
+static int runReplay();
 
 std::atomic_bool shutdownProgram{ false };
 
@@ -72,6 +78,33 @@ int main(int argc, char* argv[])
 		serverlog.out("Graal Reborn GServer version %s\n", GSERVER_VERSION);
 		serverlog.out("Programmed by %s.\n\n", GSERVER_CREDITS);
 
+#ifdef V8NPCSERVER
+		// Build the script startup snapshot and exit.
+		if (createSnapshot)
+		{
+			CString serverName = (overrideServer.isEmpty() ? CString("default") : overrideServer);
+			CString serverPath = CString() << homepath << "servers/" << serverName << "/";
+			CFileSystem::fixPathSeparators(&serverPath);
+
+			serverlog.out(":: Creating script snapshot for server: %s... ", serverName.text());
+			if (!CScriptEngine::CreateSnapshot(serverPath.text()))
+			{
+				serverlog.append("FAILED!\n");
+				return ERR_SETTINGS;
+			}
+			serverlog.append("success\n");
+			return ERR_SUCCESS;
+		}
+#endif
+
+		// Replay a packet trace into the server and exit.
+		if (!replayTrace.isEmpty())
+		{
+			int ret = runReplay();
+			CSocket::socketSystemDestroy();
+			return ret;
+		}
+
 		// Load Server Settings
 		if (overrideServer.isEmpty())
 		{
@@ -268,6 +301,15 @@ bool parseArgs(int argc, char* argv[])
 						return true;
 					}
 					overrideName = *i;
+				} else if ( key == "v8-snapshot" ) {
+					createSnapshot = true;
+				} else if ( key == "replay" ) {
+					++i;
+					if ( i == args.end()) {
+						printHelp(args[0].text());
+						return true;
+					}
+					replayTrace = *i;
 				}
 			} else if ((*i)[0] == '-' ) {
 				for ( int j = 1; j < (*i).length(); ++j ) {
@@ -334,10 +376,122 @@ void printHelp(const char* pname)
 	serverlog.out(" --localip IP\tSpecify which IP to retrieve when on the same network as the server.\n");
 	serverlog.out(" --serverip IP\tSpecify which IP that the listserver should deliver to clients.\n");
 	serverlog.out(" --interface IP\tSpecify which IP to bind the server to.\n");
+#ifdef V8NPCSERVER
+	serverlog.out(" --v8-snapshot\tCreate the script startup snapshot for the server given by -s (or default), then exit.\n");
+#endif
+	serverlog.out(" --replay FILE\tFeed a packet trace into the server given by -s (or default) as fast as possible, then exit.\n");
 
 	serverlog.out("\n");
 }
 
+int runReplay()
+{
+	CPacketTrace trace;
+	if (!trace.openRead(replayTrace))
+	{
+		serverlog.out("** [Error] Could not open packet trace %s\n", replayTrace.text());
+		return ERR_SETTINGS;
+	}
+
+	CString serverName = (overrideServer.isEmpty() ? CString("default") : overrideServer);
+	TServer* server = new TServer(serverName);
+	server->setReplay(true);
+
+	serverlog.out(":: Replaying %s into server: %s.\n", replayTrace.text(), serverName.text());
+	if (server->init() != 0)
+	{
+		serverlog.out("** [Error] Failed to start server: %s\n", serverName.text());
+		delete server;
+		return ERR_SETTINGS;
+	}
+
+	// Players keep the ids they had when they were recorded, so packets that name other players still line up.
+	unsigned long long packets = 0, bytes = 0;
+	unsigned int connects = 0, lastTick = 0, traceTime = 0;
+	auto startTimer = std::chrono::high_resolution_clock::now();
+	std::clock_t startClock = std::clock();
+
+	SPacketTraceRecord record;
+	while (!shutdownProgram && trace.read(record))
+	{
+		// Run a server loop for every 5ms of the trace, like the live server would have.
+		traceTime = record.time;
+		if (traceTime - lastTick >= 5)
+		{
+			lastTick = traceTime;
+			server->setReplayTime(traceTime);
+			server->doMain();
+			server->cleanupDeletedPlayers();
+		}
+
+		TPlayer* player = server->getPlayer(record.id);
+		switch (record.type)
+		{
+			case PACKETTRACE_CONNECT:
+			{
+				// The old player with this id may not have been cleaned up yet.
+				if (player != nullptr && player->isReplay())
+				{
+					server->deletePlayer(player);
+					server->cleanupDeletedPlayers();
+				}
+
+				player = new TPlayer(server, nullptr, 0);
+				player->setReplay(record.data);
+				if (!server->addPlayer(player, record.id))
+				{
+					delete player;
+					break;
+				}
+				++connects;
+				break;
+			}
+
+			case PACKETTRACE_PACKET:
+				if (player == nullptr || !player->isReplay())
+					break;
+
+				++packets;
+				bytes += record.data.length();
+				if (!player->replayPacket(record.data))
+					server->deletePlayer(player);
+				break;
+
+			case PACKETTRACE_DISCONNECT:
+				if (player != nullptr && player->isReplay())
+					server->deletePlayer(player);
+				break;
+		}
+	}
+
+	// Let the last of the players log out, and the ones still waiting in the login queue leave.
+	std::vector<TPlayer*> remaining;
+	for (auto & queued : *server->getLoginQueue())
+		remaining.push_back(queued.first);
+	for (auto & player : *server->getPlayerList())
+		remaining.push_back(player);
+
+	for (auto player : remaining)
+	{
+		if (player->isReplay())
+			server->deletePlayer(player);
+	}
+	server->doMain();
+	server->cleanupDeletedPlayers();
+
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTimer).count();
+	double cpuSeconds = (double)(std::clock() - startClock) / CLOCKS_PER_SEC;
+	if (seconds <= 0.0)
+		seconds = 0.001;
+
+	serverlog.out(":: Replayed %u connections and %llu packets (%.1f KB) from %.1f seconds of trace.\n", connects, packets, (double)bytes / 1024.0, (double)traceTime / 1000.0);
+	serverlog.out(":: Sent %.1f KB to the players after compression and encryption.\n", (double)server->getReplayBytesSent() / 1024.0);
+	serverlog.out(":: Took %.2f seconds, %.2f seconds of CPU.  %.0f packets/s, %.1fx real time.\n", seconds, cpuSeconds, (double)packets / seconds, (double)traceTime / 1000.0 / seconds);
+
+	delete server;
+	return ERR_SUCCESS;
+}
+
 const CString getHomePath()
 {
 	return homepath;
@@ -14,8 +14,7 @@
 // PROPERTY: env.global
 void Environment_GetObject_Global(v8::Local<v8::String> prop, const v8::PropertyCallbackInfo<v8::Value>& info)
 {
-	v8::Local<v8::External> data = info.Data().As<v8::External>();
-	CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+	CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(info.GetIsolate());
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 
 	info.GetReturnValue().Set(env->Global());
@@ -58,8 +57,7 @@ void Environment_SetCallBack(const v8::FunctionCallbackInfo<v8::Value>& args)
 				*v8::String::Utf8Value(isolate, args[0]->ToString(isolate)),
 				*v8::String::Utf8Value(isolate, args[1]->ToString(isolate)));
 
-		v8::Local<v8::External> data = args.Data().As<v8::External>();
-		CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+		CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(args.GetIsolate());
 		V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 
 		// Callback name
@@ -106,9 +104,6 @@ void bindClass_Environment(CScriptEngine *scriptEngine)
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 	v8::Isolate *isolate = env->Isolate();
 
-	// External pointer
-	v8::Local<v8::External> engine_ref = v8::External::New(isolate, scriptEngine);
-
 	// Create V8 string for "Environment"
 	v8::Local<v8::String> envStr = v8::String::NewFromUtf8(isolate, "Environment", v8::NewStringType::kInternalized).ToLocalChecked();
 
@@ -119,15 +114,24 @@ void bindClass_Environment(CScriptEngine *scriptEngine)
 	environment_ctor->InstanceTemplate()->SetInternalFieldCount(1);
 
 	// Properties
-	environment_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "global"), Environment_GetObject_Global, nullptr, engine_ref);
+	environment_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "global"), Environment_GetObject_Global);
 
 	// Method functions
-	environment_proto->Set(v8::String::NewFromUtf8(isolate, "reportException"), v8::FunctionTemplate::New(isolate, Environment_ReportException, engine_ref));
-	environment_proto->Set(v8::String::NewFromUtf8(isolate, "setCallBack"), v8::FunctionTemplate::New(isolate, Environment_SetCallBack, engine_ref));
-	environment_proto->Set(v8::String::NewFromUtf8(isolate, "setNpcEvents"), v8::FunctionTemplate::New(isolate, Environment_SetNpcEvents, engine_ref));
+	environment_proto->Set(v8::String::NewFromUtf8(isolate, "reportException"), v8::FunctionTemplate::New(isolate, Environment_ReportException));
+	environment_proto->Set(v8::String::NewFromUtf8(isolate, "setCallBack"), v8::FunctionTemplate::New(isolate, Environment_SetCallBack));
+	environment_proto->Set(v8::String::NewFromUtf8(isolate, "setNpcEvents"), v8::FunctionTemplate::New(isolate, Environment_SetNpcEvents));
 
 	// Persist the constructor
 	env->SetConstructor("environment", environment_ctor);
 }
 
+// Callbacks bound above, v8 needs their addresses to serialize the bindings into a snapshot
+void externalRefs_Environment(std::vector<intptr_t>& refs)
+{
+	refs.push_back(reinterpret_cast<intptr_t>(Environment_ReportException));
+	refs.push_back(reinterpret_cast<intptr_t>(Environment_SetCallBack));
+	refs.push_back(reinterpret_cast<intptr_t>(Environment_SetNpcEvents));
+	refs.push_back(reinterpret_cast<intptr_t>(Environment_GetObject_Global));
+}
+
 #endif
@@ -30,8 +30,7 @@ void Global_Function_Print(const v8::FunctionCallbackInfo<v8::Value>& args)
 // PROPERTY: server object
 void Global_GetObject_Server(v8::Local<v8::String> prop, const v8::PropertyCallbackInfo<v8::Value>& info)
 {
-    v8::Local<v8::External> data = info.Data().As<v8::External>();
-    CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+    CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(info.GetIsolate());
 
     V8ScriptWrapped<TServer> *v8_serverObject = static_cast<V8ScriptWrapped<TServer> *>(scriptEngine->getServerObject());
     info.GetReturnValue().Set(v8_serverObject->Handle(info.GetIsolate()));
@@ -43,18 +42,22 @@ void bindGlobalFunctions(CScriptEngine *scriptEngine)
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 	v8::Isolate *isolate = env->Isolate();
 
-	// External pointer
-	v8::Local<v8::External> engine_ref = v8::External::New(isolate, scriptEngine);
-	
 	// Fetch global template
 	v8::Local<v8::ObjectTemplate> global = env->GlobalTemplate();
 
 	// Global functions
 	global->Set(v8::String::NewFromUtf8(isolate, "print"), v8::FunctionTemplate::New(isolate, Global_Function_Print));
-	//global->Set(v8::String::NewFromUtf8(isolate, "testFunc"), v8::FunctionTemplate::New(isolate, Ext_TestFunc, engine_ref));
+	//global->Set(v8::String::NewFromUtf8(isolate, "testFunc"), v8::FunctionTemplate::New(isolate, Ext_TestFunc));
 
 	// Global properties
-	global->SetAccessor(v8::String::NewFromUtf8(isolate, "server"), Global_GetObject_Server, nullptr, engine_ref);
+	global->SetAccessor(v8::String::NewFromUtf8(isolate, "server"), Global_GetObject_Server);
+}
+
+// Callbacks bound above, v8 needs their addresses to serialize the bindings into a snapshot
+void externalRefs_GlobalFunctions(std::vector<intptr_t>& refs)
+{
+	refs.push_back(reinterpret_cast<intptr_t>(Global_Function_Print));
+	refs.push_back(reinterpret_cast<intptr_t>(Global_GetObject_Server));
 }
 
 #endif
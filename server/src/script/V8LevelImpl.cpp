@@ -135,12 +135,14 @@ void Level_Function_FindNearestPlayers(const v8::FunctionCallbackInfo<v8::Value>
 		// Get distance for each player in the level, and sort it
 		std::vector<TPlayer *> *playerList = levelObject->getPlayerList();
 		std::vector<std::pair<double, TPlayer *>> playerListSorted;
+		playerListSorted.reserve(playerList->size());
 
+		// Sort on the squared distance, the root is only needed for the result
 		for (auto it = playerList->begin(); it != playerList->end(); ++it)
 		{
 			TPlayer *pl = *it;
-			double distance = sqrt(pow(pl->getY() - targetY, 2) + pow(pl->getX() - targetX, 2));
-			playerListSorted.push_back({ distance, pl });
+			double dx = pl->getX() - targetX, dy = pl->getY() - targetY;
+			playerListSorted.push_back({ dx * dx + dy * dy, pl });
 		}
 
 		std::sort(playerListSorted.begin(), playerListSorted.end());
@@ -156,7 +158,7 @@ void Level_Function_FindNearestPlayers(const v8::FunctionCallbackInfo<v8::Value>
 			V8ScriptWrapped<TPlayer> *v8_wrapped = static_cast<V8ScriptWrapped<TPlayer> *>((*it).second->getScriptObject());
 
 			v8::Local<v8::Object> object = v8::Object::New(isolate);
-			object->Set(key_distance, v8::Number::New(isolate, (*it).first));
+			object->Set(key_distance, v8::Number::New(isolate, sqrt((*it).first)));
 			object->Set(key_player, v8_wrapped->Handle(isolate));
 			result->Set(context, idx++, object).Check();
 		}
@@ -238,9 +240,6 @@ void bindClass_Level(CScriptEngine *scriptEngine)
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 	v8::Isolate *isolate = env->Isolate();
 
-	// External pointer
-	v8::Local<v8::External> engine_ref = v8::External::New(isolate, scriptEngine);
-
 	// Create V8 string for "level"
 	v8::Local<v8::String> levelStr = v8::String::NewFromUtf8(isolate, "level", v8::NewStringType::kInternalized).ToLocalChecked();
 
@@ -251,12 +250,12 @@ void bindClass_Level(CScriptEngine *scriptEngine)
 	level_ctor->InstanceTemplate()->SetInternalFieldCount(1);
 
 	// Method functions
-//	level_proto->Set(v8::String::NewFromUtf8(isolate, "clone"), v8::FunctionTemplate::New(isolate, Level_Function_Clone, engine_ref));
-	level_proto->Set(v8::String::NewFromUtf8(isolate, "findareanpcs"), v8::FunctionTemplate::New(isolate, Level_Function_FindAreaNpcs, engine_ref));
-	level_proto->Set(v8::String::NewFromUtf8(isolate, "findnearestplayers"), v8::FunctionTemplate::New(isolate, Level_Function_FindNearestPlayers, engine_ref));
-//	level_proto->Set(v8::String::NewFromUtf8(isolate, "reload"), v8::FunctionTemplate::New(isolate, Level_Function_Reload, engine_ref));
-	level_proto->Set(v8::String::NewFromUtf8(isolate, "putnpc"), v8::FunctionTemplate::New(isolate, Level_Function_PutNPC, engine_ref));
-	level_proto->Set(v8::String::NewFromUtf8(isolate, "onwall"), v8::FunctionTemplate::New(isolate, Level_Function_OnWall, engine_ref));
+//	level_proto->Set(v8::String::NewFromUtf8(isolate, "clone"), v8::FunctionTemplate::New(isolate, Level_Function_Clone));
+	level_proto->Set(v8::String::NewFromUtf8(isolate, "findareanpcs"), v8::FunctionTemplate::New(isolate, Level_Function_FindAreaNpcs));
+	level_proto->Set(v8::String::NewFromUtf8(isolate, "findnearestplayers"), v8::FunctionTemplate::New(isolate, Level_Function_FindNearestPlayers));
+//	level_proto->Set(v8::String::NewFromUtf8(isolate, "reload"), v8::FunctionTemplate::New(isolate, Level_Function_Reload));
+	level_proto->Set(v8::String::NewFromUtf8(isolate, "putnpc"), v8::FunctionTemplate::New(isolate, Level_Function_PutNPC));
+	level_proto->Set(v8::String::NewFromUtf8(isolate, "onwall"), v8::FunctionTemplate::New(isolate, Level_Function_OnWall));
 
 	// Properties
 //	level_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "isnopkzone"), Level_GetBool_IsNoPkZone);		// TODO(joey): must be missing a status flag or something
@@ -270,4 +269,17 @@ void bindClass_Level(CScriptEngine *scriptEngine)
 	env->SetConstructor(ScriptConstructorId<TLevel>::result, level_ctor);
 }
 
+// Callbacks bound above, v8 needs their addresses to serialize the bindings into a snapshot
+void externalRefs_Level(std::vector<intptr_t>& refs)
+{
+	refs.push_back(reinterpret_cast<intptr_t>(Level_Function_FindAreaNpcs));
+	refs.push_back(reinterpret_cast<intptr_t>(Level_Function_FindNearestPlayers));
+	refs.push_back(reinterpret_cast<intptr_t>(Level_Function_PutNPC));
+	refs.push_back(reinterpret_cast<intptr_t>(Level_Function_OnWall));
+	refs.push_back(reinterpret_cast<intptr_t>(Level_GetBool_IsSparringZone));
+	refs.push_back(reinterpret_cast<intptr_t>(Level_GetStr_Name));
+	refs.push_back(reinterpret_cast<intptr_t>(Level_GetArray_Npcs));
+	refs.push_back(reinterpret_cast<intptr_t>(Level_GetArray_Players));
+}
+
 #endif
@@ -805,8 +805,7 @@ void NPC_Function_RegisterTrigger(const v8::FunctionCallbackInfo<v8::Value>& arg
 			*v8::String::Utf8Value(isolate, args[0]->ToString(isolate->GetCurrentContext()).ToLocalChecked()),
 			*v8::String::Utf8Value(isolate, args[1]->ToString(isolate->GetCurrentContext()).ToLocalChecked()));
 
-		v8::Local<v8::External> data = args.Data().As<v8::External>();
-		CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+		CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(args.GetIsolate());
 
 		V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 
@@ -845,8 +844,7 @@ void NPC_Function_ScheduleEvent(const v8::FunctionCallbackInfo<v8::Value>& args)
 
 		v8::Local<v8::Context> context = isolate->GetCurrentContext();
 
-		v8::Local<v8::External> data = args.Data().As<v8::External>();
-		CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+		CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(args.GetIsolate());
 
 		V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 
@@ -869,10 +867,9 @@ void NPC_Function_ScheduleEvent(const v8::FunctionCallbackInfo<v8::Value>& args)
 		else
 			v8args = ScriptFactory::CreateArguments(env, npcObject->getScriptObject());
 
-		ScriptAction *action = new ScriptAction(cbFuncWrapper, v8args, "_scheduleevent");
+		ScriptAction *action = new ScriptAction(cbFuncWrapper, v8args, ScriptActionName::ScheduleEvent);
 
 		npcObject->scheduleEvent(timer_frames, action);
-		scriptEngine->RegisterNpcTimer(npcObject);
 	}
 
 	SCRIPTENV_D("End NPC::registerAction()\n");
@@ -888,8 +885,7 @@ void NPC_Function_Join(const v8::FunctionCallbackInfo<v8::Value>& args)
 	if (args[0]->IsString())
 	{
 		v8::Local<v8::Context> context = isolate->GetCurrentContext();
-		v8::Local<v8::External> data = args.Data().As<v8::External>();
-		CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+		CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(args.GetIsolate());
 
 		std::string className = *v8::String::Utf8Value(isolate, args[0]->ToString(context).ToLocalChecked());
 
@@ -907,12 +903,8 @@ void NPC_Function_Join(const v8::FunctionCallbackInfo<v8::Value>& args)
 			// Add class to npc
 			npcObject->addClassCode(className, clientCode);
 
-			// Wrap code
-			std::string classCodeWrap = CScriptEngine::WrapScript<TNPC>(serverCode);
-
-			// TODO(joey): maybe we shouldn't cache this using this method, since classes can be used with
-			// multiple wrappers.
-			IScriptFunction *function = scriptEngine->CompileCache(classCodeWrap, false);
+			// The class is cached by the hash of the whole class, so it is only wrapped and compiled once.
+			IScriptFunction *function = scriptEngine->CompileCache<TNPC>(serverCode.c_str(), server->getClassHash(className), false);
 			if (function == nullptr)
 				return;
 
@@ -947,8 +939,7 @@ void NPC_Function_SetPM(const v8::FunctionCallbackInfo<v8::Value>& args)
 	if (npcObject->getName() != "Control-NPC")
 		return;
 
-	v8::Local<v8::External> data = args.Data().As<v8::External>();
-	CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+	CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(args.GetIsolate());
 
 	if (args[0]->IsFunction())
 	{
@@ -987,8 +978,7 @@ void NPC_Function_Warpto(const v8::FunctionCallbackInfo<v8::Value>& args)
 			double newX = args[1]->NumberValue(context).ToChecked();
 			double newY = args[2]->NumberValue(context).ToChecked();
 
-			v8::Local<v8::External> data = args.Data().As<v8::External>();
-			CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+			CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(args.GetIsolate());
 			TServer *server = scriptEngine->getServer();
 
 			TLevel *level = server->getLevel(*levelName);
@@ -1074,8 +1064,7 @@ void NPC_GetObject_Attrs(v8::Local<v8::String> prop, const v8::PropertyCallbackI
 	V8ENV_SAFE_UNWRAP(info, TNPC, npcObject);
 
 	// Grab external data
-	v8::Local<v8::External> data = info.Data().As<v8::External>();
-	CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+	CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(info.GetIsolate());
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 
 	// Find constructor
@@ -1156,8 +1145,7 @@ void NPC_GetObject_Colors(v8::Local<v8::String> prop, const v8::PropertyCallback
 	V8ENV_SAFE_UNWRAP(info, TNPC, npcObject);
 
 	// Grab external data
-	v8::Local<v8::External> data = info.Data().As<v8::External>();
-	CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+	CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(info.GetIsolate());
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 
 	// Find constructor
@@ -1238,8 +1226,7 @@ void NPC_GetObject_Flags(v8::Local<v8::String> prop, const v8::PropertyCallbackI
 	V8ENV_SAFE_UNWRAP(info, TNPC, npcObject);
 
 	// Grab external data
-	v8::Local<v8::External> data = info.Data().As<v8::External>();
-	CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+	CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(info.GetIsolate());
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 
 	// Find constructor
@@ -1329,8 +1316,7 @@ void NPC_GetObject_Save(v8::Local<v8::String> prop, const v8::PropertyCallbackIn
 	V8ENV_SAFE_UNWRAP(info, TNPC, npcObject);
 
 	// Grab external data
-	v8::Local<v8::External> data = info.Data().As<v8::External>();
-	CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+	CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(info.GetIsolate());
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 
 	// Find constructor
@@ -1386,47 +1372,45 @@ void bindClass_NPC(CScriptEngine *scriptEngine)
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 	v8::Isolate *isolate = env->Isolate();
 	
-	// External pointer
-	v8::Local<v8::External> engine_ref = v8::External::New(isolate, scriptEngine);
 
 	// Create V8 string for "npc"
 	v8::Local<v8::String> npcStr = v8::String::NewFromUtf8(isolate, "npc", v8::NewStringType::kInternalized).ToLocalChecked();
 	
 	// Create constructor for class
-	v8::Local<v8::FunctionTemplate> npc_ctor = v8::FunctionTemplate::New(isolate, nullptr, engine_ref);
+	v8::Local<v8::FunctionTemplate> npc_ctor = v8::FunctionTemplate::New(isolate);
 	v8::Local<v8::ObjectTemplate> npc_proto = npc_ctor->PrototypeTemplate();
 	
 	npc_ctor->SetClassName(npcStr);
 	npc_ctor->InstanceTemplate()->SetInternalFieldCount(1);
 	
 	// Static functions on the npc object
-	//npc_ctor->Set(v8::String::NewFromUtf8(isolate, "create"), v8::FunctionTemplate::New(isolate, Npc_createFunction, engine_ref));
+	//npc_ctor->Set(v8::String::NewFromUtf8(isolate, "create"), v8::FunctionTemplate::New(isolate, Npc_createFunction));
 	
 	// Method functions
 	// TODO(joey): Implement these functions
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "blockagain"), v8::FunctionTemplate::New(isolate, NPC_Function_BlockAgain, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "canwarp"), v8::FunctionTemplate::New(isolate, NPC_Function_CanWarp, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "cannotwarp"), v8::FunctionTemplate::New(isolate, NPC_Function_CannotWarp, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "destroy"), v8::FunctionTemplate::New(isolate, NPC_Function_Destroy, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "dontblock"), v8::FunctionTemplate::New(isolate, NPC_Function_DontBlock, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "drawoverplayer"), v8::FunctionTemplate::New(isolate, NPC_Function_DrawOverPlayer, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "drawunderplayer"), v8::FunctionTemplate::New(isolate, NPC_Function_DrawUnderPlayer, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "hide"), v8::FunctionTemplate::New(isolate, NPC_Function_Hide, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "message"), v8::FunctionTemplate::New(isolate, NPC_Function_Message, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "move"), v8::FunctionTemplate::New(isolate, NPC_Function_Move, engine_ref));
-//	npc_proto->Set(v8::String::NewFromUtf8(isolate, "noplayeronwall"), v8::FunctionTemplate::New(isolate, NPC_Function_NoPlayerOnWall, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "setimg"), v8::FunctionTemplate::New(isolate, NPC_Function_SetImg, engine_ref)); // setimg(filename);
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "setimgpart"), v8::FunctionTemplate::New(isolate, NPC_Function_SetImgPart, engine_ref)); // setimgpart(filename,offsetx,offsety,width,height);
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "showcharacter"), v8::FunctionTemplate::New(isolate, NPC_Function_ShowCharacter, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "setcharprop"), v8::FunctionTemplate::New(isolate, NPC_Function_SetCharProp, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "setshape"), v8::FunctionTemplate::New(isolate, NPC_Function_SetShape, engine_ref)); // setshape(1, pixelWidth, pixelHeight)
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "show"), v8::FunctionTemplate::New(isolate, NPC_Function_Show, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "warpto"), v8::FunctionTemplate::New(isolate, NPC_Function_Warpto, engine_ref)); // warpto levelname,x,y;
-
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "join"), v8::FunctionTemplate::New(isolate, NPC_Function_Join, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "registerTrigger"), v8::FunctionTemplate::New(isolate, NPC_Function_RegisterTrigger, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "setpm"), v8::FunctionTemplate::New(isolate, NPC_Function_SetPM, engine_ref));
-	npc_proto->Set(v8::String::NewFromUtf8(isolate, "scheduleevent"), v8::FunctionTemplate::New(isolate, NPC_Function_ScheduleEvent, engine_ref));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "blockagain"), v8::FunctionTemplate::New(isolate, NPC_Function_BlockAgain));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "canwarp"), v8::FunctionTemplate::New(isolate, NPC_Function_CanWarp));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "cannotwarp"), v8::FunctionTemplate::New(isolate, NPC_Function_CannotWarp));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "destroy"), v8::FunctionTemplate::New(isolate, NPC_Function_Destroy));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "dontblock"), v8::FunctionTemplate::New(isolate, NPC_Function_DontBlock));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "drawoverplayer"), v8::FunctionTemplate::New(isolate, NPC_Function_DrawOverPlayer));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "drawunderplayer"), v8::FunctionTemplate::New(isolate, NPC_Function_DrawUnderPlayer));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "hide"), v8::FunctionTemplate::New(isolate, NPC_Function_Hide));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "message"), v8::FunctionTemplate::New(isolate, NPC_Function_Message));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "move"), v8::FunctionTemplate::New(isolate, NPC_Function_Move));
+//	npc_proto->Set(v8::String::NewFromUtf8(isolate, "noplayeronwall"), v8::FunctionTemplate::New(isolate, NPC_Function_NoPlayerOnWall));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "setimg"), v8::FunctionTemplate::New(isolate, NPC_Function_SetImg)); // setimg(filename);
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "setimgpart"), v8::FunctionTemplate::New(isolate, NPC_Function_SetImgPart)); // setimgpart(filename,offsetx,offsety,width,height);
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "showcharacter"), v8::FunctionTemplate::New(isolate, NPC_Function_ShowCharacter));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "setcharprop"), v8::FunctionTemplate::New(isolate, NPC_Function_SetCharProp));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "setshape"), v8::FunctionTemplate::New(isolate, NPC_Function_SetShape)); // setshape(1, pixelWidth, pixelHeight)
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "show"), v8::FunctionTemplate::New(isolate, NPC_Function_Show));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "warpto"), v8::FunctionTemplate::New(isolate, NPC_Function_Warpto)); // warpto levelname,x,y;
+
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "join"), v8::FunctionTemplate::New(isolate, NPC_Function_Join));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "registerTrigger"), v8::FunctionTemplate::New(isolate, NPC_Function_RegisterTrigger));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "setpm"), v8::FunctionTemplate::New(isolate, NPC_Function_SetPM));
+	npc_proto->Set(v8::String::NewFromUtf8(isolate, "scheduleevent"), v8::FunctionTemplate::New(isolate, NPC_Function_ScheduleEvent));
 
 	// Properties
 	npc_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "ani"), NPC_GetStr_Ani, NPC_SetStr_Ani);
@@ -1456,10 +1440,10 @@ void bindClass_NPC(CScriptEngine *scriptEngine)
 	npc_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "y"), NPC_GetNum_Y, NPC_SetNum_Y);
 
 	//npc_ctor->InstanceTemplate()->SetLazyDataProperty(v8::String::NewFromUtf8(isolate, "attr"), NPC_GetObject_Attrs2, v8::Local<v8::Value>(), static_cast<v8::PropertyAttribute>(v8::PropertyAttribute::ReadOnly | v8::PropertyAttribute::DontDelete));
-	npc_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "attr"), NPC_GetObject_Attrs, nullptr, engine_ref);
-	npc_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "colors"), NPC_GetObject_Colors, nullptr, engine_ref);
-	npc_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "flags"), NPC_GetObject_Flags, nullptr, engine_ref);
-	npc_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "save"), NPC_GetObject_Save, nullptr, engine_ref);
+	npc_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "attr"), NPC_GetObject_Attrs);
+	npc_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "colors"), NPC_GetObject_Colors);
+	npc_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "flags"), NPC_GetObject_Flags);
+	npc_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "save"), NPC_GetObject_Save);
 
 	// Create the npc-attributes flags template
 	v8::Local<v8::FunctionTemplate> npc_attrs_ctor = v8::FunctionTemplate::New(isolate);
@@ -1506,5 +1490,88 @@ void bindClass_NPC(CScriptEngine *scriptEngine)
 	//global->Set(npcStr, npc_ctor);
 }
 
+// Callbacks bound above, v8 needs their addresses to serialize the bindings into a snapshot
+void externalRefs_NPC(std::vector<intptr_t>& refs)
+{
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_BlockAgain));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_CanWarp));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_CannotWarp));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_Destroy));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_DontBlock));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_DrawOverPlayer));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_DrawUnderPlayer));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_Hide));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_Message));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_Move));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_SetImg));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_SetImgPart));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_ShowCharacter));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_SetCharProp));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_SetShape));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_Show));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_Warpto));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_Join));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_RegisterTrigger));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_SetPM));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Function_ScheduleEvent));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetStr_Ani));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetStr_Ani));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetInt_Alignment));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetInt_Alignment));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetStr_BodyImage));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetStr_BodyImage));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetInt_Bombs));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetInt_Bombs));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetStr_Message));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetStr_Message));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetInt_Darts));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetInt_Darts));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetInt_Dir));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetInt_Dir));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetInt_GlovePower));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetInt_GlovePower));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetStr_HeadImage));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetStr_HeadImage));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetInt_Hearts));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetInt_Hearts));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetInt_Height));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetStr_HorseImage));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetStr_HorseImage));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetInt_Id));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetStr_Image));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetStr_Image));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetObject_Level));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetStr_LevelName));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetStr_Name));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetStr_Nickname));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetStr_Nickname));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetInt_Rupees));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetInt_Rupees));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetStr_ShieldImage));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetStr_ShieldImage));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetStr_SwordImage));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetStr_SwordImage));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetNum_Timeout));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetNum_Timeout));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetInt_Width));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetNum_X));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetNum_X));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetNum_Y));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_SetNum_Y));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetObject_Attrs));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetObject_Colors));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetObject_Flags));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_GetObject_Save));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Attrs_Getter));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Attrs_Setter));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Colors_Getter));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Colors_Setter));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Flags_Getter));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Flags_Setter));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Flags_Enumerator));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Save_Getter));
+	refs.push_back(reinterpret_cast<intptr_t>(NPC_Save_Setter));
+}
+
 #endif
 
@@ -554,8 +554,7 @@ void Player_GetObject_Colors(v8::Local<v8::String> prop, const v8::PropertyCallb
 	V8ENV_SAFE_UNWRAP(info, TPlayer, playerObject);
 
 	// Grab external data
-	v8::Local<v8::External> data = info.Data().As<v8::External>();
-	CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+	CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(info.GetIsolate());
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 
 	// Find constructor
@@ -640,8 +639,7 @@ void Player_GetObject_Flags(v8::Local<v8::String> prop, const v8::PropertyCallba
 	V8ENV_SAFE_UNWRAP(info, TPlayer, playerObject);
 
 	// Grab external data
-	v8::Local<v8::External> data = info.Data().As<v8::External>();
-	CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+	CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(info.GetIsolate());
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 
 	// Find constructor
@@ -865,8 +863,7 @@ void Player_Function_SendPM(const v8::FunctionCallbackInfo<v8::Value>& args)
 		// TODO(joey): Function this like TServer::sendPM(fromPlayer, toPlayer, message);
 
 		// Get server
-		v8::Local<v8::External> data = args.Data().As<v8::External>();
-		CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+		CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(args.GetIsolate());
 		TServer *server = scriptEngine->getServer();
 
 		// Get npc-server
@@ -980,8 +977,7 @@ void Player_Function_Join(const v8::FunctionCallbackInfo<v8::Value>& args)
 	if (args[0]->IsString())
 	{
 		v8::Local<v8::Context> context = isolate->GetCurrentContext();
-		v8::Local<v8::External> data = args.Data().As<v8::External>();
-		CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+		CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(args.GetIsolate());
 
 		std::string className = *v8::String::Utf8Value(isolate, args[0]->ToString(context).ToLocalChecked());
 
@@ -990,12 +986,8 @@ void Player_Function_Join(const v8::FunctionCallbackInfo<v8::Value>& args)
 
 		if (!classCode.empty())
 		{
-			// Wrap code
-			std::string classCodeWrap = CScriptEngine::WrapScript<TPlayer>(classCode);
-
-			// TODO(joey): maybe we shouldn't cache this using this method, since classes can be used with
-			// multiple wrappers.
-			IScriptFunction *function = scriptEngine->CompileCache(classCodeWrap, false);
+			// The class is cached by its hash, so it is only wrapped and compiled once.
+			IScriptFunction *function = scriptEngine->CompileCache<TPlayer>(classCode.c_str(), server->getClassHash(className), false);
 			V8ScriptFunction *v8_function = static_cast<V8ScriptFunction *>(function);
 			v8::Local<v8::Value> newArgs[] = { args.This() };
 
@@ -1045,14 +1037,11 @@ void bindClass_Player(CScriptEngine *scriptEngine)
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 	v8::Isolate *isolate = env->Isolate();
 
-	// External pointer
-	v8::Local<v8::External> engine_ref = v8::External::New(isolate, scriptEngine);
-
 	// Create V8 string for "player"
 	v8::Local<v8::String> className = v8::String::NewFromUtf8(isolate, "player", v8::NewStringType::kInternalized).ToLocalChecked();
 	
 	// Create constructor for class
-	v8::Local<v8::FunctionTemplate> player_ctor = v8::FunctionTemplate::New(isolate, nullptr, engine_ref); // , Player_Constructor);
+	v8::Local<v8::FunctionTemplate> player_ctor = v8::FunctionTemplate::New(isolate); // , Player_Constructor);
 	v8::Local<v8::ObjectTemplate> player_proto = player_ctor->PrototypeTemplate();
 
     player_ctor->SetClassName(className);
@@ -1065,17 +1054,17 @@ void bindClass_Player(CScriptEngine *scriptEngine)
 	player_proto->Set(v8::String::NewFromUtf8(isolate, "enableweapons"), v8::FunctionTemplate::New(isolate, Player_Function_EnableWeapons));
 	player_proto->Set(v8::String::NewFromUtf8(isolate, "hasweapon"), v8::FunctionTemplate::New(isolate, Player_Function_HasWeapon));
 	player_proto->Set(v8::String::NewFromUtf8(isolate, "removeweapon"), v8::FunctionTemplate::New(isolate, Player_Function_RemoveWeapon));
-	player_proto->Set(v8::String::NewFromUtf8(isolate, "say"), v8::FunctionTemplate::New(isolate, Player_Function_Say, engine_ref));
-	player_proto->Set(v8::String::NewFromUtf8(isolate, "sendpm"), v8::FunctionTemplate::New(isolate, Player_Function_SendPM, engine_ref));
-	player_proto->Set(v8::String::NewFromUtf8(isolate, "sendrpgmessage"), v8::FunctionTemplate::New(isolate, Player_Function_SendRPGMessage, engine_ref));
-	//player_proto->Set(v8::String::NewFromUtf8(isolate, "setani"), v8::FunctionTemplate::New(isolate, Player_Function_SetAni, engine_ref));
-	//player_proto->Set(v8::String::NewFromUtf8(isolate, "setgender"), v8::FunctionTemplate::New(isolate, Player_Function_SetGender, engine_ref));
-	player_proto->Set(v8::String::NewFromUtf8(isolate, "setlevel2"), v8::FunctionTemplate::New(isolate, Player_Function_SetLevel2, engine_ref));
-	//player_proto->Set(v8::String::NewFromUtf8(isolate, "setplayerprop"), v8::FunctionTemplate::New(isolate, Player_Function_SetPlayerProp, engine_ref));
-	player_proto->Set(v8::String::NewFromUtf8(isolate, "attachnpc"), v8::FunctionTemplate::New(isolate, Player_Function_AttachNpc, engine_ref));
-	player_proto->Set(v8::String::NewFromUtf8(isolate, "detachnpc"), v8::FunctionTemplate::New(isolate, Player_Function_DetachNpc, engine_ref));
-	player_proto->Set(v8::String::NewFromUtf8(isolate, "join"), v8::FunctionTemplate::New(isolate, Player_Function_Join, engine_ref));
-	player_proto->Set(v8::String::NewFromUtf8(isolate, "triggeraction"), v8::FunctionTemplate::New(isolate, Player_Function_TriggerAction, engine_ref));
+	player_proto->Set(v8::String::NewFromUtf8(isolate, "say"), v8::FunctionTemplate::New(isolate, Player_Function_Say));
+	player_proto->Set(v8::String::NewFromUtf8(isolate, "sendpm"), v8::FunctionTemplate::New(isolate, Player_Function_SendPM));
+	player_proto->Set(v8::String::NewFromUtf8(isolate, "sendrpgmessage"), v8::FunctionTemplate::New(isolate, Player_Function_SendRPGMessage));
+	//player_proto->Set(v8::String::NewFromUtf8(isolate, "setani"), v8::FunctionTemplate::New(isolate, Player_Function_SetAni));
+	//player_proto->Set(v8::String::NewFromUtf8(isolate, "setgender"), v8::FunctionTemplate::New(isolate, Player_Function_SetGender));
+	player_proto->Set(v8::String::NewFromUtf8(isolate, "setlevel2"), v8::FunctionTemplate::New(isolate, Player_Function_SetLevel2));
+	//player_proto->Set(v8::String::NewFromUtf8(isolate, "setplayerprop"), v8::FunctionTemplate::New(isolate, Player_Function_SetPlayerProp));
+	player_proto->Set(v8::String::NewFromUtf8(isolate, "attachnpc"), v8::FunctionTemplate::New(isolate, Player_Function_AttachNpc));
+	player_proto->Set(v8::String::NewFromUtf8(isolate, "detachnpc"), v8::FunctionTemplate::New(isolate, Player_Function_DetachNpc));
+	player_proto->Set(v8::String::NewFromUtf8(isolate, "join"), v8::FunctionTemplate::New(isolate, Player_Function_Join));
+	player_proto->Set(v8::String::NewFromUtf8(isolate, "triggeraction"), v8::FunctionTemplate::New(isolate, Player_Function_TriggerAction));
 
 	// Properties
     player_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "id"), Player_GetInt_Id);
@@ -1106,8 +1095,8 @@ void bindClass_Player(CScriptEngine *scriptEngine)
 	player_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "swordpower"), Player_GetInt_SwordPower, Player_SetInt_SwordPower);
     player_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "x"), Player_GetNum_X, Player_SetNum_X);
     player_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "y"), Player_GetNum_Y, Player_SetNum_Y);
-	player_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "colors"), Player_GetObject_Colors, nullptr, engine_ref);
-    player_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "flags"), Player_GetObject_Flags, nullptr, engine_ref);
+	player_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "colors"), Player_GetObject_Colors);
+    player_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "flags"), Player_GetObject_Flags);
 	player_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "weapons"), Player_GetArray_Weapons);
 
 	// Create the player colors template
@@ -1136,4 +1125,79 @@ void bindClass_Player(CScriptEngine *scriptEngine)
 	//global->Set(className, player_ctor);
 }
 
+// Callbacks bound above, v8 needs their addresses to serialize the bindings into a snapshot
+void externalRefs_Player(std::vector<intptr_t>& refs)
+{
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Function_AddWeapon));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Function_DisableWeapons));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Function_EnableWeapons));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Function_HasWeapon));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Function_RemoveWeapon));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Function_Say));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Function_SendPM));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Function_SendRPGMessage));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Function_SetLevel2));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Function_AttachNpc));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Function_DetachNpc));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Function_Join));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Function_TriggerAction));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetInt_Id));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetStr_Account));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetStr_Ani));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetStr_Ani));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetInt_Alignment));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetInt_Alignment));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetStr_BodyImage));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetStr_BodyImage));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetInt_Bombs));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetInt_Bombs));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetStr_Chat));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetStr_Chat));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetInt_Darts));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetInt_Darts));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetInt_Dir));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetInt_Dir));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetNum_Hearts));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetNum_Hearts));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetStr_HeadImage));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetStr_HeadImage));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetInt_Fullhearts));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetInt_Fullhearts));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetInt_GlovePower));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetInt_GlovePower));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetStr_Guild));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetStr_Guild));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetBool_IsAdmin));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetBool_IsClient));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetObject_Level));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetStr_LevelName));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetInt_MagicPower));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetInt_MagicPower));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetStr_Nickname));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetStr_Nickname));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetString_Platform));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetInt_Rupees));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetInt_Rupees));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetStr_ShieldImage));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetStr_ShieldImage));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetInt_ShieldPower));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetInt_ShieldPower));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetStr_SwordImage));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetStr_SwordImage));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetInt_SwordPower));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetInt_SwordPower));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetNum_X));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetNum_X));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetNum_Y));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_SetNum_Y));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetObject_Colors));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetObject_Flags));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_GetArray_Weapons));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Colors_Getter));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Colors_Setter));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Flags_Getter));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Flags_Setter));
+	refs.push_back(reinterpret_cast<intptr_t>(Player_Flags_Enumerator));
+}
+
 #endif
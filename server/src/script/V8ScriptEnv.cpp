@@ -1,16 +1,83 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#if (defined(_WIN32) || defined(_WIN64)) && !defined(__GNUC__)
+	#include <sys/utime.h>
+#else
+	#include <utime.h>
+#endif
 #include <libplatform/libplatform.h>
 #include "ScriptBindings.h"
+#include "ScriptHash.h"
 #include "V8ScriptEnv.h"
 #include "V8ScriptFunction.h"
 #include "V8ScriptArguments.h"
 
+// Snapshot file header, followed by the v8 version, the tag, and the constructor names a line each
+#define V8SNAPSHOT_MAGIC	"GS2SNAP1"
+
+// Hands v8 the whole source as a single chunk
+class V8SourceStream : public v8::ScriptCompiler::ExternalSourceStream
+{
+public:
+	explicit V8SourceStream(const std::string& source) : _source(source), _sent(false) { }
+
+	size_t GetMoreData(const uint8_t **src) override
+	{
+		if (_sent || _source.empty())
+			return 0;
+
+		// v8 takes ownership of the chunk
+		uint8_t *data = new uint8_t[_source.length()];
+		memcpy(data, _source.data(), _source.length());
+		*src = data;
+		_sent = true;
+		return _source.length();
+	}
+
+private:
+	const std::string& _source;
+	bool _sent;
+};
+
+// The script is parsed by a v8 streaming task on its own thread. Jobs without a task get compiled normally.
+class V8ScriptCompileJob : public IScriptCompileJob
+{
+public:
+	V8ScriptCompileJob(const std::string& name, const std::string& source)
+		: name(name), source(source), ready(false) { }
+
+	~V8ScriptCompileJob() override
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+
+	bool isReady() const override {
+		return ready.load();
+	}
+
+	std::string name;
+	std::string source;
+	std::unique_ptr<v8::ScriptCompiler::StreamedSource> streamedSource;
+	std::unique_ptr<v8::ScriptCompiler::ScriptStreamingTask> task;
+	std::thread worker;
+	std::atomic<bool> ready;
+};
+
 bool _v8_initialized = false;
 int V8ScriptEnv::s_count = 0;
 std::unique_ptr<v8::Platform> V8ScriptEnv::s_platform;
 
 V8ScriptEnv::V8ScriptEnv()
-	: _initialized(false), _isolate(nullptr)
+	: _initialized(false), _createSnapshot(false), _externalRefs(nullptr), _snapshotCreator(nullptr), _isolate(nullptr)
 {
+	_snapshotBlob.data = nullptr;
+	_snapshotBlob.raw_size = 0;
 }
 
 V8ScriptEnv::~V8ScriptEnv()
@@ -44,9 +111,22 @@ void V8ScriptEnv::Initialize()
 	rc.set_stack_limit((uint32_t *)(((uint64_t)&rc)/2));
 	create_params.constraints = rc;
 
-	// Create v8 isolate
-	create_params.array_buffer_allocator = v8::ArrayBuffer::Allocator::NewDefaultAllocator();
-	_isolate = v8::Isolate::New(create_params);
+	// Create v8 isolate, the snapshot creator makes and owns its own
+	if (_createSnapshot)
+	{
+		_snapshotCreator = new v8::SnapshotCreator(_externalRefs);
+		_isolate = _snapshotCreator->GetIsolate();
+	}
+	else
+	{
+		create_params.array_buffer_allocator = v8::ArrayBuffer::Allocator::NewDefaultAllocator();
+		if (HasSnapshot())
+		{
+			create_params.snapshot_blob = &_snapshotBlob;
+			create_params.external_references = _externalRefs;
+		}
+		_isolate = v8::Isolate::New(create_params);
+	}
 	
 	// Create global object and persist it
 	v8::HandleScope handle_scope(_isolate);
@@ -77,9 +157,15 @@ void V8ScriptEnv::Cleanup(bool shutDown)
 	_context.Reset();
 
 	// Dispose of v8 isolate
-	_isolate->Dispose();
+	if (_snapshotCreator)
+	{
+		delete _snapshotCreator;
+		_snapshotCreator = nullptr;
+	}
+	else _isolate->Dispose();
 	_isolate = nullptr;
 	delete create_params.array_buffer_allocator;
+	create_params.array_buffer_allocator = nullptr;
 	
 	// Decrease v8 environment counter
 	V8ScriptEnv::s_count--;
@@ -122,50 +208,358 @@ bool V8ScriptEnv::ParseErrors(v8::TryCatch *tryCatch)
 
 IScriptFunction * V8ScriptEnv::Compile(const std::string& name, const std::string& source)
 {
-	// Fetch the v8 isolate and context
+	// Fetch the v8 isolate
 	v8::Isolate *isolate = this->Isolate();
-	v8::Local<v8::Context> context = this->Context();
 
 	// Create a stack-allocated scope for v8 calls
 	v8::Isolate::Scope isolate_scope(isolate);
 	v8::HandleScope handle_scope(isolate);
 
-	// Create context with global template
-	if (context.IsEmpty())
-	{
-		v8::Local<v8::ObjectTemplate> global_tpl = PersistentToLocal(isolate, _global_tpl);
-		context = v8::Context::New(isolate, 0, global_tpl);
-		_context.Reset(isolate, context);
-		_global.Reset(isolate, context->Global());
-	}
-
 	// Enter the context for compiling and running the script.
+	v8::Local<v8::Context> context = CompileContext();
 	v8::Context::Scope context_scope(context);
 	
 	// Create a string containing the JavaScript source code.
 	v8::Local<v8::String> sourceStr = v8::String::NewFromUtf8(isolate, source.c_str(), v8::NewStringType::kNormal).ToLocalChecked();
 	
-	// Compile the source code.
+	// Compile the source code, consuming the code cache if we have one for this source.
+	// Without one, compile everything eagerly so the cache we write covers the inner functions too.
 	v8::TryCatch try_catch(isolate);
 	v8::ScriptOrigin origin(v8::String::NewFromUtf8(isolate, name.c_str(), v8::NewStringType::kNormal).ToLocalChecked());
+	std::string cacheFile = CodeCacheFile(source);
+	v8::ScriptCompiler::CachedData *cachedData = ReadCodeCache(cacheFile);
+	v8::ScriptCompiler::Source scriptSource(sourceStr, origin, cachedData);
+	v8::ScriptCompiler::CompileOptions compileOptions = v8::ScriptCompiler::kNoCompileOptions;
+	if (cachedData)
+		compileOptions = v8::ScriptCompiler::kConsumeCodeCache;
+	else if (!cacheFile.empty())
+		compileOptions = v8::ScriptCompiler::kEagerCompile;
+
 	v8::Local<v8::Script> script;
-	if (!v8::Script::Compile(context, sourceStr, &origin).ToLocal(&script)) {
+	if (!v8::ScriptCompiler::Compile(context, &scriptSource, compileOptions).ToLocal(&script)) {
 		ParseErrors(&try_catch);
 		return nullptr;
 	}
-	
+
+	// Write the code cache if we didn't have one, or v8 rejected it.
+	if (!cacheFile.empty() && (cachedData == nullptr || scriptSource.GetCachedData()->rejected))
+		WriteCodeCache(cacheFile, script->GetUnboundScript());
+
+	return RunCompiled(context, script, &try_catch);
+}
+
+IScriptCompileJob * V8ScriptEnv::StartCompile(const std::string& name, const std::string& source)
+{
+	V8ScriptCompileJob *job = new V8ScriptCompileJob(name, source);
+
+	// Consuming a code cache is quicker than parsing, and has to happen on this thread anyway
+	std::string cacheFile = CodeCacheFile(source);
+	if (!cacheFile.empty() && std::ifstream(cacheFile).good())
+	{
+		job->ready.store(true);
+		return job;
+	}
+
+	v8::Isolate *isolate = this->Isolate();
+	v8::Isolate::Scope isolate_scope(isolate);
+	v8::HandleScope handle_scope(isolate);
+
+	job->streamedSource.reset(new v8::ScriptCompiler::StreamedSource(
+		std::unique_ptr<v8::ScriptCompiler::ExternalSourceStream>(new V8SourceStream(job->source)), v8::ScriptCompiler::StreamedSource::UTF8));
+	job->task.reset(v8::ScriptCompiler::StartStreamingScript(isolate, job->streamedSource.get()));
+	if (!job->task)
+	{
+		job->ready.store(true);
+		return job;
+	}
+
+	job->worker = std::thread([job]() {
+		job->task->Run();
+		job->ready.store(true);
+	});
+	return job;
+}
+
+IScriptFunction * V8ScriptEnv::FinishCompile(IScriptCompileJob *compileJob)
+{
+	std::unique_ptr<V8ScriptCompileJob> job(static_cast<V8ScriptCompileJob *>(compileJob));
+	if (job->worker.joinable())
+		job->worker.join();
+
+	// Nothing was streamed
+	if (!job->task)
+		return Compile(job->name, job->source);
+
+	// Fetch the v8 isolate
+	v8::Isolate *isolate = this->Isolate();
+
+	// Create a stack-allocated scope for v8 calls
+	v8::Isolate::Scope isolate_scope(isolate);
+	v8::HandleScope handle_scope(isolate);
+
+	// Enter the context for compiling and running the script.
+	v8::Local<v8::Context> context = CompileContext();
+	v8::Context::Scope context_scope(context);
+
+	// v8 doesn't keep the source while streaming, so it is passed in again here. Streamed scripts compile lazily,
+	// so no code cache is written for them. The next start writes a full one.
+	v8::TryCatch try_catch(isolate);
+	v8::Local<v8::String> sourceStr = v8::String::NewFromUtf8(isolate, job->source.c_str(), v8::NewStringType::kNormal).ToLocalChecked();
+	v8::ScriptOrigin origin(v8::String::NewFromUtf8(isolate, job->name.c_str(), v8::NewStringType::kNormal).ToLocalChecked());
+
+	v8::Local<v8::Script> script;
+	if (!v8::ScriptCompiler::Compile(context, job->streamedSource.get(), sourceStr, origin).ToLocal(&script)) {
+		ParseErrors(&try_catch);
+		return nullptr;
+	}
+
+	return RunCompiled(context, script, &try_catch);
+}
+
+v8::Local<v8::Context> V8ScriptEnv::CompileContext()
+{
+	// Create context with global template
+	v8::Local<v8::Context> context = this->Context();
+	if (context.IsEmpty())
+	{
+		v8::Local<v8::ObjectTemplate> global_tpl = PersistentToLocal(_isolate, _global_tpl);
+		context = v8::Context::New(_isolate, 0, global_tpl);
+		_context.Reset(_isolate, context);
+		_global.Reset(_isolate, context->Global());
+	}
+
+	return context;
+}
+
+IScriptFunction * V8ScriptEnv::RunCompiled(v8::Local<v8::Context> context, v8::Local<v8::Script> script, v8::TryCatch *tryCatch)
+{
 	// Run the script to get the result.
 	v8::Local<v8::Value> result;
 
 	if (!script->Run(context).ToLocal(&result)) {
-		ParseErrors(&try_catch);
+		ParseErrors(tryCatch);
 		return nullptr;
 	}
 
-	assert(!try_catch.HasCaught());
+	assert(!tryCatch->HasCaught());
 	return new V8ScriptFunction(this, result.As<v8::Function>());
 }
 
+std::string V8ScriptEnv::CodeCacheFile(const std::string& source) const
+{
+	if (_codeCachePath.empty())
+		return std::string();
+
+	// Code caches only work with the v8 version that created them.
+	ScriptHash hash;
+	std::string version(v8::V8::GetVersion());
+	hash.update(version.c_str(), version.length() + 1);
+	hash.update(source.c_str(), source.length());
+	return _codeCachePath + hash.digest() + ".bin";
+}
+
+v8::ScriptCompiler::CachedData * V8ScriptEnv::ReadCodeCache(const std::string& fileName) const
+{
+	if (fileName.empty())
+		return nullptr;
+
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return nullptr;
+
+	std::streamsize length = file.tellg();
+	if (length <= 0)
+		return nullptr;
+
+	uint8_t *data = new uint8_t[length];
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char *>(data), length))
+	{
+		delete[] data;
+		return nullptr;
+	}
+
+	// Entries that are still in use don't get pruned on startup.
+	utime(fileName.c_str(), nullptr);
+
+	// Ownership passes to the ScriptCompiler::Source
+	return new v8::ScriptCompiler::CachedData(data, (int)length, v8::ScriptCompiler::CachedData::BufferOwned);
+}
+
+void V8ScriptEnv::WriteCodeCache(const std::string& fileName, v8::Local<v8::UnboundScript> script) const
+{
+	std::unique_ptr<v8::ScriptCompiler::CachedData> cachedData(v8::ScriptCompiler::CreateCodeCache(script));
+	if (!cachedData)
+		return;
+
+	// Write to a temporary file first so a partial write never gets consumed.
+	std::string tempName = fileName + ".tmp";
+	{
+		std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return;
+
+		file.write(reinterpret_cast<const char *>(cachedData->data), cachedData->length);
+		if (!file)
+		{
+			file.close();
+			std::remove(tempName.c_str());
+			return;
+		}
+	}
+
+#if defined(_WIN32) || defined(_WIN64)
+	std::remove(fileName.c_str());
+#endif
+	if (std::rename(tempName.c_str(), fileName.c_str()) != 0)
+		std::remove(tempName.c_str());
+}
+
+bool V8ScriptEnv::LoadSnapshot(const std::string& fileName, const std::string& tag, const intptr_t *externalRefs)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	size_t pos = 0;
+	auto readLine = [&](std::string& line) -> bool {
+		size_t end = data.find('\n', pos);
+		if (end == std::string::npos)
+			return false;
+
+		line = data.substr(pos, end - pos);
+		pos = end + 1;
+		return true;
+	};
+
+	// Snapshots only work with the v8 version and bootstrap that created them.
+	std::string line;
+	if (!readLine(line) || line != V8SNAPSHOT_MAGIC)
+		return false;
+	if (!readLine(line) || line != v8::V8::GetVersion())
+		return false;
+	if (!readLine(line) || line != tag)
+		return false;
+	if (!readLine(line))
+		return false;
+
+	std::vector<std::string> constructors(strtoul(line.c_str(), nullptr, 10));
+	for (auto& constructor : constructors)
+	{
+		if (!readLine(constructor))
+			return false;
+	}
+
+	if (pos >= data.length())
+		return false;
+
+	_snapshotData = std::move(data);
+	_snapshotBlob.data = _snapshotData.data() + pos;
+	_snapshotBlob.raw_size = (int)(_snapshotData.length() - pos);
+	_snapshotConstructors = std::move(constructors);
+	_externalRefs = externalRefs;
+	return true;
+}
+
+IScriptFunction * V8ScriptEnv::RestoreSnapshot()
+{
+	assert(HasSnapshot());
+
+	// Create a stack-allocated scope for v8 calls
+	v8::Isolate::Scope isolate_scope(_isolate);
+	v8::HandleScope handle_scope(_isolate);
+
+	// Constructors were added to the snapshot in the order they are listed in the header
+	for (size_t i = 0; i < _snapshotConstructors.size(); i++)
+	{
+		v8::Local<v8::FunctionTemplate> func_tpl;
+		if (!_isolate->GetDataFromSnapshotOnce<v8::FunctionTemplate>(i).ToLocal(&func_tpl))
+			return nullptr;
+
+		SetConstructor(_snapshotConstructors[i], func_tpl);
+	}
+
+	// The default context already has the global bindings, and the bootstrap function attached to it
+	v8::Local<v8::Context> context = v8::Context::New(_isolate);
+	_context.Reset(_isolate, context);
+	_global.Reset(_isolate, context->Global());
+
+	v8::Context::Scope context_scope(context);
+	v8::Local<v8::Function> function;
+	if (!context->GetDataFromSnapshotOnce<v8::Function>(0).ToLocal(&function))
+		return nullptr;
+
+	return new V8ScriptFunction(this, function);
+}
+
+bool V8ScriptEnv::SaveSnapshot(const std::string& fileName, const std::string& tag, IScriptFunction *bootstrap)
+{
+	assert(_snapshotCreator);
+
+	std::vector<std::string> constructors;
+	{
+		v8::HandleScope handle_scope(_isolate);
+		v8::Local<v8::Context> context = Context();
+
+		for (auto& ctor : _constructorMap)
+		{
+			_snapshotCreator->AddData(GlobalPersistentToLocal(_isolate, ctor.second));
+			constructors.push_back(ctor.first);
+		}
+
+		_snapshotCreator->AddData(context, static_cast<V8ScriptFunction *>(bootstrap)->Function());
+		_snapshotCreator->SetDefaultContext(context);
+	}
+
+	// v8 won't serialize while we still hold handles into the heap
+	delete bootstrap;
+	for (auto& ctor : _constructorMap)
+		ctor.second.Reset();
+	_constructorMap.clear();
+	_global.Reset();
+	_global_tpl.Reset();
+	_context.Reset();
+
+	// Keep compiled functions so the bootstrap doesn't have to be compiled again on startup
+	v8::StartupData blob = _snapshotCreator->CreateBlob(v8::SnapshotCreator::FunctionCodeHandling::kKeep);
+	if (blob.data == nullptr)
+		return false;
+
+	std::unique_ptr<const char[]> blobData(blob.data);
+	std::string header = std::string(V8SNAPSHOT_MAGIC) + "\n" + v8::V8::GetVersion() + "\n" + tag + "\n" + std::to_string(constructors.size()) + "\n";
+	for (auto& constructor : constructors)
+		header.append(constructor).append("\n");
+
+	// Write to a temporary file first so a partial write never gets loaded.
+	std::string tempName = fileName + ".tmp";
+	{
+		std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		file.write(header.data(), header.length());
+		file.write(blob.data, blob.raw_size);
+		if (!file)
+		{
+			file.close();
+			std::remove(tempName.c_str());
+			return false;
+		}
+	}
+
+#if defined(_WIN32) || defined(_WIN64)
+	std::remove(fileName.c_str());
+#endif
+	if (std::rename(tempName.c_str(), fileName.c_str()) != 0)
+	{
+		std::remove(tempName.c_str());
+		return false;
+	}
+
+	return true;
+}
+
 void V8ScriptEnv::CallFunctionInScope(std::function<void()> function)
 {
 	// Fetch the v8 isolate, and create a stack-allocated scope for v8 calls
@@ -188,8 +188,7 @@ void Server_GetObject_Flags(v8::Local<v8::String> prop, const v8::PropertyCallba
 	V8ENV_SAFE_UNWRAP(info, TServer, serverObject);
 
 	// Grab external data
-	v8::Local<v8::External> data = info.Data().As<v8::External>();
-	CScriptEngine *scriptEngine = static_cast<CScriptEngine *>(data->Value());
+	CScriptEngine *scriptEngine = GetScriptEngine<CScriptEngine>(info.GetIsolate());
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 
 	// Find constructor
@@ -332,9 +331,6 @@ void bindClass_Server(CScriptEngine *scriptEngine)
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 	v8::Isolate *isolate = env->Isolate();
 
-	// External pointer
-	v8::Local<v8::External> engine_ref = v8::External::New(isolate, scriptEngine);
-
 	// Create V8 string for "server"
 	v8::Local<v8::String> serverStr = v8::String::NewFromUtf8(isolate, "server", v8::NewStringType::kInternalized).ToLocalChecked();
 
@@ -346,15 +342,15 @@ void bindClass_Server(CScriptEngine *scriptEngine)
 	server_ctor->InstanceTemplate()->SetInternalFieldCount(1);
 
 	// Method functions
-	server_proto->Set(v8::String::NewFromUtf8(isolate, "findlevel"), v8::FunctionTemplate::New(isolate, Server_Function_FindLevel, engine_ref));
-	server_proto->Set(v8::String::NewFromUtf8(isolate, "findnpc"), v8::FunctionTemplate::New(isolate, Server_Function_FindNPC, engine_ref));
-	server_proto->Set(v8::String::NewFromUtf8(isolate, "findplayer"), v8::FunctionTemplate::New(isolate, Server_Function_FindPlayer, engine_ref));
-	server_proto->Set(v8::String::NewFromUtf8(isolate, "savelog"), v8::FunctionTemplate::New(isolate, Server_Function_SaveLog, engine_ref));
-	server_proto->Set(v8::String::NewFromUtf8(isolate, "sendtonc"), v8::FunctionTemplate::New(isolate, Server_Function_SendToNC, engine_ref));
-	server_proto->Set(v8::String::NewFromUtf8(isolate, "sendtorc"), v8::FunctionTemplate::New(isolate, Server_Function_SendToRC, engine_ref));
+	server_proto->Set(v8::String::NewFromUtf8(isolate, "findlevel"), v8::FunctionTemplate::New(isolate, Server_Function_FindLevel));
+	server_proto->Set(v8::String::NewFromUtf8(isolate, "findnpc"), v8::FunctionTemplate::New(isolate, Server_Function_FindNPC));
+	server_proto->Set(v8::String::NewFromUtf8(isolate, "findplayer"), v8::FunctionTemplate::New(isolate, Server_Function_FindPlayer));
+	server_proto->Set(v8::String::NewFromUtf8(isolate, "savelog"), v8::FunctionTemplate::New(isolate, Server_Function_SaveLog));
+	server_proto->Set(v8::String::NewFromUtf8(isolate, "sendtonc"), v8::FunctionTemplate::New(isolate, Server_Function_SendToNC));
+	server_proto->Set(v8::String::NewFromUtf8(isolate, "sendtorc"), v8::FunctionTemplate::New(isolate, Server_Function_SendToRC));
 
 	// Properties
-	server_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "flags"), Server_GetObject_Flags, nullptr, engine_ref);
+	server_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "flags"), Server_GetObject_Flags);
 	server_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "npcs"), Server_GetArray_Npcs);
 	server_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "players"), Server_GetArray_Players);
 	server_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "serverlist"), Server_GetArray_Serverlist);
@@ -374,4 +370,24 @@ void bindClass_Server(CScriptEngine *scriptEngine)
 	env->SetConstructor("server", server_ctor);
 }
 
+// Callbacks bound above, v8 needs their addresses to serialize the bindings into a snapshot
+void externalRefs_Server(std::vector<intptr_t>& refs)
+{
+	refs.push_back(reinterpret_cast<intptr_t>(Server_Function_FindLevel));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_Function_FindNPC));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_Function_FindPlayer));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_Function_SaveLog));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_Function_SendToNC));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_Function_SendToRC));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_GetObject_Flags));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_GetArray_Npcs));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_GetArray_Players));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_GetArray_Serverlist));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_Get_TimeVar));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_Get_TimeVar2));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_Flags_Getter));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_Flags_Setter));
+	refs.push_back(reinterpret_cast<intptr_t>(Server_Flags_Enumerator));
+}
+
 #endif
@@ -36,9 +36,6 @@ void bindClass_Weapon(CScriptEngine *scriptEngine)
 	V8ScriptEnv *env = static_cast<V8ScriptEnv *>(scriptEngine->getScriptEnv());
 	v8::Isolate *isolate = env->Isolate();
 
-	// External pointer
-	// v8::Local<v8::External> engine_ref = v8::External::New(isolate, scriptEngine);
-
 	// Create V8 string for "weapon"
 	v8::Local<v8::String> weaponStr = v8::String::NewFromUtf8(isolate, "weapon", v8::NewStringType::kInternalized).ToLocalChecked();
 
@@ -49,7 +46,7 @@ void bindClass_Weapon(CScriptEngine *scriptEngine)
 	weapon_ctor->InstanceTemplate()->SetInternalFieldCount(1);
 
 	// Method functions
-	//weapon_proto->Set(v8::String::NewFromUtf8(isolate, "setCallBack"), v8::FunctionTemplate::New(isolate, Weapon_SetCallBack, engine_ref));
+	//weapon_proto->Set(v8::String::NewFromUtf8(isolate, "setCallBack"), v8::FunctionTemplate::New(isolate, Weapon_SetCallBack));
 
 	// Properties
 	weapon_proto->SetAccessor(v8::String::NewFromUtf8(isolate, "name"), Weapon_GetStr_Name);
@@ -59,4 +56,11 @@ void bindClass_Weapon(CScriptEngine *scriptEngine)
 	env->SetConstructor(ScriptConstructorId<TWeapon>::result, weapon_ctor);
 }
 
+// Callbacks bound above, v8 needs their addresses to serialize the bindings into a snapshot
+void externalRefs_Weapon(std::vector<intptr_t>& refs)
+{
+	refs.push_back(reinterpret_cast<intptr_t>(Weapon_GetStr_Name));
+	refs.push_back(reinterpret_cast<intptr_t>(Weapon_GetStr_Image));
+}
+
 #endif
@@ -0,0 +1,106 @@
+#include "IDebug.h"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+#include "CString.h"
+#include "CWordFilter.h"
+#include "main.h"
+
+// The server code expects these from main.cpp.
+std::atomic_bool shutdownProgram{ false };
+
+const CString getHomePath()
+{
+	return CString();
+}
+
+static const char* rulesFile = "wordfilter_test.txt";
+
+// One rule of each word position.  Replace is the only action, so apply() never needs a server or player.
+static const char* rules =
+	"RULE\n"
+	"CHECK chat\n"
+	"MATCH badword\n"
+	"PRECISION 100%\n"
+	"WORDPOSITION part\n"
+	"ACTION replace\n"
+	"RULEEND\n"
+	"RULE\n"
+	"CHECK chat\n"
+	"MATCH Zorp\n"
+	"PRECISION 100%\n"
+	"WORDPOSITION start\n"
+	"ACTION replace\n"
+	"RULEEND\n"
+	"RULE\n"
+	"CHECK chat\n"
+	"MATCH heck\n"
+	"PRECISION 100%\n"
+	"WORDPOSITION full\n"
+	"ACTION replace\n"
+	"RULEEND\n"
+	"RULE\n"
+	"CHECK chat\n"
+	"MATCH fuzzyword\n"
+	"PRECISION 80%\n"
+	"WORDPOSITION part\n"
+	"ACTION replace\n"
+	"RULEEND\n";
+
+static int failures = 0;
+
+static void expect(CWordFilter& filter, const char* chat, int check, int expectedActions, const char* expectedChat)
+{
+	CString text(chat);
+	int actions = filter.apply(nullptr, text, check);
+	if (actions == expectedActions && text == CString(expectedChat))
+		return;
+
+	printf("** [Fail] \"%s\": got \"%s\" (actions %d), expected \"%s\" (actions %d)\n", chat, text.text(), actions, expectedChat, expectedActions);
+	++failures;
+}
+
+int main()
+{
+	{
+		std::ofstream file(rulesFile, std::ios::binary | std::ios::trunc);
+		file << rules;
+	}
+
+	// Every case runs through the same filter, so the scratch buffers it keeps are reused between messages.
+	CWordFilter filter(nullptr);
+	filter.load(rulesFile);
+
+	// Part rules are checked from every position that isn't a space: mid-word, after spaces, and across them.
+	expect(filter, "xbadwordx", FILTER_CHECK_CHAT, FILTER_ACTION_REPLACE, "x*******x");
+	expect(filter, "  badword", FILTER_CHECK_CHAT, FILTER_ACTION_REPLACE, "  *******");
+	expect(filter, "a bad word here", FILTER_CHECK_CHAT, FILTER_ACTION_REPLACE, "a ******** here");
+	expect(filter, "b a d w o r d", FILTER_CHECK_CHAT, FILTER_ACTION_REPLACE, "*************");
+
+	// Part rules with a precision below 100% can miss letters.
+	expect(filter, "fuzzyward", FILTER_CHECK_CHAT, FILTER_ACTION_REPLACE, "*********");
+	expect(filter, "fuzzzzzzz", FILTER_CHECK_CHAT, 0, "fuzzzzzzz");
+
+	// Start rules match the start of a word, full rules the whole word.
+	expect(filter, "zorpification is fine", FILTER_CHECK_CHAT, FILTER_ACTION_REPLACE, "************* is fine");
+	expect(filter, "a zorp", FILTER_CHECK_CHAT, FILTER_ACTION_REPLACE, "a ****");
+	expect(filter, "oh heck", FILTER_CHECK_CHAT, FILTER_ACTION_REPLACE, "oh ****");
+	expect(filter, "heckle", FILTER_CHECK_CHAT, 0, "heckle");
+	expect(filter, "checkers", FILTER_CHECK_CHAT, 0, "checkers");
+
+	// Clean chat, and rules that don't check this kind of message, leave it alone.
+	expect(filter, "nothing to see here", FILTER_CHECK_CHAT, 0, "nothing to see here");
+	expect(filter, "xbadwordx", FILTER_CHECK_PM, 0, "xbadwordx");
+
+	remove(rulesFile);
+
+	if (failures != 0)
+	{
+		printf("** %d word filter cases failed\n", failures);
+		return 1;
+	}
+
+	printf(":: All word filter cases passed\n");
+	return 0;
+}